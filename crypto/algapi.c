@@ -69,7 +69,8 @@ static int crypto_check_alg(struct crypto_alg *alg)
 
 static void crypto_free_instance(struct crypto_instance *inst)
 {
-	if (!inst->alg.cra_type->free) {
+	/* instances of the legacy compression type have no cra_type */
+	if (!inst->alg.cra_type || !inst->alg.cra_type->free) {
 		inst->tmpl->free(inst);
 		return;
 	}
@@ -21,11 +21,15 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/crypto.h>
+#include <linux/err.h>
+#include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/lz4.h>
+#include <crypto/algapi.h>
 
 struct lz4_ctx {
 	void *lz4_comp_mem;
+	int acceleration;
 };
 
 static int lz4_init(struct crypto_tfm *tfm)
@@ -36,6 +40,21 @@ static int lz4_init(struct crypto_tfm *tfm)
 	if (!ctx->lz4_comp_mem)
 		return -ENOMEM;
 
+	ctx->acceleration = LZ4_ACCELERATION_DEFAULT;
+	return 0;
+}
+
+static int lz4fast_init(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct lz4_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	err = lz4_init(tfm);
+	if (err)
+		return err;
+
+	ctx->acceleration = *(u32 *)crypto_instance_ctx(inst);
 	return 0;
 }
 
@@ -52,7 +71,8 @@ static int lz4_compress_crypto(struct crypto_tfm *tfm, const u8 *src,
 	size_t tmp_len = *dlen;
 	int err;
 
-	err = lz4_compress(src, slen, dst, &tmp_len, ctx->lz4_comp_mem);
+	err = lz4_compress_fast(src, slen, dst, &tmp_len, ctx->lz4_comp_mem,
+				ctx->acceleration);
 
 	if (err < 0)
 		return -EINVAL;
@@ -89,13 +109,77 @@ static struct crypto_alg alg_lz4 = {
 	.coa_decompress		= lz4_decompress_crypto } }
 };
 
+/*
+ * "lz4fast(N)" is LZ4 with acceleration factor N, see lz4_compress_fast().
+ * It produces regular LZ4 data, so it only differs from "lz4" in speed and
+ * compression ratio.
+ */
+static struct crypto_instance *lz4fast_alloc(struct rtattr **tb)
+{
+	struct crypto_instance *inst;
+	u32 acceleration;
+	int err;
+
+	err = crypto_check_attr_type(tb, CRYPTO_ALG_TYPE_COMPRESS);
+	if (err)
+		return ERR_PTR(err);
+
+	err = crypto_attr_u32(tb[1], &acceleration);
+	if (err)
+		return ERR_PTR(err);
+
+	if (acceleration < LZ4_ACCELERATION_DEFAULT ||
+	    acceleration > LZ4_ACCELERATION_MAX)
+		return ERR_PTR(-EINVAL);
+
+	inst = kzalloc(sizeof(*inst) + sizeof(acceleration), GFP_KERNEL);
+	if (!inst)
+		return ERR_PTR(-ENOMEM);
+
+	*(u32 *)crypto_instance_ctx(inst) = acceleration;
+
+	snprintf(inst->alg.cra_name, CRYPTO_MAX_ALG_NAME, "lz4fast(%u)",
+		 acceleration);
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_COMPRESS;
+	inst->alg.cra_ctxsize = sizeof(struct lz4_ctx);
+	inst->alg.cra_init = lz4fast_init;
+	inst->alg.cra_exit = lz4_exit;
+	inst->alg.cra_compress.coa_compress = lz4_compress_crypto;
+	inst->alg.cra_compress.coa_decompress = lz4_decompress_crypto;
+
+	return inst;
+}
+
+static void lz4fast_free(struct crypto_instance *inst)
+{
+	kfree(inst);
+}
+
+static struct crypto_template lz4fast_tmpl = {
+	.name = "lz4fast",
+	.alloc = lz4fast_alloc,
+	.free = lz4fast_free,
+	.module = THIS_MODULE,
+};
+
 static int __init lz4_mod_init(void)
 {
-	return crypto_register_alg(&alg_lz4);
+	int err;
+
+	err = crypto_register_alg(&alg_lz4);
+	if (err)
+		return err;
+
+	err = crypto_register_template(&lz4fast_tmpl);
+	if (err)
+		crypto_unregister_alg(&alg_lz4);
+
+	return err;
 }
 
 static void __exit lz4_mod_fini(void)
 {
+	crypto_unregister_template(&lz4fast_tmpl);
 	crypto_unregister_alg(&alg_lz4);
 }
 
@@ -105,3 +189,4 @@ module_exit(lz4_mod_fini);
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("LZ4 Compression Algorithm");
 MODULE_ALIAS_CRYPTO("lz4");
+MODULE_ALIAS_CRYPTO("lz4fast");
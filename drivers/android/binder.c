@@ -2032,6 +2032,9 @@ static void binder_thread_dec_tmpref(struct binder_thread *thread)
 	 * atomic is used to protect the counter value while
 	 * it cannot reach zero or thread->is_dead is false
 	 */
+	if (atomic_add_unless(&thread->tmp_ref, -1, 1))
+		return;
+
 	binder_inner_proc_lock(thread->proc);
 	atomic_dec(&thread->tmp_ref);
 	if (thread->is_dead && !atomic_read(&thread->tmp_ref)) {
@@ -2786,6 +2789,10 @@ static int binder_fixup_parent(struct binder_transaction *t,
  * If the @thread parameter is not NULL, the transaction is always queued
  * to the waitlist of that specific thread.
  *
+ * A thread that is handed the transaction is woken up only after the
+ * locks are dropped, so that it does not immediately contend on
+ * proc->inner_lock with us when it starts running.
+ *
  * Return:	true if the transactions was successfully queued
  *		false if the target process or thread is dead
  */
@@ -2827,18 +2834,32 @@ static bool binder_proc_transaction(struct binder_transaction *t,
 		binder_transaction_priority(thread->task, t, node_prio,
 					    node->inherit_rt);
 		binder_enqueue_thread_work_ilocked(thread, &t->work);
+		/* keep the thread around for the wake-up below */
+		atomic_inc(&thread->tmp_ref);
 	} else if (!pending_async) {
 		binder_enqueue_work_ilocked(&t->work, &proc->todo);
+		binder_wakeup_thread_ilocked(proc, NULL, !oneway /* sync */);
 	} else {
 		binder_enqueue_work_ilocked(&t->work, &node->async_todo);
 	}
 
-	if (!pending_async)
-		binder_wakeup_thread_ilocked(proc, thread, !oneway /* sync */);
-
 	binder_inner_proc_unlock(proc);
 	binder_node_unlock(node);
 
+	if (thread) {
+		/*
+		 * The thread is off proc->waiting_threads (or was picked
+		 * by the caller), so nobody else will wake it for this
+		 * work. A wake-up racing with it finding the work by
+		 * itself is harmless.
+		 */
+		if (oneway)
+			wake_up_interruptible(&thread->wait);
+		else
+			wake_up_interruptible_sync(&thread->wait);
+		binder_thread_dec_tmpref(thread);
+	}
+
 	return true;
 }
 
@@ -4063,6 +4084,7 @@ static int binder_thread_read(struct binder_proc *proc,
 
 	int ret = 0;
 	int wait_for_proc_work;
+	bool has_thread_work;
 
 	if (*consumed == 0) {
 		if (put_user(BR_NOOP, (uint32_t __user *)ptr))
@@ -4073,13 +4095,14 @@ static int binder_thread_read(struct binder_proc *proc,
 retry:
 	binder_inner_proc_lock(proc);
 	wait_for_proc_work = binder_available_for_proc_work_ilocked(thread);
+	has_thread_work = !binder_worklist_empty_ilocked(&thread->todo);
 	binder_inner_proc_unlock(proc);
 
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
 
 	trace_binder_wait_for_work(wait_for_proc_work,
 				   !!thread->transaction_stack,
-				   !binder_worklist_empty(proc, &thread->todo));
+				   has_thread_work);
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
 					BINDER_LOOPER_STATE_ENTERED))) {
@@ -63,6 +63,11 @@ struct driver_private {
  *	binding of drivers which were unable to get all the resources needed by
  *	the device; typically because it depends on another driver getting
  *	probed first.
+ * @deferred_supplier - device tree node of the supplier the device last
+ *	deferred its probe on, if the subsystem that returned -EPROBE_DEFER
+ *	recorded one.  A deferred device with a recorded supplier is only
+ *	retried once that supplier binds.
+ * @probe_attempts - number of times a driver probe was tried on the device.
  * @device - pointer back to the struct device that this structure is
  * associated with.
  *
@@ -74,6 +79,8 @@ struct device_private {
 	struct klist_node knode_driver;
 	struct klist_node knode_bus;
 	struct list_head deferred_probe;
+	struct device_node *deferred_supplier;
+	unsigned int probe_attempts;
 	struct device *device;
 };
 #define to_device_private_parent(obj)	\
@@ -17,9 +17,12 @@
  * This file is released under the GPLv2
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/delay.h>
 #include <linux/module.h>
+#include <linux/of.h>
+#include <linux/seq_file.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
@@ -41,9 +44,16 @@
  *
  * Deferred probe maintains two lists of devices, a pending list and an active
  * list.  A driver returning -EPROBE_DEFER causes the device to be added to the
- * pending list.  A successful driver probe will trigger moving all devices
- * from the pending to the active list so that the workqueue will eventually
- * retry them.
+ * pending list.  A successful driver probe will trigger moving devices from
+ * the pending to the active list so that the workqueue will eventually retry
+ * them.
+ *
+ * Subsystems that know which provider a lookup was waiting for record it
+ * with driver_deferred_probe_supplier() before returning -EPROBE_DEFER.  Such
+ * a device is then only moved to the active list when a device whose node is
+ * the supplier, or one of its ancestors or descendants, binds.  Devices
+ * without a recorded supplier are retried on every successful probe, as are
+ * all pending devices when a device without a device tree node binds.
  *
  * The deferred_probe_mutex must be held any time the deferred_probe_*_list
  * of the (struct device*)->p->deferred_probe pointers are manipulated
@@ -126,16 +136,68 @@ void driver_deferred_probe_del(struct device *dev)
 		dev_dbg(dev, "Removed from deferred list\n");
 		list_del_init(&dev->p->deferred_probe);
 	}
+	of_node_put(dev->p->deferred_supplier);
+	dev->p->deferred_supplier = NULL;
+	mutex_unlock(&deferred_probe_mutex);
+}
+
+/**
+ * driver_deferred_probe_supplier() - Record what a deferring probe waits for
+ * @dev: device whose probe is about to return -EPROBE_DEFER
+ * @supplier: device tree node of the missing provider, or NULL to forget it
+ *
+ * Lets the deferred probe code retry @dev only once the driver for
+ * @supplier has bound, instead of after every successful probe.  Only the
+ * last supplier recorded during a probe attempt is kept, and only if that
+ * probe returns -EPROBE_DEFER, so callers must only record lookups whose
+ * -EPROBE_DEFER the driver is expected to return.  Calls made while @dev
+ * is not being probed are ignored.
+ */
+void driver_deferred_probe_supplier(struct device *dev,
+				    struct device_node *supplier)
+{
+	if (!dev || !dev->p || (supplier && !dev->driver))
+		return;
+
+	mutex_lock(&deferred_probe_mutex);
+	of_node_put(dev->p->deferred_supplier);
+	dev->p->deferred_supplier = of_node_get(supplier);
 	mutex_unlock(&deferred_probe_mutex);
 }
+EXPORT_SYMBOL_GPL(driver_deferred_probe_supplier);
+
+/*
+ * Whether @p may be able to probe now that @supplier is bound.  Providers
+ * are often child nodes of the device that registers them (regulators under
+ * a PMIC) or the other way round, so match along the node's lineage.
+ */
+static bool driver_deferred_probe_waits_on(struct device_private *p,
+					   struct device *supplier)
+{
+	struct device_node *np;
+
+	if (!supplier || !supplier->of_node || !p->deferred_supplier)
+		return true;
+
+	for (np = p->deferred_supplier; np; np = np->parent)
+		if (np == supplier->of_node)
+			return true;
+	for (np = supplier->of_node; np; np = np->parent)
+		if (np == p->deferred_supplier)
+			return true;
+
+	return false;
+}
 
 static bool driver_deferred_probe_enable = false;
 /**
  * driver_deferred_probe_trigger() - Kick off re-probing deferred devices
+ * @supplier: device that just bound, or NULL to retry every pending device
  *
- * This functions moves all devices from the pending list to the active
- * list and schedules the deferred probe workqueue to process them.  It
- * should be called anytime a driver is successfully bound to a device.
+ * This functions moves the devices that may be waiting for @supplier from
+ * the pending list to the active list and schedules the deferred probe
+ * workqueue to process them.  It should be called anytime a driver is
+ * successfully bound to a device.
  *
  * Note, there is a race condition in multi-threaded probe. In the case where
  * more than one device is probing at the same time, it is possible for one
@@ -145,23 +207,27 @@ static bool driver_deferred_probe_enable = false;
  *
  * The atomic 'deferred_trigger_count' is used to determine if a successful
  * trigger has occurred in the midst of probing a driver. If the trigger count
- * changes in the midst of a probe, then deferred processing should be triggered
- * again.
+ * changes in the midst of a probe, then the deferring device is retried.
  */
-static void driver_deferred_probe_trigger(void)
+static void driver_deferred_probe_trigger(struct device *supplier)
 {
+	struct device_private *p, *n;
+
 	if (!driver_deferred_probe_enable)
 		return;
 
 	/*
-	 * A successful probe means that all the devices in the pending list
-	 * should be triggered to be reprobed.  Move all the deferred devices
-	 * into the active list so they can be retried by the workqueue
+	 * A successful probe means that the devices in the pending list that
+	 * could be waiting for it should be triggered to be reprobed.  Move
+	 * them into the active list so they can be retried by the workqueue
 	 */
 	mutex_lock(&deferred_probe_mutex);
 	atomic_inc(&deferred_trigger_count);
-	list_splice_tail_init(&deferred_probe_pending_list,
-			      &deferred_probe_active_list);
+	list_for_each_entry_safe(p, n, &deferred_probe_pending_list,
+				 deferred_probe)
+		if (driver_deferred_probe_waits_on(p, supplier))
+			list_move_tail(&p->deferred_probe,
+				       &deferred_probe_active_list);
 	mutex_unlock(&deferred_probe_mutex);
 
 	/*
@@ -171,6 +237,96 @@ static void driver_deferred_probe_trigger(void)
 	queue_work(deferred_wq, &deferred_probe_work);
 }
 
+/*
+ * driver_deferred_probe_retry() - Retry one deferred device
+ *
+ * Used when some driver bound while @dev was probing: that trigger could not
+ * have moved @dev yet, and it is not known whether it was the supplier @dev
+ * waits for, so just give @dev another go.
+ */
+static void driver_deferred_probe_retry(struct device *dev)
+{
+	if (!driver_deferred_probe_enable)
+		return;
+
+	mutex_lock(&deferred_probe_mutex);
+	if (!list_empty(&dev->p->deferred_probe))
+		list_move_tail(&dev->p->deferred_probe,
+			       &deferred_probe_active_list);
+	mutex_unlock(&deferred_probe_mutex);
+
+	queue_work(deferred_wq, &deferred_probe_work);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int deferred_devs_show(struct seq_file *s, void *data)
+{
+	struct device_private *p;
+
+	mutex_lock(&deferred_probe_mutex);
+	list_for_each_entry(p, &deferred_probe_pending_list, deferred_probe) {
+		seq_printf(s, "%s", dev_name(p->device));
+		if (p->deferred_supplier)
+			seq_printf(s, "\t%s", p->deferred_supplier->full_name);
+		seq_putc(s, '\n');
+	}
+	mutex_unlock(&deferred_probe_mutex);
+
+	return 0;
+}
+
+static int deferred_devs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, deferred_devs_show, inode->i_private);
+}
+
+static const struct file_operations deferred_devs_fops = {
+	.open		= deferred_devs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int probe_attempts_show(struct seq_file *s, void *data)
+{
+	struct kobject *kobj;
+	struct device *dev;
+
+	spin_lock(&devices_kset->list_lock);
+	list_for_each_entry(kobj, &devices_kset->list, entry) {
+		dev = kobj_to_dev(kobj);
+		if (dev->p && dev->p->probe_attempts)
+			seq_printf(s, "%s\t%u\n", dev_name(dev),
+				   dev->p->probe_attempts);
+	}
+	spin_unlock(&devices_kset->list_lock);
+
+	return 0;
+}
+
+static int probe_attempts_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, probe_attempts_show, inode->i_private);
+}
+
+static const struct file_operations probe_attempts_fops = {
+	.open		= probe_attempts_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void deferred_probe_debugfs_init(void)
+{
+	debugfs_create_file("devices_deferred", 0444, NULL, NULL,
+			    &deferred_devs_fops);
+	debugfs_create_file("probe_attempts", 0444, NULL, NULL,
+			    &probe_attempts_fops);
+}
+#else
+static inline void deferred_probe_debugfs_init(void) { }
+#endif
+
 /**
  * deferred_probe_initcall() - Enable probing of deferred devices
  *
@@ -184,8 +340,10 @@ static int deferred_probe_initcall(void)
 	if (WARN_ON(!deferred_wq))
 		return -ENOMEM;
 
+	deferred_probe_debugfs_init();
+
 	driver_deferred_probe_enable = true;
-	driver_deferred_probe_trigger();
+	driver_deferred_probe_trigger(NULL);
 	/* Sort as many dependencies as possible before exiting initcalls */
 	flush_workqueue(deferred_wq);
 	return 0;
@@ -209,10 +367,10 @@ static void driver_bound(struct device *dev)
 
 	/*
 	 * Make sure the device is no longer in one of the deferred lists and
-	 * kick off retrying all pending devices
+	 * kick off retrying the pending devices that may be waiting for it
 	 */
 	driver_deferred_probe_del(dev);
-	driver_deferred_probe_trigger();
+	driver_deferred_probe_trigger(dev);
 
 	if (dev->bus)
 		blocking_notifier_call_chain(&dev->bus->p->bus_notifier,
@@ -287,6 +445,10 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
 	WARN_ON(!list_empty(&dev->devres_head));
 
+	/* Whatever this attempt defers on gets recorded afresh */
+	dev->p->probe_attempts++;
+	driver_deferred_probe_supplier(dev, NULL);
+
 	dev->driver = drv;
 
 	/* If using pinctrl, bind pins now before probing */
@@ -335,6 +497,10 @@ probe_failed:
 	if (dev->pm_domain && dev->pm_domain->dismiss)
 		dev->pm_domain->dismiss(dev);
 
+	/* A supplier recorded by a probe that didn't defer is stale */
+	if (ret != -EPROBE_DEFER)
+		driver_deferred_probe_supplier(dev, NULL);
+
 	switch (ret) {
 	case -EPROBE_DEFER:
 		/* Driver requested deferred probing */
@@ -342,7 +508,7 @@ probe_failed:
 		driver_deferred_probe_add(dev);
 		/* Did a trigger occur while probing? Need to re-trigger if yes */
 		if (local_trigger_count != atomic_read(&deferred_trigger_count))
-			driver_deferred_probe_trigger();
+			driver_deferred_probe_retry(dev);
 		break;
 	case -ENODEV:
 	case -ENXIO:
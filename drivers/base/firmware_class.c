@@ -29,6 +29,10 @@
 #include <linux/syscore_ops.h>
 #include <linux/reboot.h>
 #include <linux/security.h>
+#include <linux/pagemap.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <generated/utsrelease.h>
 
@@ -111,6 +115,7 @@ static inline long firmware_loading_timeout(void)
 #define FW_OPT_FALLBACK		0
 #endif
 #define FW_OPT_NO_WARN	(1U << 3)
+#define FW_OPT_MAP	(1U << 4)
 
 struct firmware_cache {
 	/* firmware_buf instance will be added into the below list */
@@ -142,6 +147,9 @@ struct firmware_buf {
 	unsigned long status;
 	void *data;
 	size_t size;
+	struct page **mapped_pages;	/* page cache pages behind data */
+	int nr_mapped_pages;
+	struct file *mapped_file;	/* kept from being written to */
 #ifdef CONFIG_FW_LOADER_USER_HELPER
 	bool is_paged_buf;
 	bool need_uevent;
@@ -260,6 +268,15 @@ static void __fw_free_buf(struct kref *ref)
 		kfree(buf->pages);
 	} else
 #endif
+	if (buf->mapped_pages) {
+		int i;
+		vunmap(buf->data);
+		for (i = 0; i < buf->nr_mapped_pages; i++)
+			put_page(buf->mapped_pages[i]);
+		kfree(buf->mapped_pages);
+		allow_write_access(buf->mapped_file);
+		fput(buf->mapped_file);
+	} else
 		vfree(buf->data);
 	kfree_const(buf->fw_id);
 	kfree(buf);
@@ -322,8 +339,95 @@ fail:
 	return rc;
 }
 
+/* Some architectures don't have PAGE_KERNEL_RO */
+#ifndef PAGE_KERNEL_RO
+#define PAGE_KERNEL_RO PAGE_KERNEL
+#endif
+
+/* same readahead pattern as a sequential read() of the whole file */
+static struct page *fw_read_page(struct file *file, pgoff_t index,
+				 pgoff_t nr_pages)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct page *page;
+
+	page = find_get_page(mapping, index);
+	if (!page)
+		page_cache_sync_readahead(mapping, &file->f_ra, file, index,
+					  nr_pages - index);
+	else if (PageReadahead(page))
+		page_cache_async_readahead(mapping, &file->f_ra, file, page,
+					   index, nr_pages - index);
+	if (page)
+		put_page(page);
+
+	return read_mapping_page(mapping, index, file);
+}
+
+/*
+ * Map the page cache pages of @file read-only instead of copying them into
+ * a vmalloc buffer.  The pages stay pinned, and the file is denied write
+ * access, until the buffer is freed: the buffer may be handed out again
+ * from the firmware cache long after security_kernel_fw_from_file() has
+ * checked it.  A file that is open for writing is copied instead.
+ */
+static int fw_map_file_contents(struct file *file, struct firmware_buf *fw_buf)
+{
+	struct page **pages;
+	int size, nr_pages, i = 0;
+	void *data;
+	int rc;
+
+	if (!S_ISREG(file_inode(file)->i_mode))
+		return -EINVAL;
+	if (!file->f_mapping->a_ops->readpage || deny_write_access(file))
+		return fw_read_file_contents(file, fw_buf);
+	rc = -EINVAL;
+	size = i_size_read(file_inode(file));
+	if (size <= 0)
+		goto fail_allow;
+	rc = -ENOMEM;
+	nr_pages = DIV_ROUND_UP(size, PAGE_SIZE);
+	pages = kmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		goto fail_allow;
+
+	for (i = 0; i < nr_pages; i++) {
+		pages[i] = fw_read_page(file, i, nr_pages);
+		if (IS_ERR(pages[i])) {
+			rc = PTR_ERR(pages[i]);
+			goto fail;
+		}
+	}
+
+	data = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL_RO);
+	if (!data) {
+		rc = -ENOMEM;
+		goto fail;
+	}
+	rc = security_kernel_fw_from_file(file, data, size);
+	if (rc) {
+		vunmap(data);
+		goto fail;
+	}
+	fw_buf->data = data;
+	fw_buf->size = size;
+	fw_buf->mapped_pages = pages;
+	fw_buf->nr_mapped_pages = nr_pages;
+	fw_buf->mapped_file = get_file(file);
+	return 0;
+fail:
+	while (i--)
+		put_page(pages[i]);
+	kfree(pages);
+fail_allow:
+	allow_write_access(file);
+	return rc;
+}
+
 static int fw_get_filesystem_firmware(struct device *device,
-				       struct firmware_buf *buf)
+				       struct firmware_buf *buf,
+				       unsigned int opt_flags)
 {
 	int i, len;
 	int rc = -ENOENT;
@@ -350,7 +454,10 @@ static int fw_get_filesystem_firmware(struct device *device,
 		file = filp_open(path, O_RDONLY, 0);
 		if (IS_ERR(file))
 			continue;
-		rc = fw_read_file_contents(file, buf);
+		if (opt_flags & FW_OPT_MAP)
+			rc = fw_map_file_contents(file, buf);
+		else
+			rc = fw_read_file_contents(file, buf);
 		fput(file);
 		if (rc)
 			dev_warn(device, "firmware, attempted to load %s, but failed with error %d\n",
@@ -608,11 +715,6 @@ static ssize_t firmware_loading_show(struct device *dev,
 	return sprintf(buf, "%d\n", loading);
 }
 
-/* Some architectures don't have PAGE_KERNEL_RO */
-#ifndef PAGE_KERNEL_RO
-#define PAGE_KERNEL_RO PAGE_KERNEL
-#endif
-
 /* one pages buffer should be mapped/unmapped only once */
 static int fw_map_pages_buf(struct firmware_buf *buf)
 {
@@ -1032,6 +1134,98 @@ static int sync_cached_firmware_buf(struct firmware_buf *buf)
 	return ret;
 }
 
+/* per firmware file load statistics, see fw_load_stats_show() */
+struct fw_load_stat {
+	struct list_head list;
+	const char *name;
+	const char *source;
+	size_t size;
+	unsigned int count;
+	s64 start_us;		/* of the latest load, since boot */
+	s64 load_us;		/* duration of the latest load */
+};
+
+static LIST_HEAD(fw_load_stats);
+static DEFINE_MUTEX(fw_load_stats_lock);
+static struct dentry *fw_load_stats_dentry;
+
+static void fw_record_load(struct device *device, const char *name,
+			   const struct firmware *fw, const char *source,
+			   ktime_t start)
+{
+	s64 load_us = ktime_to_us(ktime_sub(ktime_get(), start));
+	struct fw_load_stat *stat;
+
+	if (!fw->priv)
+		source = "builtin";
+
+	dev_dbg(device, "firmware: %s (%zu bytes, %s) loaded in %lld us\n",
+		name, fw->size, source, load_us);
+
+	mutex_lock(&fw_load_stats_lock);
+	list_for_each_entry(stat, &fw_load_stats, list)
+		if (!strcmp(stat->name, name))
+			goto found;
+
+	stat = kzalloc(sizeof(*stat), GFP_KERNEL);
+	if (!stat)
+		goto out;
+	stat->name = kstrdup_const(name, GFP_KERNEL);
+	if (!stat->name) {
+		kfree(stat);
+		goto out;
+	}
+	list_add_tail(&stat->list, &fw_load_stats);
+found:
+	stat->source = source;
+	stat->size = fw->size;
+	stat->count++;
+	stat->start_us = ktime_to_us(start);
+	stat->load_us = load_us;
+out:
+	mutex_unlock(&fw_load_stats_lock);
+}
+
+static int fw_load_stats_show(struct seq_file *m, void *unused)
+{
+	struct fw_load_stat *stat;
+
+	seq_printf(m, "%-40s %10s %-12s %6s %12s %10s\n", "name", "size",
+		   "source", "loads", "start_us", "load_us");
+
+	mutex_lock(&fw_load_stats_lock);
+	list_for_each_entry(stat, &fw_load_stats, list)
+		seq_printf(m, "%-40s %10zu %-12s %6u %12lld %10lld\n",
+			   stat->name, stat->size, stat->source, stat->count,
+			   stat->start_us, stat->load_us);
+	mutex_unlock(&fw_load_stats_lock);
+
+	return 0;
+}
+
+static int fw_load_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fw_load_stats_show, NULL);
+}
+
+static const struct file_operations fw_load_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = fw_load_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void fw_load_stats_free(void)
+{
+	struct fw_load_stat *stat, *tmp;
+
+	list_for_each_entry_safe(stat, tmp, &fw_load_stats, list) {
+		kfree_const(stat->name);
+		kfree(stat);
+	}
+}
+
 /* prepare firmware and firmware_buf structs;
  * return 0 if a firmware is already assigned, 1 if need to load one,
  * or a negative error code
@@ -1119,6 +1313,8 @@ static int
 _request_firmware(const struct firmware **firmware_p, const char *name,
 		  struct device *device, unsigned int opt_flags)
 {
+	const char *source = "cache";
+	ktime_t start = ktime_get();
 	struct firmware *fw;
 	long timeout;
 	int ret;
@@ -1152,7 +1348,7 @@ _request_firmware(const struct firmware **firmware_p, const char *name,
 		}
 	}
 
-	ret = fw_get_filesystem_firmware(device, fw->priv);
+	ret = fw_get_filesystem_firmware(device, fw->priv, opt_flags);
 	if (ret) {
 		if (!(opt_flags & FW_OPT_NO_WARN))
 			dev_warn(device,
@@ -1160,9 +1356,14 @@ _request_firmware(const struct firmware **firmware_p, const char *name,
 				 name, ret);
 		if (opt_flags & FW_OPT_USERHELPER) {
 			dev_warn(device, "Falling back to user helper\n");
+			source = "user helper";
 			ret = fw_load_from_user_helper(fw, name, device,
 						       opt_flags, timeout);
 		}
+	} else {
+		struct firmware_buf *buf = fw->priv;
+
+		source = buf->mapped_pages ? "mapped" : "direct";
 	}
 
 	if (!ret)
@@ -1174,6 +1375,8 @@ _request_firmware(const struct firmware **firmware_p, const char *name,
 	if (ret < 0) {
 		release_firmware(fw);
 		fw = NULL;
+	} else {
+		fw_record_load(device, name, fw, source, start);
 	}
 
 	*firmware_p = fw;
@@ -1239,6 +1442,34 @@ int request_firmware_direct(const struct firmware **firmware_p,
 }
 EXPORT_SYMBOL_GPL(request_firmware_direct);
 
+/**
+ * request_firmware_mapped: - load firmware without copying it
+ * @firmware_p: pointer to firmware image
+ * @name: name of firmware file
+ * @device: device for which firmware is being loaded
+ *
+ * This function works pretty much like request_firmware(), but an image
+ * loaded from the filesystem is not copied into a vmalloc buffer: its page
+ * cache pages are mapped read-only and stay pinned until the firmware is
+ * released.  This saves a copy and a duplicate of large images in memory.
+ * Until then the file can't be opened for writing or truncated.
+ *
+ * Like with every firmware image, @firmware_p->data must not be written to;
+ * the image may also be handed to other callers requesting the same @name.
+ **/
+int request_firmware_mapped(const struct firmware **firmware_p,
+			    const char *name, struct device *device)
+{
+	int ret;
+
+	__module_get(THIS_MODULE);
+	ret = _request_firmware(firmware_p, name, device,
+				FW_OPT_UEVENT | FW_OPT_FALLBACK | FW_OPT_MAP);
+	module_put(THIS_MODULE);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(request_firmware_mapped);
+
 /**
  * release_firmware: - release the resource associated with a firmware image
  * @fw: firmware resource to release
@@ -1281,6 +1512,46 @@ static void request_firmware_work_func(struct work_struct *work)
 	kfree(fw_work);
 }
 
+static int
+_request_firmware_nowait(
+	struct module *module, const char *name, struct device *device,
+	gfp_t gfp, void *context,
+	void (*cont)(const struct firmware *fw, void *context),
+	unsigned int opt_flags)
+{
+	struct firmware_work *fw_work;
+
+	fw_work = kzalloc(sizeof(struct firmware_work), gfp);
+	if (!fw_work)
+		return -ENOMEM;
+
+	fw_work->module = module;
+	fw_work->name = kstrdup_const(name, gfp);
+	if (!fw_work->name) {
+		kfree(fw_work);
+		return -ENOMEM;
+	}
+	fw_work->device = device;
+	fw_work->context = context;
+	fw_work->cont = cont;
+	fw_work->opt_flags = opt_flags;
+
+	if (!try_module_get(module)) {
+		kfree_const(fw_work->name);
+		kfree(fw_work);
+		return -EFAULT;
+	}
+
+	get_device(fw_work->device);
+	INIT_WORK(&fw_work->work, request_firmware_work_func);
+	/*
+	 * Loads are independent of each other, let them run on any CPU
+	 * instead of queueing up behind each other on the requesting one.
+	 */
+	queue_work(system_unbound_wq, &fw_work->work);
+	return 0;
+}
+
 /**
  * request_firmware_nowait - asynchronous version of request_firmware
  * @module: module requesting the firmware
@@ -1310,37 +1581,38 @@ request_firmware_nowait(
 	const char *name, struct device *device, gfp_t gfp, void *context,
 	void (*cont)(const struct firmware *fw, void *context))
 {
-	struct firmware_work *fw_work;
-
-	fw_work = kzalloc(sizeof(struct firmware_work), gfp);
-	if (!fw_work)
-		return -ENOMEM;
-
-	fw_work->module = module;
-	fw_work->name = kstrdup_const(name, gfp);
-	if (!fw_work->name) {
-		kfree(fw_work);
-		return -ENOMEM;
-	}
-	fw_work->device = device;
-	fw_work->context = context;
-	fw_work->cont = cont;
-	fw_work->opt_flags = FW_OPT_NOWAIT | FW_OPT_FALLBACK |
-		(uevent ? FW_OPT_UEVENT : FW_OPT_USERHELPER);
-
-	if (!try_module_get(module)) {
-		kfree_const(fw_work->name);
-		kfree(fw_work);
-		return -EFAULT;
-	}
-
-	get_device(fw_work->device);
-	INIT_WORK(&fw_work->work, request_firmware_work_func);
-	schedule_work(&fw_work->work);
-	return 0;
+	return _request_firmware_nowait(module, name, device, gfp, context,
+					cont, FW_OPT_NOWAIT | FW_OPT_FALLBACK |
+					(uevent ? FW_OPT_UEVENT :
+						  FW_OPT_USERHELPER));
 }
 EXPORT_SYMBOL(request_firmware_nowait);
 
+/**
+ * request_firmware_mapped_nowait - asynchronous request_firmware_mapped
+ * @module: module requesting the firmware
+ * @name: name of firmware file
+ * @device: device for which firmware is being loaded
+ * @gfp: allocation flags
+ * @context: will be passed over to @cont
+ * @cont: function called with the firmware image, or %NULL on failure
+ *
+ * Like request_firmware_nowait() with @uevent set, but loading the image
+ * as request_firmware_mapped() does.  Drivers of unrelated devices using
+ * this from ->probe() have their firmware read in parallel instead of one
+ * after the other.
+ **/
+int request_firmware_mapped_nowait(
+	struct module *module, const char *name, struct device *device,
+	gfp_t gfp, void *context,
+	void (*cont)(const struct firmware *fw, void *context))
+{
+	return _request_firmware_nowait(module, name, device, gfp, context,
+					cont, FW_OPT_NOWAIT | FW_OPT_FALLBACK |
+					FW_OPT_UEVENT | FW_OPT_MAP);
+}
+EXPORT_SYMBOL_GPL(request_firmware_mapped_nowait);
+
 #ifdef CONFIG_PM_SLEEP
 static ASYNC_DOMAIN_EXCLUSIVE(fw_cache_domain);
 
@@ -1704,6 +1976,9 @@ static void __init fw_cache_init(void)
 static int __init firmware_class_init(void)
 {
 	fw_cache_init();
+	fw_load_stats_dentry = debugfs_create_file("firmware_loads", S_IRUGO,
+						   NULL, NULL,
+						   &fw_load_stats_fops);
 #ifdef CONFIG_FW_LOADER_USER_HELPER
 	register_reboot_notifier(&fw_shutdown_nb);
 	return class_register(&firmware_class);
@@ -1714,6 +1989,8 @@ static int __init firmware_class_init(void)
 
 static void __exit firmware_class_exit(void)
 {
+	debugfs_remove(fw_load_stats_dentry);
+	fw_load_stats_free();
 #ifdef CONFIG_PM_SLEEP
 	unregister_syscore_ops(&fw_syscore_ops);
 	unregister_pm_notifier(&fw_cache.pm_notify);
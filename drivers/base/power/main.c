@@ -29,6 +29,10 @@
 #include <linux/sched.h>
 #include <linux/async.h>
 #include <linux/suspend.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
 #include <trace/events/power.h>
 #include <linux/cpufreq.h>
 #include <linux/cpuidle.h>
@@ -62,6 +66,24 @@ static pm_message_t pm_transition;
 
 static int async_error;
 
+/* Set between dpm_prepare() and the end of dpm_complete(). */
+static bool dpm_transition;
+
+/*
+ * A PM supplier link makes the consumer resume after and suspend before the
+ * supplier, in addition to the ordering against its parent and children, so
+ * that both can be handled asynchronously.  Links are reference counted, as
+ * a consumer may get several handles to the same supplier, and protected by
+ * dpm_list_mtx.
+ */
+struct dpm_link {
+	struct device *supplier;
+	struct device *consumer;
+	struct list_head s_node;	/* in consumer->power.suppliers */
+	struct list_head c_node;	/* in supplier->power.consumers */
+	unsigned int count;
+};
+
 static char *pm_verb(int event)
 {
 	switch (event) {
@@ -100,6 +122,39 @@ void device_pm_sleep_init(struct device *dev)
 	complete_all(&dev->power.completion);
 	dev->power.wakeup = NULL;
 	INIT_LIST_HEAD(&dev->power.entry);
+	INIT_LIST_HEAD(&dev->power.suppliers);
+	INIT_LIST_HEAD(&dev->power.consumers);
+	dev->power.resume_blocker = NULL;
+	dev->power.async_suspend = IS_ENABLED(CONFIG_PM_SLEEP_ASYNC_DEFAULT);
+}
+
+static struct dpm_link *dpm_find_link(struct device *consumer,
+				      struct device *supplier)
+{
+	struct dpm_link *link;
+
+	list_for_each_entry(link, &consumer->power.suppliers, s_node)
+		if (link->supplier == supplier)
+			return link;
+
+	return NULL;
+}
+
+static void dpm_free_link(struct dpm_link *link)
+{
+	list_del(&link->s_node);
+	list_del(&link->c_node);
+	kfree(link);
+}
+
+static void dpm_remove_links(struct device *dev)
+{
+	struct dpm_link *link, *n;
+
+	list_for_each_entry_safe(link, n, &dev->power.suppliers, s_node)
+		dpm_free_link(link);
+	list_for_each_entry_safe(link, n, &dev->power.consumers, c_node)
+		dpm_free_link(link);
 }
 
 /**
@@ -146,6 +201,9 @@ void device_pm_remove(struct device *dev)
 	complete_all(&dev->power.completion);
 	mutex_lock(&dpm_list_mtx);
 	list_del_init(&dev->power.entry);
+	dpm_remove_links(dev);
+	put_device(dev->power.resume_blocker);
+	dev->power.resume_blocker = NULL;
 	mutex_unlock(&dpm_list_mtx);
 	device_wakeup_disable(dev);
 	pm_runtime_remove(dev);
@@ -191,6 +249,123 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
+/* Does @dev have to be resumed after @target, directly or not? */
+static bool dpm_depends_on(struct device *dev, struct device *target)
+{
+	struct dpm_link *link;
+
+	if (dev == target)
+		return true;
+
+	if (dev->parent && dpm_depends_on(dev->parent, target))
+		return true;
+
+	list_for_each_entry(link, &dev->power.suppliers, s_node)
+		if (dpm_depends_on(link->supplier, target))
+			return true;
+
+	return false;
+}
+
+static void dpm_reorder_to_tail(struct device *dev);
+
+static int dpm_reorder_child(struct device *dev, void *not_used)
+{
+	dpm_reorder_to_tail(dev);
+	return 0;
+}
+
+/*
+ * Move @dev and everything depending on it to the end of dpm_list, so that
+ * synchronous suspend and resume still follow the dependencies.
+ */
+static void dpm_reorder_to_tail(struct device *dev)
+{
+	struct dpm_link *link;
+
+	if (list_empty(&dev->power.entry))
+		return;
+
+	list_move_tail(&dev->power.entry, &dpm_list);
+	device_for_each_child(dev, NULL, dpm_reorder_child);
+	list_for_each_entry(link, &dev->power.consumers, c_node)
+		dpm_reorder_to_tail(link->consumer);
+}
+
+/**
+ * device_pm_add_supplier - Make a device's suspend/resume depend on another.
+ * @consumer: Device using a resource provided by @supplier.
+ * @supplier: Device providing the resource.
+ *
+ * Make the PM core resume @consumer after @supplier and suspend it before
+ * @supplier, also when either of them is handled asynchronously.  Every
+ * successful call has to be balanced by device_pm_remove_supplier(); links
+ * of a device going away are dropped when it is unregistered.
+ *
+ * Both devices must be registered and the link must not create a dependency
+ * loop.  A link added during a system transition only affects the ordering
+ * of asynchronous devices until the next one.
+ */
+int device_pm_add_supplier(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link, *new;
+	int error = 0;
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+
+	mutex_lock(&dpm_list_mtx);
+	link = dpm_find_link(consumer, supplier);
+	if (link) {
+		link->count++;
+		goto out;
+	}
+
+	if (list_empty(&consumer->power.entry) ||
+	    list_empty(&supplier->power.entry)) {
+		error = -ENODEV;
+		goto out;
+	}
+
+	if (dpm_depends_on(supplier, consumer)) {
+		error = -EINVAL;
+		goto out;
+	}
+
+	new->supplier = supplier;
+	new->consumer = consumer;
+	new->count = 1;
+	list_add_tail(&new->s_node, &consumer->power.suppliers);
+	list_add_tail(&new->c_node, &supplier->power.consumers);
+	new = NULL;
+
+	if (!dpm_transition)
+		dpm_reorder_to_tail(consumer);
+ out:
+	mutex_unlock(&dpm_list_mtx);
+	kfree(new);
+	return error;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_supplier);
+
+/**
+ * device_pm_remove_supplier - Drop a link added by device_pm_add_supplier().
+ * @consumer: Device using a resource provided by @supplier.
+ * @supplier: Device providing the resource.
+ */
+void device_pm_remove_supplier(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link;
+
+	mutex_lock(&dpm_list_mtx);
+	link = dpm_find_link(consumer, supplier);
+	if (link && !--link->count)
+		dpm_free_link(link);
+	mutex_unlock(&dpm_list_mtx);
+}
+EXPORT_SYMBOL_GPL(device_pm_remove_supplier);
+
 static ktime_t initcall_debug_start(struct device *dev, void *cb)
 {
 	ktime_t calltime = ktime_set(0, 0);
@@ -245,6 +420,77 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+static bool dpm_must_wait(struct device *dev, bool async)
+{
+	return (async || (pm_async_enabled && dev->power.async_suspend)) &&
+		!completion_done(&dev->power.completion);
+}
+
+/*
+ * dpm_list_mtx is dropped while waiting and links may change meanwhile, so
+ * the walk starts over after every wait.  Each device waited for has its
+ * completion done by then, so this terminates.
+ */
+static void dpm_wait_for_suppliers(struct device *dev, bool async)
+{
+	struct device *supplier;
+	struct dpm_link *link;
+
+	for (;;) {
+		supplier = NULL;
+		mutex_lock(&dpm_list_mtx);
+		list_for_each_entry(link, &dev->power.suppliers, s_node)
+			if (dpm_must_wait(link->supplier, async)) {
+				supplier = get_device(link->supplier);
+				break;
+			}
+		mutex_unlock(&dpm_list_mtx);
+
+		if (!supplier)
+			return;
+
+		wait_for_completion(&supplier->power.completion);
+		put_device(supplier);
+	}
+}
+
+static void dpm_wait_for_consumers(struct device *dev, bool async)
+{
+	struct device *consumer;
+	struct dpm_link *link;
+
+	for (;;) {
+		consumer = NULL;
+		mutex_lock(&dpm_list_mtx);
+		list_for_each_entry(link, &dev->power.consumers, c_node)
+			if (dpm_must_wait(link->consumer, async)) {
+				consumer = get_device(link->consumer);
+				break;
+			}
+		mutex_unlock(&dpm_list_mtx);
+
+		if (!consumer)
+			return;
+
+		wait_for_completion(&consumer->power.completion);
+		put_device(consumer);
+	}
+}
+
+/* Wait for the devices that have to be resumed before @dev. */
+static void dpm_wait_for_superior(struct device *dev, bool async)
+{
+	dpm_wait(dev->parent, async);
+	dpm_wait_for_suppliers(dev, async);
+}
+
+/* Wait for the devices that have to be suspended before @dev. */
+static void dpm_wait_for_subordinate(struct device *dev, bool async)
+{
+	dpm_wait_for_children(dev, async);
+	dpm_wait_for_consumers(dev, async);
+}
+
 /**
  * pm_op - Return the PM operation appropriate for given PM event.
  * @ops: PM operations to choose from.
@@ -489,7 +735,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state, bool asyn
 	if (!dev->power.is_noirq_suspended)
 		goto Out;
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
 
 	if (dev->pm_domain) {
 		info = "noirq power domain ";
@@ -619,7 +865,7 @@ static int device_resume_early(struct device *dev, pm_message_t state, bool asyn
 	if (!dev->power.is_late_suspended)
 		goto Out;
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
 
 	if (dev->pm_domain) {
 		info = "early power domain ";
@@ -726,6 +972,189 @@ void dpm_resume_start(pm_message_t state)
 }
 EXPORT_SYMBOL_GPL(dpm_resume_start);
 
+/*
+ * Remember which of the devices @dev had to wait for finished last, that is
+ * which one held up its resume, for the latency report.  A synchronous device
+ * comes with the synchronous device resumed before it preset as its blocker.
+ */
+static void dpm_note_blocker(struct device *dev)
+{
+	struct device *blocker = NULL, *parent = dev->parent;
+	ktime_t last = dev->power.resume_start;
+	struct dpm_link *link;
+
+	mutex_lock(&dpm_list_mtx);
+	if (parent && ktime_after(parent->power.resume_done, last)) {
+		blocker = parent;
+		last = parent->power.resume_done;
+	}
+	list_for_each_entry(link, &dev->power.suppliers, s_node)
+		if (ktime_after(link->supplier->power.resume_done, last)) {
+			blocker = link->supplier;
+			last = blocker->power.resume_done;
+		}
+	if (blocker) {
+		put_device(dev->power.resume_blocker);
+		dev->power.resume_blocker = get_device(blocker);
+	}
+	mutex_unlock(&dpm_list_mtx);
+}
+
+#define DPM_REPORT_NAME		40
+#define DPM_REPORT_MAX_PATH	64
+
+struct dpm_report_entry {
+	char name[DPM_REPORT_NAME];
+	char blocker[DPM_REPORT_NAME];
+	s64 start_us;		/* relative to the start of dpm_resume() */
+	s64 wait_us;		/* waiting for parent and suppliers */
+	s64 resume_us;		/* in the resume callbacks */
+	s64 done_us;
+	int path_pos;		/* position on the critical path, or -1 */
+};
+
+static struct dpm_report_entry *dpm_report;
+static unsigned int dpm_report_len;
+static unsigned int dpm_report_path_len;
+static s64 dpm_report_total_us;
+static DEFINE_MUTEX(dpm_report_mtx);
+
+static s64 dpm_report_us(ktime_t t, ktime_t base)
+{
+	return ktime_to_us(ktime_sub(t, base));
+}
+
+/*
+ * Record how long each device resumed by dpm_resume() took and what held it
+ * up.  The critical path is the chain of blockers ending in the device that
+ * finished last; speeding up anything off that path does not make resume
+ * any faster.
+ */
+static void dpm_resume_report(ktime_t starttime)
+{
+	struct device *path[DPM_REPORT_MAX_PATH];
+	struct dpm_report_entry *report, *e;
+	struct device *dev, *last = NULL;
+	unsigned int n = 0, path_len = 0, i;
+
+	mutex_lock(&dpm_list_mtx);
+	list_for_each_entry(dev, &dpm_prepared_list, power.entry) {
+		if (ktime_before(dev->power.resume_done, starttime))
+			continue;
+		n++;
+		if (!last || ktime_after(dev->power.resume_done,
+					 last->power.resume_done))
+			last = dev;
+	}
+
+	for (dev = last; dev && path_len < DPM_REPORT_MAX_PATH;
+	     dev = dev->power.resume_blocker) {
+		if (ktime_before(dev->power.resume_done, starttime))
+			break;
+		path[path_len++] = dev;
+	}
+
+	report = n ? vzalloc(n * sizeof(*report)) : NULL;
+	e = report;
+	list_for_each_entry(dev, &dpm_prepared_list, power.entry) {
+		struct device *blocker = dev->power.resume_blocker;
+
+		dev->power.resume_blocker = NULL;
+		if (report && !ktime_before(dev->power.resume_done, starttime)) {
+			strlcpy(e->name, dev_name(dev), DPM_REPORT_NAME);
+			if (blocker)
+				strlcpy(e->blocker, dev_name(blocker),
+					DPM_REPORT_NAME);
+			e->start_us = dpm_report_us(dev->power.resume_start,
+						    starttime);
+			e->wait_us = dpm_report_us(dev->power.resume_call,
+						   dev->power.resume_start);
+			e->resume_us = dpm_report_us(dev->power.resume_done,
+						     dev->power.resume_call);
+			e->done_us = dpm_report_us(dev->power.resume_done,
+						   starttime);
+			e->path_pos = -1;
+			for (i = 0; i < path_len; i++)
+				if (path[i] == dev)
+					e->path_pos = i;
+			e++;
+		}
+		put_device(blocker);
+	}
+	mutex_unlock(&dpm_list_mtx);
+
+	if (!report)
+		return;
+
+	mutex_lock(&dpm_report_mtx);
+	vfree(dpm_report);
+	dpm_report = report;
+	dpm_report_len = n;
+	dpm_report_path_len = path_len;
+	dpm_report_total_us = dpm_report_us(ktime_get(), starttime);
+	mutex_unlock(&dpm_report_mtx);
+}
+
+static void dpm_report_show_entry(struct seq_file *s,
+				  struct dpm_report_entry *e)
+{
+	seq_printf(s, "%-40s %-40s %9lld %9lld %9lld %9lld\n", e->name,
+		   e->blocker[0] ? e->blocker : "-", e->start_us, e->wait_us,
+		   e->resume_us, e->done_us);
+}
+
+static void dpm_report_show_header(struct seq_file *s)
+{
+	seq_printf(s, "%-40s %-40s %9s %9s %9s %9s\n", "device", "blocked by",
+		   "start_us", "wait_us", "resume_us", "done_us");
+}
+
+static int dpm_report_show(struct seq_file *s, void *unused)
+{
+	unsigned int i;
+	int pos;
+
+	mutex_lock(&dpm_report_mtx);
+	if (!dpm_report)
+		goto out;
+
+	seq_printf(s, "total: %lld us, %u devices\n\ncritical path:\n",
+		   dpm_report_total_us, dpm_report_len);
+	dpm_report_show_header(s);
+	for (pos = dpm_report_path_len - 1; pos >= 0; pos--)
+		for (i = 0; i < dpm_report_len; i++)
+			if (dpm_report[i].path_pos == pos)
+				dpm_report_show_entry(s, &dpm_report[i]);
+
+	seq_puts(s, "\nall devices:\n");
+	dpm_report_show_header(s);
+	for (i = 0; i < dpm_report_len; i++)
+		dpm_report_show_entry(s, &dpm_report[i]);
+ out:
+	mutex_unlock(&dpm_report_mtx);
+	return 0;
+}
+
+static int dpm_report_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_report_show, NULL);
+}
+
+static const struct file_operations dpm_report_fops = {
+	.open = dpm_report_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init dpm_report_debugfs_init(void)
+{
+	debugfs_create_file("pm_resume_latency", S_IRUGO, NULL, NULL,
+			    &dpm_report_fops);
+	return 0;
+}
+late_initcall(dpm_report_debugfs_init);
+
 /**
  * device_resume - Execute "resume" callbacks for given device.
  * @dev: Device to handle.
@@ -742,6 +1171,9 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
+	dev->power.resume_start = ktime_get();
+	dev->power.resume_call = dev->power.resume_start;
+
 	if (dev->power.syscore)
 		goto Complete;
 
@@ -751,7 +1183,9 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 		goto Complete;
 	}
 
-	dpm_wait(dev->parent, async);
+	dpm_wait_for_superior(dev, async);
+	dpm_note_blocker(dev);
+	dev->power.resume_call = ktime_get();
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
 
@@ -814,6 +1248,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	dpm_watchdog_clear(&wd);
 
  Complete:
+	dev->power.resume_done = ktime_get();
 	complete_all(&dev->power.completion);
 
 	TRACE_RESUME(error);
@@ -841,7 +1276,7 @@ static void async_resume(void *data, async_cookie_t cookie)
  */
 void dpm_resume(pm_message_t state)
 {
-	struct device *dev;
+	struct device *dev, *prev = NULL;
 	ktime_t starttime = ktime_get();
 
 	trace_suspend_resume(TPS("dpm_resume"), state.event, true);
@@ -865,6 +1300,9 @@ void dpm_resume(pm_message_t state)
 		if (!is_async(dev)) {
 			int error;
 
+			put_device(dev->power.resume_blocker);
+			dev->power.resume_blocker = prev;
+			prev = get_device(dev);
 			mutex_unlock(&dpm_list_mtx);
 
 			error = device_resume(dev, state, false);
@@ -881,9 +1319,11 @@ void dpm_resume(pm_message_t state)
 			list_move_tail(&dev->power.entry, &dpm_prepared_list);
 		put_device(dev);
 	}
+	put_device(prev);
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, NULL);
+	dpm_resume_report(starttime);
 
 	cpufreq_resume();
 	trace_suspend_resume(TPS("dpm_resume"), state.event, false);
@@ -965,6 +1405,7 @@ void dpm_complete(pm_message_t state)
 		put_device(dev);
 	}
 	list_splice(&list, &dpm_list);
+	dpm_transition = false;
 	mutex_unlock(&dpm_list_mtx);
 	trace_suspend_resume(TPS("dpm_complete"), state.event, false);
 }
@@ -1025,7 +1466,7 @@ static int __device_suspend_noirq(struct device *dev, pm_message_t state, bool a
 	TRACE_DEVICE(dev);
 	TRACE_SUSPEND(0);
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (async_error)
 		goto Complete;
@@ -1172,7 +1613,7 @@ static int __device_suspend_late(struct device *dev, pm_message_t state, bool as
 
 	__pm_runtime_disable(dev, false);
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (async_error)
 		goto Complete;
@@ -1357,7 +1798,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	TRACE_DEVICE(dev);
 	TRACE_SUSPEND(0);
 
-	dpm_wait_for_children(dev, async);
+	dpm_wait_for_subordinate(dev, async);
 
 	if (async_error) {
 		dev->power.direct_complete = false;
@@ -1646,6 +2087,7 @@ int dpm_prepare(pm_message_t state)
 	might_sleep();
 
 	mutex_lock(&dpm_list_mtx);
+	dpm_transition = true;
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.next);
 
@@ -148,6 +148,8 @@ struct regmap {
 	bool use_single_write;
 	/* if set, the device supports multi write mode */
 	bool can_multi_write;
+	/* if set, single register I/O uses the bus reg_read/reg_write */
+	bool fast_path;
 
 	/* if set, raw reads/writes are limited to this size */
 	size_t max_raw_read;
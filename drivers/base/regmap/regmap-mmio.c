@@ -194,6 +194,86 @@ static int regmap_mmio_read(void *context,
 	return 0;
 }
 
+/*
+ * Single register accessors, used by maps with config->mmio_fast_path set
+ * to skip register and value formatting.
+ */
+static int regmap_mmio_reg_read(void *context, unsigned int reg,
+				unsigned int *val)
+{
+	struct regmap_mmio_context *ctx = context;
+	int ret;
+
+	if (!IS_ERR(ctx->clk)) {
+		ret = clk_enable(ctx->clk);
+		if (ret < 0)
+			return ret;
+	}
+
+	switch (ctx->val_bytes) {
+	case 1:
+		*val = readb(ctx->regs + reg);
+		break;
+	case 2:
+		*val = readw(ctx->regs + reg);
+		break;
+	case 4:
+		*val = readl(ctx->regs + reg);
+		break;
+#ifdef CONFIG_64BIT
+	case 8:
+		*val = readq(ctx->regs + reg);
+		break;
+#endif
+	default:
+		/* Should be caught by regmap_mmio_check_config */
+		BUG();
+	}
+
+	if (!IS_ERR(ctx->clk))
+		clk_disable(ctx->clk);
+
+	return 0;
+}
+
+static int regmap_mmio_reg_write(void *context, unsigned int reg,
+				 unsigned int val)
+{
+	struct regmap_mmio_context *ctx = context;
+	int ret;
+
+	if (!IS_ERR(ctx->clk)) {
+		ret = clk_enable(ctx->clk);
+		if (ret < 0)
+			return ret;
+	}
+
+	switch (ctx->val_bytes) {
+	case 1:
+		writeb(val, ctx->regs + reg);
+		break;
+	case 2:
+		writew(val, ctx->regs + reg);
+		break;
+	case 4:
+		writel(val, ctx->regs + reg);
+		break;
+#ifdef CONFIG_64BIT
+	case 8:
+		writeq(val, ctx->regs + reg);
+		break;
+#endif
+	default:
+		/* Should be caught by regmap_mmio_check_config */
+		BUG();
+	}
+
+	if (!IS_ERR(ctx->clk))
+		clk_disable(ctx->clk);
+
+	return 0;
+}
+
 static void regmap_mmio_free_context(void *context)
 {
 	struct regmap_mmio_context *ctx = context;
@@ -210,6 +290,8 @@ static struct regmap_bus regmap_mmio = {
 	.write = regmap_mmio_write,
 	.gather_write = regmap_mmio_gather_write,
 	.read = regmap_mmio_read,
+	.reg_read = regmap_mmio_reg_read,
+	.reg_write = regmap_mmio_reg_write,
 	.free_context = regmap_mmio_free_context,
 	.reg_format_endian_default = REGMAP_ENDIAN_NATIVE,
 	.val_format_endian_default = REGMAP_ENDIAN_NATIVE,
@@ -998,6 +998,20 @@ skip_format_initialization:
 	if (ret != 0)
 		goto err_range;
 
+	if (config->mmio_fast_path) {
+		if (bus && bus->fast_io && bus->read && bus->write &&
+		    bus->reg_read && bus->reg_write &&
+		    val_endian == REGMAP_ENDIAN_NATIVE &&
+		    !map->read_flag_mask && !map->write_flag_mask &&
+		    !config->pad_bits && !map->reg_shift &&
+		    !config->num_ranges &&
+		    (map->cache_type == REGCACHE_NONE ||
+		     map->cache_type == REGCACHE_FLAT))
+			map->fast_path = true;
+		else
+			dev_warn(map->dev, "MMIO fast path not supported\n");
+	}
+
 	if (dev) {
 		ret = regmap_attach_dev(dev, map, config);
 		if (ret != 0)
@@ -1165,6 +1179,11 @@ int regmap_reinit_cache(struct regmap *map, const struct regmap_config *config)
 	map->precious_reg = config->precious_reg;
 	map->cache_type = config->cache_type;
 
+	/* the fast path only knows how to access a flat cache in place */
+	if (map->cache_type != REGCACHE_NONE &&
+	    map->cache_type != REGCACHE_FLAT)
+		map->fast_path = false;
+
 	regmap_debugfs_init(map, config->name);
 
 	map->cache_bypass = false;
@@ -1581,12 +1600,41 @@ static inline void *_regmap_map_get_context(struct regmap *map)
 	return (map->bus) ? map : map->bus_context;
 }
 
+/*
+ * Single register write on a fast path map, same semantics as the generic
+ * path below but with the flat cache accessed in place and no formatting.
+ */
+static int _regmap_fast_write(struct regmap *map, unsigned int reg,
+			      unsigned int val)
+{
+	unsigned int *cache = map->cache;
+
+	if (!regmap_writeable(map, reg))
+		return -EIO;
+
+	if (!map->cache_bypass) {
+		if (cache && !regmap_volatile(map, reg))
+			WRITE_ONCE(cache[reg], val);
+		if (map->cache_only) {
+			map->cache_dirty = true;
+			return 0;
+		}
+	}
+
+	trace_regmap_reg_write(map, reg, val);
+
+	return map->bus->reg_write(map->bus_context, reg, val);
+}
+
 int _regmap_write(struct regmap *map, unsigned int reg,
 		  unsigned int val)
 {
 	int ret;
 	void *context = _regmap_map_get_context(map);
 
+	if (map->fast_path)
+		return _regmap_fast_write(map, reg, val);
+
 	if (!regmap_writeable(map, reg))
 		return -EIO;
 
@@ -2323,12 +2371,45 @@ static int _regmap_bus_read(void *context, unsigned int reg,
 	return ret;
 }
 
+/*
+ * Single register read on a fast path map.  Nothing is written back to the
+ * cache, as a hardware read only happens for volatile registers or when
+ * the cache is bypassed.
+ */
+static int _regmap_fast_read(struct regmap *map, unsigned int reg,
+			     unsigned int *val)
+{
+	const unsigned int *cache = map->cache;
+	int ret;
+
+	if (cache && !READ_ONCE(map->cache_bypass) &&
+	    reg <= map->max_register && !regmap_volatile(map, reg)) {
+		*val = READ_ONCE(cache[reg]);
+		return 0;
+	}
+
+	if (READ_ONCE(map->cache_only))
+		return -EBUSY;
+
+	if (!regmap_readable(map, reg))
+		return -EIO;
+
+	ret = map->bus->reg_read(map->bus_context, reg, val);
+	if (ret == 0)
+		trace_regmap_reg_read(map, reg, *val);
+
+	return ret;
+}
+
 static int _regmap_read(struct regmap *map, unsigned int reg,
 			unsigned int *val)
 {
 	int ret;
 	void *context = _regmap_map_get_context(map);
 
+	if (map->fast_path)
+		return _regmap_fast_read(map, reg, val);
+
 	if (!map->cache_bypass) {
 		ret = regcache_read(map, reg, val);
 		if (ret == 0)
@@ -2374,6 +2455,16 @@ int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val)
 	if (reg % map->reg_stride)
 		return -EINVAL;
 
+	/*
+	 * A volatile register is a single bus access and a cached one a
+	 * single load from the flat cache, which is only ever updated in
+	 * place, so neither needs the lock.  The cache is bypassed while
+	 * regcache_sync() runs though, wait for it in that case.
+	 */
+	if (map->fast_path &&
+	    (!READ_ONCE(map->cache_bypass) || regmap_volatile(map, reg)))
+		return _regmap_fast_read(map, reg, val);
+
 	map->lock(map->lock_arg);
 
 	ret = _regmap_read(map, reg, val);
@@ -22,6 +22,10 @@ static const char * const backends[] = {
 	"lzo",
 #if IS_ENABLED(CONFIG_CRYPTO_LZ4)
 	"lz4",
+	/* any lz4fast(N) is accepted, these are just common settings */
+	"lz4fast(4)",
+	"lz4fast(8)",
+	"lz4fast(16)",
 #endif
 #if IS_ENABLED(CONFIG_CRYPTO_DEFLATE)
 	"deflate",
@@ -433,6 +433,11 @@ static int dmatest_func(void *data)
 	ktime_t			ktime;
 	s64			runtime = 0;
 	unsigned long long	total_len = 0;
+	ktime_t			submit_start;
+	s64			submit_time;
+	s64			submit_max = 0;
+	unsigned long long	submit_total = 0;
+	unsigned int		submitted = 0;
 
 	set_freezable();
 
@@ -587,6 +592,8 @@ static int dmatest_func(void *data)
 			um->bidi_cnt++;
 		}
 
+		/* from prep to issue_pending, where most drivers program the hw */
+		submit_start = ktime_get();
 		if (thread->type == DMA_MEMCPY)
 			tx = dev->device_prep_dma_memcpy(chan,
 							 dsts[0] + dst_off,
@@ -626,6 +633,11 @@ static int dmatest_func(void *data)
 		}
 		dma_async_issue_pending(chan);
 
+		submit_time = ktime_to_ns(ktime_sub(ktime_get(), submit_start));
+		submit_total += submit_time;
+		submit_max = max(submit_max, submit_time);
+		submitted++;
+
 		wait_event_freezable_timeout(thread->done_wait, done->done,
 					     msecs_to_jiffies(params->timeout));
 
@@ -707,6 +719,10 @@ err_thread_type:
 		current->comm, total_tests, failed_tests,
 		dmatest_persec(runtime, total_tests),
 		dmatest_KBs(runtime, total_len), ret);
+	if (submitted)
+		pr_info("%s: submit latency %llu ns average, %lld ns max\n",
+			current->comm, div_u64(submit_total, submitted),
+			submit_max);
 
 	/* terminate all transfers on specified channels */
 	if (ret || failed_tests)
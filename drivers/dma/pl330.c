@@ -250,6 +250,17 @@ enum pl330_byteswap {
  */
 #define MCODE_BUFF_PER_REQ	256
 
+/* Microcode programs kept per channel for repeated transfer shapes */
+#define MCODE_CACHE_PER_CHAN	4
+
+/*
+ * Every program starts with DMAMOV CCR, DMAMOV SAR, DMAMOV DAR, and no
+ * other instruction depends on the transfer addresses.  A cached program
+ * is reused by patching the immediates of these two DMAMOVs.
+ */
+#define MC_SAR_OFF	SZ_DMAMOV
+#define MC_DAR_OFF	(2 * SZ_DMAMOV)
+
 /* Use this _only_ to wait on transient states */
 #define UNTIL(t, s)	while (!(_state(t) & (s))) cpu_relax();
 
@@ -356,10 +367,34 @@ enum pl330_cond {
 
 struct dma_pl330_desc;
 
+/* Everything the microcode of a request depends on, but the addresses */
+struct _mc_key {
+	u32 ccr;
+	u32 bytes;
+	u32 num_periods;
+	u32 src_interlace_size;
+	u32 dst_interlace_size;
+	u8 rqtype;
+	u8 peri;
+	u8 cyclic;
+	u8 ev;
+};
+
+struct _mc_prog {
+	struct _mc_key key;
+	/* Bytes of microcode, 0 if the entry is unused */
+	unsigned len;
+	unsigned long last_used;
+	u8 *code;
+};
+
 struct _pl330_req {
 	u32 mc_bus;
 	void *mc_cpu;
 	struct dma_pl330_desc *desc;
+	/* Shape of the program currently in mc_cpu, if mc_len != 0 */
+	struct _mc_key mc_key;
+	unsigned mc_len;
 };
 
 /* ToBeDone for tasklet */
@@ -453,6 +488,11 @@ struct dma_pl330_chan {
 
 	/* for runtime pm tracking */
 	bool active;
+
+	/* Cached microcode, protected by the DMAC lock */
+	struct _mc_prog mc_cache[MCODE_CACHE_PER_CHAN];
+	unsigned long mc_clock;
+	u8 *mc_code;
 };
 
 struct pl330_dmac {
@@ -1587,6 +1627,93 @@ static int _setup_req(struct pl330_dmac *pl330, unsigned dry_run,
 	return off;
 }
 
+static inline void _patch_MOV(u8 buf[], unsigned off, u32 val)
+{
+	*((__le32 *)&buf[off + 2]) = cpu_to_le32(val);
+}
+
+static void _mc_key_init(struct _mc_key *key, const struct _xfer_spec *pxs,
+			 int ev)
+{
+	const struct dma_pl330_desc *desc = pxs->desc;
+
+	memset(key, 0, sizeof(*key));
+	key->ccr = pxs->ccr;
+	key->bytes = desc->px.bytes;
+	key->num_periods = desc->cyclic ? desc->num_periods : 0;
+	key->src_interlace_size = desc->src_interlace_size;
+	key->dst_interlace_size = desc->dst_interlace_size;
+	key->rqtype = desc->rqtype;
+	key->peri = desc->peri;
+	key->cyclic = desc->cyclic;
+	key->ev = ev;
+}
+
+/*
+ * Get the program for @key into req's buffer without generating it,
+ * either because the buffer still holds it from the previous request or
+ * from the channel's cache, and patch in the addresses of the xfer.
+ */
+static bool _mc_cached(struct dma_pl330_chan *pch, struct _pl330_req *req,
+		       const struct _mc_key *key, const struct pl330_xfer *x)
+{
+	struct _mc_prog *prog = NULL;
+	int i;
+
+	if (!req->mc_len || memcmp(&req->mc_key, key, sizeof(*key))) {
+		req->mc_len = 0;
+		for (i = 0; pch->mc_code && i < MCODE_CACHE_PER_CHAN; i++) {
+			if (pch->mc_cache[i].len &&
+			    !memcmp(&pch->mc_cache[i].key, key, sizeof(*key))) {
+				prog = &pch->mc_cache[i];
+				break;
+			}
+		}
+		if (!prog)
+			return false;
+
+		memcpy(req->mc_cpu, prog->code, prog->len);
+		req->mc_key = *key;
+		req->mc_len = prog->len;
+		prog->last_used = ++pch->mc_clock;
+	}
+
+	_patch_MOV(req->mc_cpu, MC_SAR_OFF, x->src_addr);
+	_patch_MOV(req->mc_cpu, MC_DAR_OFF, x->dst_addr);
+
+	return true;
+}
+
+/* Remember the program just generated in req's buffer, evicting the LRU */
+static void _mc_store(struct dma_pl330_chan *pch, struct _pl330_req *req,
+		      const struct _mc_key *key, unsigned len)
+{
+	const u8 *buf = req->mc_cpu;
+	struct _mc_prog *prog;
+	int i;
+
+	if (buf[MC_SAR_OFF] != CMD_DMAMOV || buf[MC_SAR_OFF + 1] != SAR ||
+	    buf[MC_DAR_OFF] != CMD_DMAMOV || buf[MC_DAR_OFF + 1] != DAR)
+		return;
+
+	req->mc_key = *key;
+	req->mc_len = len;
+
+	if (!pch->mc_code)
+		return;
+
+	prog = &pch->mc_cache[0];
+	for (i = 1; i < MCODE_CACHE_PER_CHAN && prog->len; i++)
+		if (!pch->mc_cache[i].len ||
+		    pch->mc_cache[i].last_used < prog->last_used)
+			prog = &pch->mc_cache[i];
+
+	memcpy(prog->code, buf, len);
+	prog->key = *key;
+	prog->len = len;
+	prog->last_used = ++pch->mc_clock;
+}
+
 static inline u32 _prepare_ccr(const struct pl330_reqcfg *rqc)
 {
 	u32 ccr = 0;
@@ -1628,7 +1755,9 @@ static int pl330_submit_req(struct pl330_thread *thrd,
 	struct dma_pl330_desc *desc)
 {
 	struct pl330_dmac *pl330 = thrd->dmac;
+	struct _pl330_req *req;
 	struct _xfer_spec xs;
+	struct _mc_key key;
 	unsigned long flags;
 	unsigned idx;
 	u32 ccr;
@@ -1666,26 +1795,32 @@ static int pl330_submit_req(struct pl330_thread *thrd,
 	ccr = _prepare_ccr(&desc->rqcfg);
 
 	idx = thrd->req[0].desc == NULL ? 0 : 1;
+	req = &thrd->req[idx];
 
 	xs.ccr = ccr;
 	xs.desc = desc;
 
-	/* First dry run to check if req is acceptable */
-	ret = _setup_req(pl330, 1, thrd, idx, &xs);
-	if (ret < 0)
-		goto xfer_exit;
+	_mc_key_init(&key, &xs, thrd->ev);
+	if (!_mc_cached(desc->pchan, req, &key, &desc->px)) {
+		/* First dry run to check if req is acceptable */
+		ret = _setup_req(pl330, 1, thrd, idx, &xs);
+		if (ret < 0)
+			goto xfer_exit;
+
+		if (ret > pl330->mcbufsz / 2) {
+			dev_info(pl330->ddma.dev, "%s:%d Try increasing mcbufsz (%i/%i)\n",
+					__func__, __LINE__, ret, pl330->mcbufsz / 2);
+			ret = -ENOMEM;
+			goto xfer_exit;
+		}
 
-	if (ret > pl330->mcbufsz / 2) {
-		dev_info(pl330->ddma.dev, "%s:%d Try increasing mcbufsz (%i/%i)\n",
-				__func__, __LINE__, ret, pl330->mcbufsz / 2);
-		ret = -ENOMEM;
-		goto xfer_exit;
+		_setup_req(pl330, 0, thrd, idx, &xs);
+		_mc_store(desc->pchan, req, &key, ret);
 	}
 
 	/* Hook the request */
 	thrd->lstenq = idx;
-	thrd->req[idx].desc = desc;
-	_setup_req(pl330, 0, thrd, idx, &xs);
+	req->desc = desc;
 
 	ret = 0;
 
@@ -2024,6 +2159,9 @@ static inline void _reset_thread(struct pl330_thread *thrd)
 				+ pl330->mcbufsz / 2;
 	thrd->req[1].desc = NULL;
 
+	thrd->req[0].mc_len = 0;
+	thrd->req[1].mc_len = 0;
+
 	thrd->req_running = -1;
 }
 
@@ -2329,6 +2467,12 @@ static int pl330_alloc_chan_resources(struct dma_chan *chan)
 	struct dma_pl330_chan *pch = to_pchan(chan);
 	struct pl330_dmac *pl330 = pch->dmac;
 	unsigned long flags;
+	u8 *mc_code;
+	int i;
+
+	/* Without it, programs are simply generated for every request */
+	mc_code = kmalloc_array(MCODE_CACHE_PER_CHAN, pl330->mcbufsz / 2,
+				GFP_KERNEL);
 
 	spin_lock_irqsave(&pl330->lock, flags);
 
@@ -2337,9 +2481,17 @@ static int pl330_alloc_chan_resources(struct dma_chan *chan)
 	pch->thread = pl330_request_channel(pl330);
 	if (!pch->thread) {
 		spin_unlock_irqrestore(&pl330->lock, flags);
+		kfree(mc_code);
 		return -ENOMEM;
 	}
 
+	pch->mc_code = mc_code;
+	for (i = 0; i < MCODE_CACHE_PER_CHAN; i++) {
+		pch->mc_cache[i].len = 0;
+		if (mc_code)
+			pch->mc_cache[i].code = mc_code + i * (pl330->mcbufsz / 2);
+	}
+
 	tasklet_init(&pch->task, pl330_tasklet, (unsigned long) pch);
 
 	spin_unlock_irqrestore(&pl330->lock, flags);
@@ -2452,6 +2604,7 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	struct dma_pl330_chan *pch = to_pchan(chan);
 	struct pl330_dmac *pl330 = pch->dmac;
 	unsigned long flags;
+	u8 *mc_code;
 
 	tasklet_kill(&pch->task);
 
@@ -2463,7 +2616,11 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 
 	list_splice_tail_init(&pch->work_list, &pch->dmac->desc_pool);
 
+	mc_code = pch->mc_code;
+	pch->mc_code = NULL;
+
 	spin_unlock_irqrestore(&pl330->lock, flags);
+	kfree(mc_code);
 	pm_runtime_mark_last_busy(pch->dmac->ddma.dev);
 	pm_runtime_put_autosuspend(pch->dmac->ddma.dev);
 }
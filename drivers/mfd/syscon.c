@@ -68,6 +68,9 @@ static struct syscon *of_syscon_register(struct device_node *np)
 		syscon_config.val_format_endian = REGMAP_ENDIAN_BIG;
 	 else if (of_property_read_bool(np, "little-endian"))
 		syscon_config.val_format_endian = REGMAP_ENDIAN_LITTLE;
+	else
+		/* plain native MMIO, reads need no locking */
+		syscon_config.mmio_fast_path = true;
 
 	regmap = regmap_init_mmio(NULL, base, &syscon_config);
 	if (IS_ERR(regmap)) {
@@ -1673,6 +1673,56 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
 	return chip->setup_read_retry(mtd, retry_mode);
 }
 
+/**
+ * nand_cache_read_last - [INTERN] Plan a sequential cache read
+ * @mtd: MTD device structure
+ * @chip: NAND chip descriptor
+ * @page: first page to read
+ * @col: column address within the first page
+ * @readlen: number of bytes left to read
+ *
+ * Returns the last page of a READ CACHE SEQUENTIAL run starting at @page, or
+ * -1 if the pages should be read one by one. Runs cover whole pages only and
+ * never leave the eraseblock of @page.
+ */
+static int nand_cache_read_last(struct mtd_info *mtd, struct nand_chip *chip,
+				int page, int col, uint32_t readlen)
+{
+	int pages_per_block = 1 << (chip->phys_erase_shift - chip->page_shift);
+	int last;
+
+	if (!NAND_HAS_CACHE_READ(chip) || col || readlen < 2 * mtd->writesize)
+		return -1;
+
+	last = page + (readlen >> chip->page_shift) - 1;
+	last = min(last, page | (pages_per_block - 1));
+
+	return last > page ? last : -1;
+}
+
+/**
+ * nand_cache_read_next - [INTERN] Move on to the next page of a cache read
+ * @mtd: MTD device structure
+ * @chip: NAND chip descriptor
+ * @page: page the chip holds in its data register
+ * @last: last page of the run
+ *
+ * Moves @page to the cache register for reading out and, unless it is the
+ * last one, makes the chip start loading the following page meanwhile.
+ * Returns the page now being loaded, or -1 once the run is over.
+ */
+static int nand_cache_read_next(struct mtd_info *mtd, struct nand_chip *chip,
+				int page, int last)
+{
+	if (page >= last) {
+		chip->cmdfunc(mtd, NAND_CMD_READCACHEEND, -1, -1);
+		return -1;
+	}
+
+	chip->cmdfunc(mtd, NAND_CMD_READCACHESEQ, -1, -1);
+	return page + 1;
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @mtd: MTD device structure
@@ -1697,6 +1747,8 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	/* page being loaded by a sequential cache read, and the run's last */
+	int cache_page = -1, cache_last = -1;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -1724,7 +1776,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			use_bufpoi = 0;
 
 		/* Is the current page in the buffer? */
-		if (realpage != chip->pagebuf || oob) {
+		if (realpage != chip->pagebuf || oob || page == cache_page) {
 			bufpoi = use_bufpoi ? chip->buffers->databuf : buf;
 
 			if (use_bufpoi && aligned)
@@ -1732,7 +1784,20 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+			if (page == cache_page) {
+				cache_page = nand_cache_read_next(mtd, chip,
+								  page,
+								  cache_last);
+			} else {
+				chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+
+				cache_last = (oob || retry_mode) ? -1 :
+					nand_cache_read_last(mtd, chip, page,
+							     col, readlen);
+				if (cache_last >= 0)
+					cache_page = nand_cache_read_next(mtd,
+							chip, page, cache_last);
+			}
 
 			/*
 			 * Now read the page into the buffer.  Absent an error,
@@ -1793,6 +1858,11 @@ read_retry:
 
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
+					/* Re-read this page on its own */
+					if (cache_page >= 0)
+						cache_page = nand_cache_read_next(mtd,
+								chip, cache_page,
+								cache_page);
 					retry_mode++;
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
@@ -1842,6 +1912,9 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+	/* Don't leave the chip in the middle of a cache read on errors */
+	if (cache_page >= 0)
+		nand_cache_read_next(mtd, chip, cache_page, cache_page);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -4338,6 +4411,16 @@ int nand_scan_tail(struct mtd_info *mtd)
 	/* Invalidate the pagebuffer reference */
 	chip->pagebuf = -1;
 
+	/*
+	 * Sequential cache reads need a large page chip implementing them,
+	 * and a read_page() that does not issue a READ0 of its own.
+	 */
+	if (mtd->writesize <= 512 || ecc->mode == NAND_ECC_HW_OOB_FIRST ||
+	    (chip->onfi_version &&
+	     !(le16_to_cpu(chip->onfi_params.opt_cmd) &
+	       ONFI_OPT_CMD_READ_CACHE)))
+		chip->options &= ~NAND_CACHE_READ;
+
 	/* Large page NAND with SOFT_ECC should support subpage reads */
 	switch (ecc->mode) {
 	case NAND_ECC_SOFT:
@@ -44,6 +44,7 @@
 #include <linux/pagemap.h>
 #include <linux/seq_file.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 
 /* Default simulator parameters values */
 #if !defined(CONFIG_NANDSIM_FIRST_ID_BYTE)  || \
@@ -107,6 +108,7 @@ static unsigned int overridesize = 0;
 static char *cache_file = NULL;
 static unsigned int bbt;
 static unsigned int bch;
+static unsigned int cache_read;
 static u_char id_bytes[8] = {
 	[0] = CONFIG_NANDSIM_FIRST_ID_BYTE,
 	[1] = CONFIG_NANDSIM_SECOND_ID_BYTE,
@@ -139,6 +141,7 @@ module_param(overridesize,   uint, 0400);
 module_param(cache_file,     charp, 0400);
 module_param(bbt,	     uint, 0400);
 module_param(bch,	     uint, 0400);
+module_param(cache_read,     uint, 0400);
 
 MODULE_PARM_DESC(id_bytes,       "The ID bytes returned by NAND Flash 'read ID' command");
 MODULE_PARM_DESC(first_id_byte,  "The first byte returned by NAND Flash 'read ID' command (manufacturer ID) (obsolete)");
@@ -174,6 +177,7 @@ MODULE_PARM_DESC(cache_file,     "File to use to cache nand pages instead of mem
 MODULE_PARM_DESC(bbt,		 "0 OOB, 1 BBT with marker in OOB, 2 BBT with marker in data area");
 MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 				 "be correctable in 512-byte blocks");
+MODULE_PARM_DESC(cache_read,     "Support READ CACHE SEQUENTIAL on large page chips if not zero");
 
 /* The largest possible page size */
 #define NS_LARGEST_PAGE_SIZE	4096
@@ -223,12 +227,14 @@ MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 #define STATE_CMD_READOOB      0x00000005 /* read OOB area */
 #define STATE_CMD_ERASE1       0x00000006 /* sector erase first command */
 #define STATE_CMD_STATUS       0x00000007 /* read status */
+#define STATE_CMD_READCACHESEQ 0x00000008 /* read cache sequential */
 #define STATE_CMD_SEQIN        0x00000009 /* sequential data input */
 #define STATE_CMD_READID       0x0000000A /* read ID */
 #define STATE_CMD_ERASE2       0x0000000B /* sector erase second command */
 #define STATE_CMD_RESET        0x0000000C /* reset */
 #define STATE_CMD_RNDOUT       0x0000000D /* random output command */
 #define STATE_CMD_RNDOUTSTART  0x0000000E /* random output start command */
+#define STATE_CMD_READCACHEEND 0x0000000F /* read cache end */
 #define STATE_CMD_MASK         0x0000000F /* command states mask */
 
 /* After an address is input, the simulator goes to one of these states */
@@ -260,9 +266,10 @@ MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 #define ACTION_ZEROOFF   0x00400000 /* don't add any offset to address */
 #define ACTION_HALFOFF   0x00500000 /* add to address half of page */
 #define ACTION_OOBOFF    0x00600000 /* add to address OOB offset */
+#define ACTION_CACHECPY  0x00700000 /* copy the page loaded by a cache read */
 #define ACTION_MASK      0x00700000 /* action mask */
 
-#define NS_OPER_NUM      13 /* Number of operations supported by the simulator */
+#define NS_OPER_NUM      15 /* Number of operations supported by the simulator */
 #define NS_OPER_STATES   6  /* Maximum number of states in operation */
 
 #define OPT_ANY          0xFFFFFFFF /* any chip supports this operation */
@@ -355,6 +362,13 @@ struct nandsim {
 		uint     off;     /* fixed page offset */
 	} regs;
 
+	/*
+	 * Sequential cache read: the page held in the data register (-1 if
+	 * none) and the time its load from the array completes.
+	 */
+	int cache_row;
+	ktime_t cache_ready;
+
 	/* NAND flash lines state */
         struct {
                 int ce;  /* chip Enable */
@@ -414,6 +428,10 @@ static struct nandsim_operations {
 	/* Large page devices random page read */
 	{OPT_LARGEPAGE, {STATE_CMD_RNDOUT, STATE_ADDR_COLUMN, STATE_CMD_RNDOUTSTART | ACTION_CPY,
 			       STATE_DATAOUT, STATE_READY}},
+	/* Large page devices read cache sequential */
+	{OPT_LARGEPAGE, {STATE_CMD_READCACHESEQ | ACTION_CACHECPY, STATE_DATAOUT, STATE_READY}},
+	/* Large page devices read cache end */
+	{OPT_LARGEPAGE, {STATE_CMD_READCACHEEND | ACTION_CACHECPY, STATE_DATAOUT, STATE_READY}},
 };
 
 struct weak_block {
@@ -1077,6 +1095,10 @@ static char *get_state_name(uint32_t state)
 			return "STATE_CMD_RNDOUT";
 		case STATE_CMD_RNDOUTSTART:
 			return "STATE_CMD_RNDOUTSTART";
+		case STATE_CMD_READCACHESEQ:
+			return "STATE_CMD_READCACHESEQ";
+		case STATE_CMD_READCACHEEND:
+			return "STATE_CMD_READCACHEEND";
 		case STATE_ADDR_PAGE:
 			return "STATE_ADDR_PAGE";
 		case STATE_ADDR_SEC:
@@ -1127,6 +1149,10 @@ static int check_command(int cmd)
 	case NAND_CMD_RNDOUTSTART:
 		return 0;
 
+	case NAND_CMD_READCACHESEQ:
+	case NAND_CMD_READCACHEEND:
+		return !cache_read;
+
 	default:
 		return 1;
 	}
@@ -1164,6 +1190,10 @@ static uint32_t get_state_by_command(unsigned command)
 			return STATE_CMD_RNDOUT;
 		case NAND_CMD_RNDOUTSTART:
 			return STATE_CMD_RNDOUTSTART;
+		case NAND_CMD_READCACHESEQ:
+			return STATE_CMD_READCACHESEQ;
+		case NAND_CMD_READCACHEEND:
+			return STATE_CMD_READCACHEEND;
 	}
 
 	NS_ERR("get_state_by_command: unknown command, BUG\n");
@@ -1653,6 +1683,50 @@ static int do_state_action(struct nandsim *ns, uint32_t action)
 		NS_UDELAY(access_delay);
 		NS_UDELAY(input_cycle * ns->geom.pgsz / 1000 / busdiv);
 
+		/* A page read may be followed by cache reads of the next ones */
+		if (ns->regs.command == NAND_CMD_READSTART) {
+			ns->cache_row = ns->regs.row;
+			ns->cache_ready = ktime_get();
+		}
+
+		break;
+
+	case ACTION_CACHECPY:
+		/*
+		 * Hand out the page in the data register and, for READ CACHE
+		 * SEQUENTIAL, start loading the next one.  The host only waits
+		 * for tR when it read the previous page out faster than the
+		 * array access takes.
+		 */
+		if (ns->cache_row < 0) {
+			NS_ERR("do_state_action: cache read without page read\n");
+			return -1;
+		}
+
+		if (do_delays) {
+			s64 wait = ktime_us_delta(ns->cache_ready, ktime_get());
+
+			if (wait > 0)
+				udelay(wait);
+		}
+
+		ns->regs.row = ns->cache_row;
+		num = ns->geom.pgszoob;
+		read_page(ns, num);
+
+		NS_LOG("cache read page %d\n", ns->regs.row);
+
+		NS_UDELAY(input_cycle * ns->geom.pgsz / 1000 / busdiv);
+
+		if (ns->regs.command == NAND_CMD_READCACHESEQ &&
+		    ns->cache_row + 1 < ns->geom.pgnum) {
+			ns->cache_row++;
+			ns->cache_ready = ktime_add_us(ktime_get(),
+						       access_delay);
+		} else {
+			ns->cache_row = -1;
+		}
+
 		break;
 
 	case ACTION_SECERASE:
@@ -1988,6 +2062,7 @@ static void ns_nand_write_byte(struct mtd_info *mtd, u_char byte)
 
 		if (byte == NAND_CMD_RESET) {
 			NS_LOG("reset chip\n");
+			ns->cache_row = -1;
 			switch_to_ready_state(ns, NS_STATUS_OK(ns));
 			return;
 		}
@@ -2002,6 +2077,11 @@ static void ns_nand_write_byte(struct mtd_info *mtd, u_char byte)
 			|| NS_STATE(ns->state) == STATE_DATAOUT) {
 			int row = ns->regs.row;
 
+			/* The page need not be read out before the next cache read */
+			if (byte == NAND_CMD_READCACHESEQ ||
+			    byte == NAND_CMD_READCACHEEND)
+				ns->regs.count = ns->regs.num;
+
 			switch_state(ns);
 			if (byte == NAND_CMD_RNDOUT)
 				ns->regs.row = row;
@@ -2260,6 +2340,8 @@ static int __init ns_init_module(void)
 	/* The NAND_SKIP_BBTSCAN option is necessary for 'overridesize' */
 	/* and 'badblocks' parameters to work */
 	chip->options   |= NAND_SKIP_BBTSCAN;
+	if (cache_read)
+		chip->options |= NAND_CACHE_READ;
 
 	switch (bbt) {
 	case 2:
@@ -2287,6 +2369,7 @@ static int __init ns_init_module(void)
 		nand->geom.idbytes = 2;
 	nand->regs.status = NS_STATUS_OK(nand);
 	nand->nxstate = STATE_UNKNOWN;
+	nand->cache_row = -1;
 	nand->options |= OPT_PAGE512; /* temporary value */
 	memcpy(nand->ids, id_bytes, sizeof(nand->ids));
 	if (bus_width == 16) {
@@ -19582,7 +19582,8 @@ dhd_linux_get_modfw_address(dhd_pub_t *dhd)
 		DHD_ERROR(("%s No module image name specified\n", __FUNCTION__));
 		return;
 	}
-	if (request_firmware(&module_fw, module_name, dhd_bus_to_dev(dhd->bus))) {
+	/* copied out below, no need for a private copy of the file first */
+	if (request_firmware_mapped(&module_fw, module_name, dhd_bus_to_dev(dhd->bus))) {
 		DHD_ERROR(("modules.img not available\n"));
 		return;
 	}
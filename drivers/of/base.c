@@ -20,6 +20,8 @@
 #include <linux/console.h>
 #include <linux/ctype.h>
 #include <linux/cpu.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_graph.h>
@@ -198,6 +200,12 @@ int __of_attach_node_sysfs(struct device_node *np)
 void __init of_core_init(void)
 {
 	struct device_node *np;
+	ktime_t start;
+
+	start = ktime_get();
+	of_populate_phandle_cache();
+	pr_debug("devicetree: phandle cache built in %lld us\n",
+		 ktime_us_delta(ktime_get(), start));
 
 	/* Create the kset, and register existing nodes */
 	mutex_lock(&of_mutex);
@@ -1083,6 +1091,82 @@ int of_modalias_node(struct device_node *node, char *modalias, int len)
 }
 EXPORT_SYMBOL_GPL(of_modalias_node);
 
+/*
+ * phandle -> node cache, indexed by the low bits of the phandle.  Entries
+ * hold no reference; they are only trusted after checking np->phandle under
+ * devtree_lock, and __of_detach_node() drops the entry of a node leaving
+ * the tree, so a miss or a stale slot just falls back to the full scan.
+ */
+static struct device_node **phandle_cache;
+static u32 phandle_cache_mask;
+
+/* Caller must hold devtree_lock. */
+void __of_free_phandle_cache_entry(phandle handle)
+{
+	u32 masked_handle = handle & phandle_cache_mask;
+
+	if (phandle_cache && handle &&
+	    phandle_cache[masked_handle] &&
+	    phandle_cache[masked_handle]->phandle == handle)
+		phandle_cache[masked_handle] = NULL;
+}
+
+void of_free_phandle_cache(void)
+{
+	struct device_node **cache;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&devtree_lock, flags);
+	cache = phandle_cache;
+	phandle_cache = NULL;
+	phandle_cache_mask = 0;
+	raw_spin_unlock_irqrestore(&devtree_lock, flags);
+
+	kfree(cache);
+}
+
+/**
+ * of_populate_phandle_cache - (Re)build the phandle lookup cache
+ *
+ * Sizes the cache to the number of phandles in the live tree, rounded up to
+ * a power of two, and fills it.  Called once the tree has been unflattened
+ * and again after an overlay changed the number of nodes.
+ */
+void of_populate_phandle_cache(void)
+{
+	struct device_node **cache, **old;
+	struct device_node *np;
+	unsigned long flags;
+	u32 cache_entries = 0;
+
+	raw_spin_lock_irqsave(&devtree_lock, flags);
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			cache_entries++;
+	raw_spin_unlock_irqrestore(&devtree_lock, flags);
+
+	if (!cache_entries) {
+		of_free_phandle_cache();
+		return;
+	}
+
+	cache_entries = roundup_pow_of_two(cache_entries);
+	cache = kcalloc(cache_entries, sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return;
+
+	raw_spin_lock_irqsave(&devtree_lock, flags);
+	old = phandle_cache;
+	phandle_cache = cache;
+	phandle_cache_mask = cache_entries - 1;
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			cache[np->phandle & phandle_cache_mask] = np;
+	raw_spin_unlock_irqrestore(&devtree_lock, flags);
+
+	kfree(old);
+}
+
 /**
  * of_find_node_by_phandle - Find a node given a phandle
  * @handle:	phandle of the node to find
@@ -1092,16 +1176,29 @@ EXPORT_SYMBOL_GPL(of_modalias_node);
  */
 struct device_node *of_find_node_by_phandle(phandle handle)
 {
-	struct device_node *np;
+	struct device_node *np = NULL;
 	unsigned long flags;
+	u32 masked_handle;
 
 	if (!handle)
 		return NULL;
 
 	raw_spin_lock_irqsave(&devtree_lock, flags);
-	for_each_of_allnodes(np)
-		if (np->phandle == handle)
-			break;
+
+	masked_handle = handle & phandle_cache_mask;
+	if (phandle_cache && phandle_cache[masked_handle] &&
+	    phandle_cache[masked_handle]->phandle == handle)
+		np = phandle_cache[masked_handle];
+
+	if (!np) {
+		for_each_of_allnodes(np)
+			if (np->phandle == handle) {
+				if (phandle_cache)
+					phandle_cache[masked_handle] = np;
+				break;
+			}
+	}
+
 	of_node_get(np);
 	raw_spin_unlock_irqrestore(&devtree_lock, flags);
 	return np;
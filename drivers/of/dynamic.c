@@ -282,6 +282,9 @@ void __of_detach_node(struct device_node *np)
 	}
 
 	of_node_set_flag(np, OF_DETACHED);
+
+	/* the node may be freed once detached, don't leave it in the cache */
+	__of_free_phandle_cache_entry(np->phandle);
 }
 
 /**
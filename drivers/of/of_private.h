@@ -81,6 +81,10 @@ extern int __of_attach_node_sysfs(struct device_node *np);
 extern void __of_detach_node(struct device_node *np);
 extern void __of_detach_node_sysfs(struct device_node *np);
 
+extern void of_populate_phandle_cache(void);
+extern void of_free_phandle_cache(void);
+extern void __of_free_phandle_cache_entry(phandle handle);
+
 extern void __of_sysfs_remove_bin_file(struct device_node *np,
 				       struct property *prop);
 
@@ -389,6 +389,9 @@ int of_overlay_create(struct device_node *tree)
 	/* add to the tail of the overlay list */
 	list_add_tail(&ov->node, &ov_list);
 
+	/* resize the phandle cache for the nodes the overlay brought in */
+	of_populate_phandle_cache();
+
 	mutex_unlock(&of_mutex);
 
 	return id;
@@ -517,6 +520,8 @@ int of_overlay_destroy(int id)
 	of_changeset_destroy(&ov->cset);
 	kfree(ov);
 
+	of_populate_phandle_cache();
+
 	err = 0;
 
 out:
@@ -548,6 +553,8 @@ int of_overlay_destroy_all(void)
 		kfree(ov);
 	}
 
+	of_populate_phandle_cache();
+
 	mutex_unlock(&of_mutex);
 
 	return 0;
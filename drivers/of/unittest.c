@@ -8,6 +8,7 @@
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/hashtable.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_fdt.h>
@@ -284,6 +285,58 @@ static void __init of_unittest_check_phandles(void)
 	}
 }
 
+static int __init of_unittest_lookup_phandles(void)
+{
+	struct device_node *np, *found;
+	int mismatch = 0;
+
+	for_each_of_allnodes(np) {
+		if (!np->phandle)
+			continue;
+
+		found = of_find_node_by_phandle(np->phandle);
+		if (found != np)
+			mismatch++;
+		of_node_put(found);
+	}
+	return mismatch;
+}
+
+static void __init of_unittest_phandle_cache(void)
+{
+	ktime_t start;
+	s64 cold, warm, uncached;
+	int mismatch;
+
+	/* testcase data was attached after the cache was built: fill misses */
+	start = ktime_get();
+	mismatch = of_unittest_lookup_phandles();
+	cold = ktime_us_delta(ktime_get(), start);
+	unittest(!mismatch, "%i cold phandle lookups returned the wrong node\n",
+		 mismatch);
+
+	start = ktime_get();
+	mismatch = of_unittest_lookup_phandles();
+	warm = ktime_us_delta(ktime_get(), start);
+	unittest(!mismatch, "%i cached phandle lookups returned the wrong node\n",
+		 mismatch);
+
+	of_free_phandle_cache();
+	start = ktime_get();
+	mismatch = of_unittest_lookup_phandles();
+	uncached = ktime_us_delta(ktime_get(), start);
+	unittest(!mismatch, "%i uncached phandle lookups returned the wrong node\n",
+		 mismatch);
+
+	of_populate_phandle_cache();
+	mismatch = of_unittest_lookup_phandles();
+	unittest(!mismatch, "%i phandle lookups wrong after repopulating\n",
+		 mismatch);
+
+	pr_info("phandle lookups: %lld us cold, %lld us cached, %lld us uncached\n",
+		cold, warm, uncached);
+}
+
 static void __init of_unittest_parse_phandle_with_args(void)
 {
 	struct device_node *np;
@@ -1958,6 +2011,7 @@ static int __init of_unittest(void)
 	pr_info("start of unittest - you will see error messages\n");
 	of_unittest_check_tree_linkage();
 	of_unittest_check_phandles();
+	of_unittest_phandle_cache();
 	of_unittest_find_node_by_name();
 	of_unittest_dynamic();
 	of_unittest_parse_phandle_with_args();
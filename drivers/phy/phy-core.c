@@ -389,6 +389,7 @@ EXPORT_SYMBOL_GPL(phy_cp_test);
 
 /**
  * _of_phy_get() - lookup and obtain a reference to a phy by phandle
+ * @dev: device that requests this phy, or NULL
  * @np: device_node for which to get the phy
  * @index: the index of the phy
  *
@@ -396,9 +397,11 @@ EXPORT_SYMBOL_GPL(phy_cp_test);
  * after getting a refcount to it or -ENODEV if there is no such phy or
  * -EPROBE_DEFER if there is a phandle to the phy, but the device is
  * not yet loaded. This function uses of_xlate call back function provided
- * while registering the phy_provider to find the phy instance.
+ * while registering the phy_provider to find the phy instance.  On
+ * -EPROBE_DEFER the phy provider is recorded as the supplier @dev waits for.
  */
-static struct phy *_of_phy_get(struct device_node *np, int index)
+static struct phy *_of_phy_get(struct device *dev, struct device_node *np,
+			       int index)
 {
 	int ret;
 	struct phy_provider *phy_provider;
@@ -434,21 +437,16 @@ out_put_module:
 
 out_unlock:
 	mutex_unlock(&phy_provider_mutex);
+	if (PTR_ERR(phy) == -EPROBE_DEFER)
+		driver_deferred_probe_supplier(dev, args.np);
 	of_node_put(args.np);
 
 	return phy;
 }
 
-/**
- * of_phy_get() - lookup and obtain a reference to a phy using a device_node.
- * @np: device_node for which to get the phy
- * @con_id: name of the phy from device's point of view
- *
- * Returns the phy driver, after getting a refcount to it; or
- * -ENODEV if there is no such phy. The caller is responsible for
- * calling phy_put() to release that count.
- */
-struct phy *of_phy_get(struct device_node *np, const char *con_id)
+/* of_phy_get() on behalf of @dev, or of no device if @dev is NULL */
+static struct phy *__of_phy_get(struct device *dev, struct device_node *np,
+				const char *con_id)
 {
 	struct phy *phy = NULL;
 	int index = 0;
@@ -456,7 +454,7 @@ struct phy *of_phy_get(struct device_node *np, const char *con_id)
 	if (con_id)
 		index = of_property_match_string(np, "phy-names", con_id);
 
-	phy = _of_phy_get(np, index);
+	phy = _of_phy_get(dev, np, index);
 	if (IS_ERR(phy))
 		return phy;
 
@@ -467,6 +465,20 @@ struct phy *of_phy_get(struct device_node *np, const char *con_id)
 
 	return phy;
 }
+
+/**
+ * of_phy_get() - lookup and obtain a reference to a phy using a device_node.
+ * @np: device_node for which to get the phy
+ * @con_id: name of the phy from device's point of view
+ *
+ * Returns the phy driver, after getting a refcount to it; or
+ * -ENODEV if there is no such phy. The caller is responsible for
+ * calling phy_put() to release that count.
+ */
+struct phy *of_phy_get(struct device_node *np, const char *con_id)
+{
+	return __of_phy_get(NULL, np, con_id);
+}
 EXPORT_SYMBOL_GPL(of_phy_get);
 
 /**
@@ -559,7 +571,7 @@ struct phy *phy_get(struct device *dev, const char *string)
 	if (dev->of_node) {
 		index = of_property_match_string(dev->of_node, "phy-names",
 			string);
-		phy = _of_phy_get(dev->of_node, index);
+		phy = _of_phy_get(dev, dev->of_node, index);
 	} else {
 		phy = phy_find(dev, string);
 	}
@@ -669,7 +681,7 @@ struct phy *devm_of_phy_get(struct device *dev, struct device_node *np,
 	if (!ptr)
 		return ERR_PTR(-ENOMEM);
 
-	phy = of_phy_get(np, con_id);
+	phy = __of_phy_get(dev, np, con_id);
 	if (!IS_ERR(phy)) {
 		*ptr = phy;
 		devres_add(dev, ptr);
@@ -702,7 +714,7 @@ struct phy *devm_of_phy_get_by_index(struct device *dev, struct device_node *np,
 	if (!ptr)
 		return ERR_PTR(-ENOMEM);
 
-	phy = _of_phy_get(np, index);
+	phy = _of_phy_get(dev, np, index);
 	if (IS_ERR(phy)) {
 		devres_free(ptr);
 		return phy;
@@ -1379,6 +1379,11 @@ static struct regulator *create_regulator(struct regulator_dev *rdev,
 		regulator->always_on = true;
 
 	mutex_unlock(&rdev->mutex);
+
+	/* Resume the consumer after the regulator; non-fatal */
+	if (dev && !device_pm_add_supplier(dev, &rdev->dev))
+		regulator->pm_supplier = true;
+
 	return regulator;
 overflow_err:
 	list_del(&regulator->list);
@@ -1458,6 +1463,8 @@ static struct regulator_dev *regulator_lookup_by_name(const char *name)
  * @supply: Supply name or regulator ID.
  * @ret: 0 on success, -ENODEV if lookup fails permanently, -EPROBE_DEFER if
  * lookup could succeed in the future.
+ * @supplier: if not NULL, set to the device tree node of the missing
+ * regulator when the lookup returns -EPROBE_DEFER for it.
  *
  * If successful, returns a struct regulator_dev that corresponds to the name
  * @supply and with the embedded struct device refcount incremented by one,
@@ -1465,7 +1472,8 @@ static struct regulator_dev *regulator_lookup_by_name(const char *name)
  */
 static struct regulator_dev *regulator_dev_lookup(struct device *dev,
 						  const char *supply,
-						  int *ret)
+						  int *ret,
+						  struct device_node **supplier)
 {
 	struct regulator_dev *r;
 	struct device_node *node;
@@ -1481,6 +1489,8 @@ static struct regulator_dev *regulator_dev_lookup(struct device *dev,
 			r = of_find_regulator_by_node(node);
 			if (r)
 				return r;
+			if (supplier)
+				*supplier = node;
 			*ret = -EPROBE_DEFER;
 			return NULL;
 		} else {
@@ -1534,7 +1544,7 @@ static int regulator_resolve_supply(struct regulator_dev *rdev)
 	if (rdev->supply)
 		return 0;
 
-	r = regulator_dev_lookup(dev, rdev->supply_name, &ret);
+	r = regulator_dev_lookup(dev, rdev->supply_name, &ret, NULL);
 	if (!r) {
 		if (ret == -ENODEV) {
 			/*
@@ -1590,7 +1600,9 @@ static struct regulator *_regulator_get(struct device *dev, const char *id,
 {
 	struct regulator_dev *rdev;
 	struct regulator *regulator = ERR_PTR(-EPROBE_DEFER);
+	struct device_node *supplier = NULL;
 	const char *devname = NULL;
+	bool optional;
 	int ret;
 
 	if (id == NULL) {
@@ -1606,12 +1618,24 @@ static struct regulator *_regulator_get(struct device *dev, const char *id,
 	else
 		ret = -EPROBE_DEFER;
 
-	rdev = regulator_dev_lookup(dev, id, &ret);
+	rdev = regulator_dev_lookup(dev, id, &ret, &supplier);
 	if (rdev)
 		goto found;
 
 	regulator = ERR_PTR(ret);
 
+	/*
+	 * A consumer can't do without a supply it didn't ask for as optional,
+	 * so its probe is going to defer on this one: tell the driver core
+	 * which regulator to wait for.  That covers the normal regulator_get()
+	 * path and the non-optional bulk supplies, which both pass
+	 * allow_dummy, as well as regulator_get_exclusive().  Misses of
+	 * optional supplies are often ignored, so they are never recorded.
+	 */
+	optional = !exclusive && !allow_dummy;
+	if (ret == -EPROBE_DEFER && supplier && !optional)
+		driver_deferred_probe_supplier(dev, supplier);
+
 	/*
 	 * If we have return value from dev_lookup fail, we do not expect to
 	 * succeed, so, quit with appropriate error value
@@ -1774,8 +1798,11 @@ static void _regulator_put(struct regulator *regulator)
 	debugfs_remove_recursive(regulator->debugfs);
 
 	/* remove any sysfs entries */
-	if (regulator->dev)
+	if (regulator->dev) {
 		sysfs_remove_link(&rdev->dev.kobj, regulator->supply_name);
+		if (regulator->pm_supplier)
+			device_pm_remove_supplier(regulator->dev, &rdev->dev);
+	}
 	mutex_lock(&rdev->mutex);
 	list_del(&regulator->list);
 
@@ -27,6 +27,7 @@ struct regulator {
 	struct list_head early_min_list;
 	unsigned int always_on:1;
 	unsigned int bypass:1;
+	unsigned int pm_supplier:1;	/* device_pm_add_supplier() succeeded */
 	int uA_load;
 	int min_uV;
 	int max_uV;
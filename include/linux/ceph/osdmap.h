@@ -39,6 +39,8 @@ struct ceph_pg_pool_info {
 	s64 write_tier; /* wins for read+write ops */
 	u64 flags;
 	char *name;
+
+	void *pg_cache;   /* cached acting sets, indexed by pg seed */
 };
 
 static inline bool ceph_can_shift_osds(struct ceph_pg_pool_info *pool)
@@ -84,6 +86,11 @@ struct ceph_pg_mapping {
 	};
 };
 
+struct ceph_pg_cache_stats {
+	u64 hits;
+	u64 misses;
+};
+
 struct ceph_osdmap {
 	struct ceph_fsid fsid;
 	u32 epoch;
@@ -111,6 +118,10 @@ struct ceph_osdmap {
 
 	struct mutex crush_scratch_mutex;
 	int crush_scratch_ary[CEPH_PG_MAX_SIZE * 3];
+
+	/* serializes writers of pool->pg_cache entries */
+	spinlock_t pg_cache_lock;
+	struct ceph_pg_cache_stats __percpu *pg_cache_stats;
 };
 
 static inline void ceph_oid_set_name(struct ceph_object_id *oid,
@@ -214,6 +225,7 @@ extern int ceph_calc_pg_acting(struct ceph_osdmap *osdmap,
 			       int *osds, int *primary);
 extern int ceph_calc_pg_primary(struct ceph_osdmap *osdmap,
 				struct ceph_pg pgid);
+extern void ceph_osdmap_precompute_pgs(struct ceph_osdmap *osdmap);
 
 extern struct ceph_pg_pool_info *ceph_pg_pool_by_id(struct ceph_osdmap *map,
 						    u64 id);
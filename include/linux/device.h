@@ -1059,6 +1059,8 @@ extern void device_release_driver(struct device *dev);
 extern int  __must_check device_attach(struct device *dev);
 extern int __must_check driver_attach(struct device_driver *drv);
 extern void device_initial_probe(struct device *dev);
+extern void driver_deferred_probe_supplier(struct device *dev,
+					   struct device_node *supplier);
 extern int __must_check device_reprobe(struct device *dev);
 
 /*
@@ -47,6 +47,12 @@ int request_firmware_nowait(
 	void (*cont)(const struct firmware *fw, void *context));
 int request_firmware_direct(const struct firmware **fw, const char *name,
 			    struct device *device);
+int request_firmware_mapped(const struct firmware **fw, const char *name,
+			    struct device *device);
+int request_firmware_mapped_nowait(
+	struct module *module, const char *name, struct device *device,
+	gfp_t gfp, void *context,
+	void (*cont)(const struct firmware *fw, void *context));
 
 void release_firmware(const struct firmware *fw);
 #else
@@ -75,5 +81,20 @@ static inline int request_firmware_direct(const struct firmware **fw,
 	return -EINVAL;
 }
 
+static inline int request_firmware_mapped(const struct firmware **fw,
+					  const char *name,
+					  struct device *device)
+{
+	return -EINVAL;
+}
+
+static inline int request_firmware_mapped_nowait(
+	struct module *module, const char *name, struct device *device,
+	gfp_t gfp, void *context,
+	void (*cont)(const struct firmware *fw, void *context))
+{
+	return -EINVAL;
+}
+
 #endif
 #endif
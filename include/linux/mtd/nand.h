@@ -97,6 +97,8 @@ extern int nand_unlock(struct mtd_info *mtd, loff_t ofs, uint64_t len);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
 
 #define NAND_CMD_NONE		-1
 
@@ -166,6 +168,7 @@ typedef enum {
 /* Macros to identify the above */
 #define NAND_HAS_CACHEPROG(chip) ((chip->options & NAND_CACHEPRG))
 #define NAND_HAS_SUBPAGE_READ(chip) ((chip->options & NAND_SUBPAGE_READ))
+#define NAND_HAS_CACHE_READ(chip) ((chip->options & NAND_CACHE_READ))
 
 /* Non chip related options */
 /* This option skips the bbt scan during initialization. */
@@ -189,6 +192,13 @@ typedef enum {
  * kmap'ed, vmalloc'ed highmem buffers being passed from upper layers
  */
 #define NAND_USE_BOUNCE_BUFFER	0x00100000
+/*
+ * The controller can issue READ CACHE SEQUENTIAL (31h) and READ CACHE END
+ * (3Fh) and read the page out after them without sending another READ0, so
+ * multi-page reads may overlap tR with the data transfer.  Cleared by
+ * nand_scan_tail() if the chip does not support cache reads.
+ */
+#define NAND_CACHE_READ		0x00200000
 
 /* Options set by nand scan */
 /* Nand scan has allocated controller struct */
@@ -224,6 +234,9 @@ struct nand_chip;
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
+/* ONFI optional commands READ CACHE supported? */
+#define ONFI_OPT_CMD_READ_CACHE		(1 << 1)
+
 /* ONFI optional commands SET/GET FEATURES supported? */
 #define ONFI_OPT_CMD_SET_GET_FEATURES	(1 << 2)
 
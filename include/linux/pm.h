@@ -574,6 +574,12 @@ struct dev_pm_info {
 	bool			wakeup_path:1;
 	bool			syscore:1;
 	bool			no_pm_callbacks:1;	/* Owned by the PM core */
+	struct list_head	suppliers;	/* Owned by the PM core */
+	struct list_head	consumers;	/* Ditto */
+	ktime_t			resume_start;	/* Ditto */
+	ktime_t			resume_call;	/* Ditto */
+	ktime_t			resume_done;	/* Ditto */
+	struct device		*resume_blocker;	/* Ditto */
 #else
 	unsigned int		should_wakeup:1;
 #endif
@@ -712,6 +718,10 @@ extern void __suspend_report_result(const char *function, void *fn, int ret);
 
 extern int device_pm_wait_for_dev(struct device *sub, struct device *dev);
 extern void dpm_for_each_dev(void *data, void (*fn)(struct device *, void *));
+extern int device_pm_add_supplier(struct device *consumer,
+				  struct device *supplier);
+extern void device_pm_remove_supplier(struct device *consumer,
+				      struct device *supplier);
 
 extern int pm_generic_prepare(struct device *dev);
 extern int pm_generic_suspend_late(struct device *dev);
@@ -756,6 +766,17 @@ static inline void dpm_for_each_dev(void *data, void (*fn)(struct device *, void
 {
 }
 
+static inline int device_pm_add_supplier(struct device *consumer,
+					 struct device *supplier)
+{
+	return 0;
+}
+
+static inline void device_pm_remove_supplier(struct device *consumer,
+					     struct device *supplier)
+{
+}
+
 #define pm_generic_prepare		NULL
 #define pm_generic_suspend_late		NULL
 #define pm_generic_suspend_noirq	NULL
@@ -162,6 +162,12 @@ typedef void (*regmap_unlock)(void *);
  *		  This field is a duplicate of a similar file in
  *		  'struct regmap_bus' and serves exact same purpose.
  *		   Use it only for "no-bus" cases.
+ * @mmio_fast_path: Only for MMIO maps with no cache or a flat cache and
+ *		  native endian values. regmap_read() of volatile or cached
+ *		  registers does not take the map lock, and single register
+ *		  reads, writes and read-modify-writes go straight to the bus
+ *		  without formatting. Ignored with a warning if the map does
+ *		  not qualify.
  * @max_register: Optional, specifies the maximum valid register index.
  * @wr_table:     Optional, points to a struct regmap_access_table specifying
  *                valid ranges for write access.
@@ -218,6 +224,7 @@ struct regmap_config {
 	int (*reg_write)(void *context, unsigned int reg, unsigned int val);
 
 	bool fast_io;
+	bool mmio_fast_path;
 
 	unsigned int max_register;
 	const struct regmap_access_table *wr_table;
@@ -103,6 +103,43 @@ struct rpcrdma_msg {
  */
 #define RPCRDMA_HDRLEN_MIN	(sizeof(__be32) * 7)
 
+/*
+ * RDMA-CM private data exchanged at connect time, so each peer learns
+ * the size of the other's inline receive buffers.  Peers that do not
+ * send it keep using their configured inline thresholds.
+ */
+struct rpcrdma_connect_private {
+	__be32	cp_magic;
+	u8	cp_version;
+	u8	cp_flags;
+	u8	cp_send_size;
+	u8	cp_recv_size;
+} __packed;
+
+#define rpcrdma_cmp_magic	cpu_to_be32(0xf6ab0e18)
+
+enum {
+	RPCRDMA_CMP_VERSION = 1,
+};
+
+/* Buffer sizes are carried in 1KB units, biased by one */
+static inline u8
+rpcrdma_encode_buffer_size(unsigned int size)
+{
+	size >>= 10;
+	if (size == 0)
+		size = 1;
+	if (size > 256)
+		size = 256;
+	return size - 1;
+}
+
+static inline unsigned int
+rpcrdma_decode_buffer_size(u8 val)
+{
+	return ((unsigned int)val + 1) << 10;
+}
+
 enum rpcrdma_errcode {
 	ERR_VERS = 1,
 	ERR_CHUNK = 2
@@ -383,6 +383,7 @@ struct xfrm_usersa_info {
 };
 
 #define XFRM_SA_XFLAG_DONT_ENCAP_DSCP	1
+#define XFRM_SA_XFLAG_PARALLEL		2
 
 struct xfrm_usersa_id {
 	xfrm_address_t			daddr;
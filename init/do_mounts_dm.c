@@ -9,6 +9,7 @@
 #include <linux/ctype.h>
 #include <linux/device-mapper.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/string.h>
 #include <linux/delay.h>
 
@@ -64,6 +65,10 @@
  *  2. The <num> field will be optional initially and assumed to be 1.
  *     Once all the scripts that set these fields have been set, it will
  *     be made mandatory.
+ *  3. Devices are set up concurrently.  A device whose table refers to
+ *     another dm device (dm-<minor>, /dev/mapper/... or <dm major>:<minor>)
+ *     waits until all the devices listed before it are ready, so stacked
+ *     devices must be listed after the devices they use, as above.
  */
 
 struct dm_setup_target {
@@ -99,6 +104,7 @@ static struct {
 } dm_setup_args __initdata;
 
 static __initdata int dm_early_setup;
+static ASYNC_DOMAIN_EXCLUSIVE(dm_init_domain);
 
 static int __init get_dm_option(struct dm_option *opt, const char *accept)
 {
@@ -342,105 +348,125 @@ parse_fail:
 	DMWARN("Invalid arguments supplied to dm=.");
 	return 0;
 }
+/*
+ * A device stacked on another dm= device has to wait for it.  The check
+ * is conservative: any reference that may be a dm device makes it wait.
+ */
+static bool __init dm_device_is_stacked(struct dm_device *dev,
+					unsigned int dm_major)
+{
+	struct dm_setup_target *target;
+	char devt[16];
+
+	snprintf(devt, sizeof(devt), "%u:", dm_major);
+	for (target = dev->target; target; target = target->next) {
+		if (strstr(target->params, "dm-") ||
+		    strstr(target->params, "/dev/mapper/") ||
+		    strstr(target->params, devt))
+			return true;
+	}
+	return false;
+}
 
-static void __init dm_setup_drives(void)
+static void __init dm_setup_device(void *data, async_cookie_t cookie)
 {
+	struct dm_device *dev = data;
 	struct mapped_device *md = NULL;
 	struct dm_table *table = NULL;
 	struct dm_setup_target *target;
-	struct dm_device *dev;
-	char *uuid;
 	fmode_t fmode = FMODE_READ;
-	struct dm_device *devices;
-
-	devices = dm_parse_args();
-
-	for (dev = devices; dev; dev = dev->next) {
-		if (dm_create(dev->minor, &md)) {
-			DMDEBUG("failed to create the device");
-			goto dm_create_fail;
-		}
-		DMDEBUG("created device '%s'", dm_device_name(md));
-
-		/*
-		 * In addition to flagging the table below, the disk must be
-		 * set explicitly ro/rw.
-		 */
-		set_disk_ro(dm_disk(md), dev->ro);
+	ktime_t start, loaded;
+	char *uuid;
 
-		if (!dev->ro)
-			fmode |= FMODE_WRITE;
-		if (dm_table_create(&table, fmode, dev->target_count, md)) {
-			DMDEBUG("failed to create the table");
-			goto dm_table_create_fail;
-		}
+	if (dm_create(dev->minor, &md)) {
+		DMDEBUG("failed to create the device");
+		goto dm_create_fail;
+	}
+	DMDEBUG("created device '%s'", dm_device_name(md));
+
+	if (dm_device_is_stacked(dev, dm_disk(md)->major))
+		async_synchronize_cookie_domain(cookie, &dm_init_domain);
+	start = ktime_get();
+
+	/*
+	 * In addition to flagging the table below, the disk must be
+	 * set explicitly ro/rw.
+	 */
+	set_disk_ro(dm_disk(md), dev->ro);
+
+	if (!dev->ro)
+		fmode |= FMODE_WRITE;
+	if (dm_table_create(&table, fmode, dev->target_count, md)) {
+		DMDEBUG("failed to create the table");
+		goto dm_table_create_fail;
+	}
 
-		dm_lock_md_type(md);
-
-		for (target = dev->target; target; target = target->next) {
-			DMINFO("adding target '%llu %llu %s %s'",
-			       (unsigned long long) target->begin,
-			       (unsigned long long) target->length,
-			       target->type, target->params);
-			if (dm_table_add_target(table, target->type,
-						target->begin,
-						target->length,
-						target->params)) {
-				DMDEBUG("failed to add the target"
-					" to the table");
-				goto add_target_fail;
-			}
-		}
-		if (dm_table_complete(table)) {
-			DMDEBUG("failed to complete the table");
-			goto table_complete_fail;
+	dm_lock_md_type(md);
+
+	for (target = dev->target; target; target = target->next) {
+		DMINFO("adding target '%llu %llu %s %s'",
+		       (unsigned long long) target->begin,
+		       (unsigned long long) target->length,
+		       target->type, target->params);
+		if (dm_table_add_target(table, target->type,
+					target->begin,
+					target->length,
+					target->params)) {
+			DMDEBUG("failed to add the target"
+				" to the table");
+			goto add_target_fail;
 		}
+	}
+	if (dm_table_complete(table)) {
+		DMDEBUG("failed to complete the table");
+		goto table_complete_fail;
+	}
+	loaded = ktime_get();
 
-		/* Suspend the device so that we can bind it to the table. */
-		if (dm_suspend(md, 0)) {
-			DMDEBUG("failed to suspend the device pre-bind");
-			goto suspend_fail;
-		}
+	/* Suspend the device so that we can bind it to the table. */
+	if (dm_suspend(md, 0)) {
+		DMDEBUG("failed to suspend the device pre-bind");
+		goto suspend_fail;
+	}
 
-		/* Initial table load: acquire type of table. */
-		dm_set_md_type(md, dm_table_get_type(table));
+	/* Initial table load: acquire type of table. */
+	dm_set_md_type(md, dm_table_get_type(table));
 
-		/* Setup md->queue to reflect md's type. */
-		if (dm_setup_md_queue(md)) {
-			DMWARN("unable to set up device queue for new table.");
-			goto setup_md_queue_fail;
-		}
+	/* Setup md->queue to reflect md's type. */
+	if (dm_setup_md_queue(md)) {
+		DMWARN("unable to set up device queue for new table.");
+		goto setup_md_queue_fail;
+	}
 
-		/*
-		 * Bind the table to the device. This is the only way
-		 * to associate md->map with the table and set the disk
-		 * capacity directly.
-		 */
-		if (dm_swap_table(md, table)) {  /* should return NULL. */
-			DMDEBUG("failed to bind the device to the table");
-			goto table_bind_fail;
-		}
+	/*
+	 * Bind the table to the device. This is the only way
+	 * to associate md->map with the table and set the disk
+	 * capacity directly.
+	 */
+	if (dm_swap_table(md, table)) {  /* should return NULL. */
+		DMDEBUG("failed to bind the device to the table");
+		goto table_bind_fail;
+	}
 
-		/* Finally, resume and the device should be ready. */
-		if (dm_resume(md)) {
-			DMDEBUG("failed to resume the device");
-			goto resume_fail;
-		}
+	/* Finally, resume and the device should be ready. */
+	if (dm_resume(md)) {
+		DMDEBUG("failed to resume the device");
+		goto resume_fail;
+	}
 
-		/* Export the dm device via the ioctl interface */
-		if (!strcmp(DM_NO_UUID, dev->uuid))
-			uuid = NULL;
-		if (dm_ioctl_export(md, dev->name, uuid)) {
-			DMDEBUG("failed to export device with given"
-				" name and uuid");
-			goto export_fail;
-		}
+	/* Export the dm device via the ioctl interface */
+	uuid = strcmp(DM_NO_UUID, dev->uuid) ? dev->uuid : NULL;
+	if (dm_ioctl_export(md, dev->name, uuid)) {
+		DMDEBUG("failed to export device with given"
+			" name and uuid");
+		goto export_fail;
+	}
 
-		dm_unlock_md_type(md);
+	dm_unlock_md_type(md);
 
-		DMINFO("dm-%d is ready", dev->minor);
-	}
-	dm_setup_cleanup(devices);
+	DMINFO("dm-%d is ready: table load %lld us, activation %lld us",
+	       dev->minor, ktime_us_delta(loaded, start),
+	       ktime_us_delta(ktime_get(), loaded));
 	return;
 
 export_fail:
@@ -456,6 +482,23 @@ dm_table_create_fail:
 dm_create_fail:
 	DMWARN("starting dm-%d (%s) failed",
 	       dev->minor, dev->name);
+}
+
+static void __init dm_setup_drives(void)
+{
+	struct dm_device *dev;
+	struct dm_device *devices;
+	ktime_t start = ktime_get();
+
+	devices = dm_parse_args();
+
+	for (dev = devices; dev; dev = dev->next)
+		async_schedule_domain(dm_setup_device, dev,
+				      &dm_init_domain);
+	async_synchronize_full_domain(&dm_init_domain);
+
+	DMINFO("device configuration took %lld ms",
+	       ktime_ms_delta(ktime_get(), start));
 	dm_setup_cleanup(devices);
 }
 
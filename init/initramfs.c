@@ -19,6 +19,10 @@
 #include <linux/syscalls.h>
 #include <linux/utime.h>
 #include <linux/initramfs.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/semaphore.h>
+#include <linux/ktime.h>
 
 static ssize_t __init xwrite(int fd, const char *p, size_t count)
 {
@@ -447,12 +451,239 @@ static unsigned long my_inptr; /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
 
+/*
+ * Segmented archives, as written by "gen_init_cpio -s", start with an
+ * uncompressed archive holding only SEGMENT_TABLE, one "<compressed size>
+ * <size>" line per segment, followed by the compressed segments.  Each
+ * segment is a complete archive ending at an entry boundary, so they can be
+ * decompressed on all CPUs at once.  They are still unpacked one after the
+ * other in archive order, so that directories exist before their contents
+ * and hard links find their targets just as with a single archive.
+ */
+#define SEGMENT_TABLE	"initramfs.segments"
+#define MAX_SEGMENTS	1024
+
+struct initramfs_segment {
+	char *in;
+	unsigned long in_len;
+	char *out;
+	unsigned long out_len;
+	unsigned long out_pos;
+	struct task_struct *worker;	/* while being decompressed */
+	struct completion done;
+};
+
+static __initdata struct initramfs_segment *segments;
+static __initdata unsigned int nr_segments;
+static __initdata atomic_t next_segment;
+/* limits the decompressed segments waiting to be unpacked */
+static __initdata struct semaphore segment_slots;
+
+static unsigned long __init cpio_field(const char *hdr, int i)
+{
+	char buf[9];
+
+	memcpy(buf, hdr + 6 + 8 * i, 8);
+	buf[8] = '\0';
+	return simple_strtoul(buf, NULL, 16);
+}
+
+/*
+ * Return the length of the segment table archive and the segments, or 0 if
+ * @buf does not start with a segment table.
+ */
+static unsigned long __init parse_segment_table(char *buf, unsigned long len)
+{
+	unsigned long name_len, body_len, off;
+	char *p, *end;
+	unsigned int i, nr = 0;
+
+	if (len < 110 || memcmp(buf, "070701", 6))
+		return 0;
+	name_len = cpio_field(buf, 11);
+	body_len = cpio_field(buf, 6);
+	if (name_len != sizeof(SEGMENT_TABLE) ||
+	    110 + N_ALIGN(name_len) + body_len > len ||
+	    memcmp(buf + 110, SEGMENT_TABLE, name_len))
+		return 0;
+
+	p = buf + 110 + N_ALIGN(name_len);
+	end = p + body_len;
+	for (off = 0; off < body_len; off++)
+		if (p[off] == '\n')
+			nr++;
+	if (!nr || nr > MAX_SEGMENTS || end[-1] != '\n')
+		goto broken;
+
+	/* skip the trailer and the padding up to the first segment */
+	off = (110 + N_ALIGN(name_len) + body_len + 3) & ~3;
+	if (off + 110 > len || memcmp(buf + off, "070701", 6))
+		goto broken;
+	off += 110 + N_ALIGN(cpio_field(buf + off, 11));
+	while (off < len && !buf[off])
+		off++;
+
+	segments = kcalloc(nr, sizeof(*segments), GFP_KERNEL);
+	if (!segments)
+		panic("can't allocate initramfs segment table");
+
+	for (i = 0; i < nr; i++) {
+		struct initramfs_segment *seg = &segments[i];
+
+		seg->in_len = simple_strtoul(skip_spaces(p), &p, 10);
+		seg->out_len = simple_strtoul(skip_spaces(p), &p, 10);
+		if (*p++ != '\n' || !seg->in_len || !seg->out_len ||
+		    seg->in_len > len - off) {
+			kfree(segments);
+			segments = NULL;
+			goto broken;
+		}
+		seg->in = buf + off;
+		off += seg->in_len;
+		init_completion(&seg->done);
+	}
+	nr_segments = nr;
+	return off;
+
+broken:
+	error("broken initramfs segment table");
+	return 0;
+}
+
+/*
+ * The decompressors' flush callback has no context argument, so it finds
+ * its segment by the worker decompressing it.  Output is copied into the
+ * segment buffer and rejected once it would exceed the size in the table.
+ */
+static long __init flush_segment(void *buf, unsigned long len)
+{
+	struct initramfs_segment *seg = NULL;
+	unsigned int i;
+
+	for (i = 0; i < nr_segments; i++) {
+		if (segments[i].worker == current) {
+			seg = &segments[i];
+			break;
+		}
+	}
+	if (!seg || len > seg->out_len - seg->out_pos)
+		return -1;
+
+	memcpy(seg->out + seg->out_pos, buf, len);
+	seg->out_pos += len;
+	return len;
+}
+
+static void __init decompress_segment(struct initramfs_segment *seg,
+				      decompress_fn decompress)
+{
+	long pos;
+
+	seg->worker = current;
+	if (decompress(seg->in, seg->in_len, NULL, flush_segment, NULL, &pos,
+		       error))
+		error("decompressor failed");
+	else if (seg->out_pos != seg->out_len)
+		error("initramfs segment shorter than its table entry");
+	seg->worker = NULL;
+}
+
+static void __init decompress_segments(struct work_struct *work)
+{
+	struct initramfs_segment *seg;
+	decompress_fn decompress;
+	const char *compress_name;
+	unsigned int i;
+
+	for (;;) {
+		/* take a slot first, so slots always go to the oldest segments */
+		down(&segment_slots);
+		i = atomic_inc_return(&next_segment) - 1;
+		if (i >= nr_segments) {
+			up(&segment_slots);
+			return;
+		}
+
+		seg = &segments[i];
+		decompress = decompress_method(seg->in, seg->in_len,
+					       &compress_name);
+		if (!message) {
+			seg->out = vmalloc(seg->out_len);
+			if (!seg->out)
+				error("can't allocate initramfs segment");
+			else if (!decompress)
+				error("initramfs segment compression method not configured");
+			else
+				decompress_segment(seg, decompress);
+		}
+		complete(&seg->done);
+	}
+}
+
+/*
+ * Decompress the segments of a segmented archive on all CPUs and unpack them
+ * in order.  Returns the number of bytes of @buf consumed, 0 if it does not
+ * start with a segment table.
+ */
+static unsigned long __init unpack_segments(char *buf, unsigned long len)
+{
+	struct work_struct *works;
+	unsigned int i, nr_workers;
+	unsigned long consumed;
+	ktime_t start = ktime_get();
+
+	consumed = parse_segment_table(buf, len);
+	if (!consumed)
+		return 0;
+
+	nr_workers = min(num_online_cpus(), nr_segments);
+	works = kcalloc(nr_workers, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		panic("can't allocate initramfs workers");
+
+	sema_init(&segment_slots, 2 * nr_workers);
+	atomic_set(&next_segment, 0);
+	for (i = 0; i < nr_workers; i++) {
+		INIT_WORK(&works[i], decompress_segments);
+		queue_work(system_unbound_wq, &works[i]);
+	}
+
+	for (i = 0; i < nr_segments; i++) {
+		struct initramfs_segment *seg = &segments[i];
+
+		wait_for_completion(&seg->done);
+		if (!message) {
+			state = Start;
+			this_header = 0;
+			flush_buffer(seg->out, seg->out_len);
+			if (state != Reset)
+				error("junk in compressed archive");
+		}
+		vfree(seg->out);
+		up(&segment_slots);
+	}
+
+	for (i = 0; i < nr_workers; i++)
+		flush_work(&works[i]);
+	kfree(works);
+
+	printk(KERN_INFO "Decompressed %u initramfs segments on %u CPUs in %lld ms\n",
+	       nr_segments, nr_workers,
+	       ktime_to_ms(ktime_sub(ktime_get(), start)));
+
+	kfree(segments);
+	segments = NULL;
+	return consumed;
+}
+
 static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 {
 	long written;
 	decompress_fn decompress;
 	const char *compress_name;
 	static __initdata char msg_buf[64];
+	unsigned long consumed, total = len;
+	ktime_t start = ktime_get();
 
 	header_buf = kmalloc(110, GFP_KERNEL);
 	symlink_buf = kmalloc(PATH_MAX + N_ALIGN(PATH_MAX) + 1, GFP_KERNEL);
@@ -464,6 +695,12 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 	state = Start;
 	this_header = 0;
 	message = NULL;
+
+	consumed = unpack_segments(buf, len);
+	buf += consumed;
+	len -= consumed;
+	this_header = consumed;
+
 	while (!message && len) {
 		loff_t saved_offset = this_header;
 		if (*buf == '0' && !(this_header & 3)) {
@@ -511,6 +748,9 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 	kfree(name_buf);
 	kfree(symlink_buf);
 	kfree(header_buf);
+
+	printk(KERN_INFO "Unpacked %lu byte initramfs in %lld ms\n", total,
+	       ktime_to_ms(ktime_sub(ktime_get(), start)));
 	return message;
 }
 
@@ -29,12 +29,14 @@
 #include <linux/ctype.h>
 #include <linux/genhd.h>
 #include <linux/ktime.h>
+#include <linux/crypto.h>
 #include <trace/events/power.h>
 
 #include "power.h"
 
 
 static int nocompress;
+char hib_comp_algo[CRYPTO_MAX_ALG_NAME] = CONFIG_HIBERNATION_DEF_COMP;
 static int noresume;
 static int nohibernate;
 static int resume_wait;
@@ -642,6 +644,24 @@ static void power_down(void)
 		cpu_relax();
 }
 
+/*
+ * hibernate_compressor_setup() runs before any compressor is registered,
+ * so the choice is checked here, while modules can still be loaded. LZO is
+ * always built in for hibernation and is used if the choice is missing.
+ */
+static void hibernate_check_compressor(void)
+{
+	if (nocompress || !strcmp(hib_comp_algo, "lzo"))
+		return;
+
+	if (crypto_has_comp(hib_comp_algo, 0, 0))
+		return;
+
+	pr_warn("PM: %s compressor not available, using lzo\n",
+		hib_comp_algo);
+	strlcpy(hib_comp_algo, "lzo", sizeof(hib_comp_algo));
+}
+
 /**
  * hibernate - Carry out system hibernation, including saving the image.
  */
@@ -672,6 +692,8 @@ int hibernate(void)
 	sys_sync();
 	printk("done.\n");
 
+	hibernate_check_compressor();
+
 	error = freeze_processes();
 	if (error)
 		goto Exit;
@@ -695,6 +717,9 @@ int hibernate(void)
 			flags |= SF_NOCOMPRESS_MODE;
 		else
 		        flags |= SF_CRC32_MODE;
+		/* lz4hc images are read back with the lz4 decompressor */
+		if (!nocompress && !strncmp(hib_comp_algo, "lz4", 3))
+			flags |= SF_COMPRESSION_ALG_LZ4;
 
 		pr_debug("PM: writing image.\n");
 		error = swsusp_write(flags);
@@ -1130,6 +1155,17 @@ static int __init hibernate_setup(char *str)
 	return 1;
 }
 
+static int __init hibernate_compressor_setup(char *str)
+{
+	if (!strcmp(str, "lzo") || !strcmp(str, "lz4") ||
+	    !strcmp(str, "lz4hc"))
+		strlcpy(hib_comp_algo, str, sizeof(hib_comp_algo));
+	else
+		pr_warn("PM: Unknown hibernation compressor %s, using %s\n",
+			str, hib_comp_algo);
+	return 1;
+}
+
 static int __init noresume_setup(char *str)
 {
 	noresume = 1;
@@ -1167,6 +1203,7 @@ __setup("noresume", noresume_setup);
 __setup("resume_offset=", resume_offset_setup);
 __setup("resume=", resume_setup);
 __setup("hibernate=", hibernate_setup);
+__setup("hibernate.compressor=", hibernate_compressor_setup);
 __setup("resumewait", resumewait_setup);
 __setup("resumedelay=", resumedelay_setup);
 __setup("nohibernate", nohibernate_setup);
@@ -158,8 +158,10 @@ extern int swsusp_swap_in_use(void);
 #define SF_PLATFORM_MODE	1
 #define SF_NOCOMPRESS_MODE	2
 #define SF_CRC32_MODE	        4
+#define SF_COMPRESSION_ALG_LZ4	8
 
 /* kernel/power/hibernate.c */
+extern char hib_comp_algo[];
 extern int swsusp_check(void);
 extern void swsusp_free(void);
 extern int swsusp_read(unsigned int *flags_p);
@@ -25,6 +25,7 @@
 #include <linux/pm.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/crypto.h>
 #include <linux/vmalloc.h>
 #include <linux/cpumask.h>
 #include <linux/atomic.h>
@@ -498,23 +499,31 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 }
 
 /* We need to remember how much compressed data we need to read. */
-#define LZO_HEADER	sizeof(size_t)
+#define CMP_HEADER	sizeof(size_t)
 
 /* Number of pages/bytes we'll compress at one time. */
-#define LZO_UNC_PAGES	32
-#define LZO_UNC_SIZE	(LZO_UNC_PAGES * PAGE_SIZE)
+#define UNC_PAGES	32
+#define UNC_SIZE	(UNC_PAGES * PAGE_SIZE)
 
-/* Number of pages/bytes we need for compressed data (worst case). */
-#define LZO_CMP_PAGES	DIV_ROUND_UP(lzo1x_worst_compress(LZO_UNC_SIZE) + \
-			             LZO_HEADER, PAGE_SIZE)
-#define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
+/*
+ * Number of pages/bytes we need for compressed data (worst case).  LZO has
+ * the largest worst-case expansion of the supported compressors.
+ */
+#define CMP_WORST(len)	lzo1x_worst_compress(len)
+#define CMP_PAGES	DIV_ROUND_UP(CMP_WORST(UNC_SIZE) + \
+			             CMP_HEADER, PAGE_SIZE)
+#define CMP_SIZE	(CMP_PAGES * PAGE_SIZE)
 
-/* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+/*
+ * Maximum number of threads for compression/decompression.  One thread is
+ * used per online CPU besides the one doing I/O, up to this limit, to bound
+ * the memory footprint (about 260k per thread).
+ */
+#define CMP_THREADS	8
 
 /* Minimum/maximum number of pages for read buffering. */
-#define LZO_MIN_RD_PAGES	1024
-#define LZO_MAX_RD_PAGES	8192
+#define CMP_MIN_RD_PAGES	1024
+#define CMP_MAX_RD_PAGES	8192
 
 
 /**
@@ -575,8 +584,8 @@ struct crc_data {
 	wait_queue_head_t go;                     /* start crc update */
 	wait_queue_head_t done;                   /* crc update done */
 	u32 *crc32;                               /* points to handle's crc32 */
-	size_t *unc_len[LZO_THREADS];             /* uncompressed lengths */
-	unsigned char *unc[LZO_THREADS];          /* uncompressed data */
+	size_t *unc_len[CMP_THREADS];             /* uncompressed lengths */
+	unsigned char *unc[CMP_THREADS];          /* uncompressed data */
 };
 
 /**
@@ -607,10 +616,11 @@ static int crc32_threadfn(void *data)
 	return 0;
 }
 /**
- * Structure used for LZO data compression.
+ * Structure used for data compression.
  */
 struct cmp_data {
 	struct task_struct *thr;                  /* thread */
+	struct crypto_comp *cc;                   /* crypto compressor */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
@@ -618,17 +628,17 @@ struct cmp_data {
 	wait_queue_head_t done;                   /* compression done */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
-	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
-	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
-	unsigned char wrk[LZO1X_1_MEM_COMPRESS];  /* compression workspace */
+	unsigned char unc[UNC_SIZE];              /* uncompressed buffer */
+	unsigned char cmp[CMP_SIZE];              /* compressed buffer */
 };
 
 /**
  * Compression function that runs in its own thread.
  */
-static int lzo_compress_threadfn(void *data)
+static int compress_threadfn(void *data)
 {
 	struct cmp_data *d = data;
+	unsigned int cmp_len;
 
 	while (1) {
 		wait_event(d->go, atomic_read(&d->ready) ||
@@ -642,9 +652,10 @@ static int lzo_compress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
-		                          d->cmp + LZO_HEADER, &d->cmp_len,
-		                          d->wrk);
+		cmp_len = CMP_SIZE - CMP_HEADER;
+		d->ret = crypto_comp_compress(d->cc, d->unc, d->unc_len,
+		                              d->cmp + CMP_HEADER, &cmp_len);
+		d->cmp_len = cmp_len;
 		atomic_set(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -652,14 +663,15 @@ static int lzo_compress_threadfn(void *data)
 }
 
 /**
- * save_image_lzo - Save the suspend image data compressed with LZO.
+ * save_compressed_image - Save the suspend image data compressed.
  * @handle: Swap map handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ * @algo: Name of the crypto API compressor to use.
  */
-static int save_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_write)
+static int save_compressed_image(struct swap_map_handle *handle,
+                                 struct snapshot_handle *snapshot,
+                                 unsigned int nr_to_write, const char *algo)
 {
 	unsigned int m;
 	int ret = 0;
@@ -681,24 +693,40 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	 * footprint.
 	 */
 	nr_threads = num_online_cpus() - 1;
-	nr_threads = clamp_val(nr_threads, 1, LZO_THREADS);
+	nr_threads = clamp_val(nr_threads, 1, CMP_THREADS);
 
 	page = (void *)__get_free_page(__GFP_RECLAIM | __GFP_HIGH);
 	if (!page) {
-		printk(KERN_ERR "PM: Failed to allocate LZO page\n");
+		printk(KERN_ERR "PM: Failed to allocate compression page\n");
 		ret = -ENOMEM;
 		goto out_clean;
 	}
 
 	data = vmalloc(sizeof(*data) * nr_threads);
 	if (!data) {
-		printk(KERN_ERR "PM: Failed to allocate LZO data\n");
+		printk(KERN_ERR "PM: Failed to allocate compression data\n");
 		ret = -ENOMEM;
 		goto out_clean;
 	}
 	for (thr = 0; thr < nr_threads; thr++)
 		memset(&data[thr], 0, offsetof(struct cmp_data, go));
 
+	if (!crypto_has_comp(algo, 0, 0)) {
+		printk(KERN_ERR "PM: %s compressor not available\n", algo);
+		ret = -ENOENT;
+		goto out_clean;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		data[thr].cc = crypto_alloc_comp(algo, 0, 0);
+		if (IS_ERR_OR_NULL(data[thr].cc)) {
+			printk(KERN_ERR "PM: Could not allocate %s compressor\n",
+			       algo);
+			data[thr].cc = NULL;
+			ret = -ENOMEM;
+			goto out_clean;
+		}
+	}
+
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
 		printk(KERN_ERR "PM: Failed to allocate crc\n");
@@ -714,7 +742,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_compress_threadfn,
+		data[thr].thr = kthread_run(compress_threadfn,
 		                            &data[thr],
 		                            "image_compress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -754,9 +782,9 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	handle->reqd_free_pages = reqd_free_pages();
 
 	printk(KERN_INFO
-		"PM: Using %u thread(s) for compression.\n"
+		"PM: Using %u thread(s) for %s compression.\n"
 		"PM: Compressing and saving image data (%u pages)...\n",
-		nr_threads, nr_to_write);
+		nr_threads, algo, nr_to_write);
 	m = nr_to_write / 10;
 	if (!m)
 		m = 1;
@@ -764,7 +792,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	start = ktime_get();
 	for (;;) {
 		for (thr = 0; thr < nr_threads; thr++) {
-			for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
+			for (off = 0; off < UNC_SIZE; off += PAGE_SIZE) {
 				ret = snapshot_read_next(snapshot);
 				if (ret < 0)
 					goto out_finish;
@@ -806,15 +834,16 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				printk(KERN_ERR "PM: LZO compression failed\n");
+				printk(KERN_ERR "PM: %s compression failed\n",
+				       algo);
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
-			             lzo1x_worst_compress(data[thr].unc_len))) {
+			             CMP_WORST(data[thr].unc_len))) {
 				printk(KERN_ERR
-				       "PM: Invalid LZO compressed length\n");
+				       "PM: Invalid compressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -830,7 +859,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			 * read it.
 			 */
 			for (off = 0;
-			     off < LZO_HEADER + data[thr].cmp_len;
+			     off < CMP_HEADER + data[thr].cmp_len;
 			     off += PAGE_SIZE) {
 				memcpy(page, data[thr].cmp + off, PAGE_SIZE);
 
@@ -859,9 +888,12 @@ out_clean:
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			if (data[thr].cc)
+				crypto_free_comp(data[thr].cc);
+		}
 		vfree(data);
 	}
 	if (page) free_page((unsigned long)page);
@@ -931,7 +963,8 @@ int swsusp_write(unsigned int flags)
 	if (!error) {
 		error = (flags & SF_NOCOMPRESS_MODE) ?
 			save_image(&handle, &snapshot, pages - 1) :
-			save_image_lzo(&handle, &snapshot, pages - 1);
+			save_compressed_image(&handle, &snapshot, pages - 1,
+					      hib_comp_algo);
 	}
 out_finish:
 	error = swap_writer_finish(&handle, flags, error);
@@ -1099,10 +1132,11 @@ static int load_image(struct swap_map_handle *handle,
 }
 
 /**
- * Structure used for LZO data decompression.
+ * Structure used for data decompression.
  */
 struct dec_data {
 	struct task_struct *thr;                  /* thread */
+	struct crypto_comp *cc;                   /* crypto decompressor */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
@@ -1110,16 +1144,17 @@ struct dec_data {
 	wait_queue_head_t done;                   /* decompression done */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
-	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
-	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
+	unsigned char unc[UNC_SIZE];              /* uncompressed buffer */
+	unsigned char cmp[CMP_SIZE];              /* compressed buffer */
 };
 
 /**
  * Deompression function that runs in its own thread.
  */
-static int lzo_decompress_threadfn(void *data)
+static int decompress_threadfn(void *data)
 {
 	struct dec_data *d = data;
+	unsigned int unc_len;
 
 	while (1) {
 		wait_event(d->go, atomic_read(&d->ready) ||
@@ -1133,9 +1168,10 @@ static int lzo_decompress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->unc_len = LZO_UNC_SIZE;
-		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
-		                               d->unc, &d->unc_len);
+		unc_len = UNC_SIZE;
+		d->ret = crypto_comp_decompress(d->cc, d->cmp + CMP_HEADER,
+		                                d->cmp_len, d->unc, &unc_len);
+		d->unc_len = unc_len;
 		if (clean_pages_on_decompress)
 			flush_icache_range((unsigned long)d->unc,
 					   (unsigned long)d->unc + d->unc_len);
@@ -1146,15 +1182,51 @@ static int lzo_decompress_threadfn(void *data)
 	return 0;
 }
 
+/*
+ * Queue reads of the next image pages into the free part of the read ring.
+ * Sets *eof once the end of the image data has been reached.
+ */
+static int hib_read_ring(struct swap_map_handle *handle,
+                         struct hib_bio_batch *hb, unsigned char **page,
+                         unsigned ring_size, unsigned *ring, unsigned *want,
+                         unsigned *asked, int *eof)
+{
+	unsigned i;
+	int ret = 0;
+
+	for (i = 0; !*eof && i < *want; i++) {
+		ret = swap_read_page(handle, page[*ring], hb);
+		if (ret) {
+			/*
+			 * On real read error, finish. On end of data,
+			 * set EOF flag and just exit the read loop.
+			 */
+			if (handle->cur &&
+			    handle->cur->entries[handle->k])
+				return ret;
+			ret = 0;
+			*eof = 1;
+			break;
+		}
+		if (++*ring >= ring_size)
+			*ring = 0;
+	}
+	*asked += i;
+	*want -= i;
+
+	return ret;
+}
+
 /**
- * load_image_lzo - Load compressed image data and decompress them with LZO.
+ * load_compressed_image - Load compressed image data and decompress them.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ * @algo: Name of the crypto API decompressor to use.
  */
-static int load_image_lzo(struct swap_map_handle *handle,
-                          struct snapshot_handle *snapshot,
-                          unsigned int nr_to_read)
+static int load_compressed_image(struct swap_map_handle *handle,
+                                 struct snapshot_handle *snapshot,
+                                 unsigned int nr_to_read, const char *algo)
 {
 	unsigned int m;
 	int ret = 0;
@@ -1162,6 +1234,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	struct hib_bio_batch hb;
 	ktime_t start;
 	ktime_t stop;
+	ktime_t t, io_time, dec_time, crc_time;
 	unsigned nr_pages;
 	size_t off;
 	unsigned i, thr, run_threads, nr_threads;
@@ -1179,24 +1252,43 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	 * footprint.
 	 */
 	nr_threads = num_online_cpus() - 1;
-	nr_threads = clamp_val(nr_threads, 1, LZO_THREADS);
+	nr_threads = clamp_val(nr_threads, 1, CMP_THREADS);
 
-	page = vmalloc(sizeof(*page) * LZO_MAX_RD_PAGES);
+	page = vmalloc(sizeof(*page) * CMP_MAX_RD_PAGES);
 	if (!page) {
-		printk(KERN_ERR "PM: Failed to allocate LZO page\n");
+		printk(KERN_ERR "PM: Failed to allocate decompression page\n");
 		ret = -ENOMEM;
 		goto out_clean;
 	}
 
 	data = vmalloc(sizeof(*data) * nr_threads);
 	if (!data) {
-		printk(KERN_ERR "PM: Failed to allocate LZO data\n");
+		printk(KERN_ERR "PM: Failed to allocate decompression data\n");
 		ret = -ENOMEM;
 		goto out_clean;
 	}
 	for (thr = 0; thr < nr_threads; thr++)
 		memset(&data[thr], 0, offsetof(struct dec_data, go));
 
+	/* the image says which decompressor it needs, it can't be changed */
+	if (!crypto_has_comp(algo, 0, 0)) {
+		printk(KERN_ERR
+		       "PM: %s decompressor not available, can't load image\n",
+		       algo);
+		ret = -ENOENT;
+		goto out_clean;
+	}
+	for (thr = 0; thr < nr_threads; thr++) {
+		data[thr].cc = crypto_alloc_comp(algo, 0, 0);
+		if (IS_ERR_OR_NULL(data[thr].cc)) {
+			printk(KERN_ERR
+			       "PM: Could not allocate %s decompressor\n", algo);
+			data[thr].cc = NULL;
+			ret = -ENOMEM;
+			goto out_clean;
+		}
+	}
+
 	crc = kmalloc(sizeof(*crc), GFP_KERNEL);
 	if (!crc) {
 		printk(KERN_ERR "PM: Failed to allocate crc\n");
@@ -1214,7 +1306,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
 
-		data[thr].thr = kthread_run(lzo_decompress_threadfn,
+		data[thr].thr = kthread_run(decompress_threadfn,
 		                            &data[thr],
 		                            "image_decompress/%u", thr);
 		if (IS_ERR(data[thr].thr)) {
@@ -1256,19 +1348,19 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	 */
 	if (low_free_pages() > snapshot_get_image_size())
 		read_pages = (low_free_pages() - snapshot_get_image_size()) / 2;
-	read_pages = clamp_val(read_pages, LZO_MIN_RD_PAGES, LZO_MAX_RD_PAGES);
+	read_pages = clamp_val(read_pages, CMP_MIN_RD_PAGES, CMP_MAX_RD_PAGES);
 
 	for (i = 0; i < read_pages; i++) {
-		page[i] = (void *)__get_free_page(i < LZO_CMP_PAGES ?
+		page[i] = (void *)__get_free_page(i < CMP_PAGES ?
 						  __GFP_RECLAIM | __GFP_HIGH :
 						  __GFP_RECLAIM | __GFP_NOWARN |
 						  __GFP_NORETRY);
 
 		if (!page[i]) {
-			if (i < LZO_CMP_PAGES) {
+			if (i < CMP_PAGES) {
 				ring_size = i;
 				printk(KERN_ERR
-				       "PM: Failed to allocate LZO pages\n");
+				       "PM: Failed to allocate read pages\n");
 				ret = -ENOMEM;
 				goto out_clean;
 			} else {
@@ -1279,41 +1371,26 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	want = ring_size = i;
 
 	printk(KERN_INFO
-		"PM: Using %u thread(s) for decompression.\n"
+		"PM: Using %u thread(s) for %s decompression.\n"
 		"PM: Loading and decompressing image data (%u pages)...\n",
-		nr_threads, nr_to_read);
+		nr_threads, algo, nr_to_read);
 	m = nr_to_read / 10;
 	if (!m)
 		m = 1;
 	nr_pages = 0;
+	io_time = dec_time = crc_time = ktime_set(0, 0);
 	start = ktime_get();
 
 	ret = snapshot_write_next(snapshot);
 	if (ret <= 0)
 		goto out_finish;
 
-	for(;;) {
-		for (i = 0; !eof && i < want; i++) {
-			ret = swap_read_page(handle, page[ring], &hb);
-			if (ret) {
-				/*
-				 * On real read error, finish. On end of data,
-				 * set EOF flag and just exit the read loop.
-				 */
-				if (handle->cur &&
-				    handle->cur->entries[handle->k]) {
-					goto out_finish;
-				} else {
-					eof = 1;
-					break;
-				}
-			}
-			if (++ring >= ring_size)
-				ring = 0;
-		}
-		asked += i;
-		want -= i;
+	ret = hib_read_ring(handle, &hb, page, ring_size, &ring, &want,
+	                    &asked, &eof);
+	if (ret)
+		goto out_finish;
 
+	for(;;) {
 		/*
 		 * We are out of data, wait for some more.
 		 */
@@ -1321,7 +1398,9 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			if (!asked)
 				break;
 
+			t = ktime_get();
 			ret = hib_wait_io(&hb);
+			io_time = ktime_add(io_time, ktime_sub(ktime_get(), t));
 			if (ret)
 				goto out_finish;
 			have += asked;
@@ -1331,7 +1410,9 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		}
 
 		if (crc->run_threads) {
+			t = ktime_get();
 			wait_event(crc->done, atomic_read(&crc->stop));
+			crc_time = ktime_add(crc_time, ktime_sub(ktime_get(), t));
 			atomic_set(&crc->stop, 0);
 			crc->run_threads = 0;
 		}
@@ -1340,14 +1421,14 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			data[thr].cmp_len = *(size_t *)page[pg];
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
-			             lzo1x_worst_compress(LZO_UNC_SIZE))) {
+			             CMP_WORST(UNC_SIZE))) {
 				printk(KERN_ERR
-				       "PM: Invalid LZO compressed length\n");
+				       "PM: Invalid compressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
 
-			need = DIV_ROUND_UP(data[thr].cmp_len + LZO_HEADER,
+			need = DIV_ROUND_UP(data[thr].cmp_len + CMP_HEADER,
 			                    PAGE_SIZE);
 			if (need > have) {
 				if (eof > 1) {
@@ -1358,7 +1439,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			}
 
 			for (off = 0;
-			     off < LZO_HEADER + data[thr].cmp_len;
+			     off < CMP_HEADER + data[thr].cmp_len;
 			     off += PAGE_SIZE) {
 				memcpy(data[thr].cmp + off,
 				       page[pg], PAGE_SIZE);
@@ -1372,11 +1453,22 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			wake_up(&data[thr].go);
 		}
 
+		/*
+		 * Refill the ring slots just handed to the threads, so that
+		 * the reads proceed while we are decompressing.
+		 */
+		ret = hib_read_ring(handle, &hb, page, ring_size, &ring, &want,
+		                    &asked, &eof);
+		if (ret)
+			goto out_finish;
+
 		/*
 		 * Wait for more data while we are decompressing.
 		 */
-		if (have < LZO_CMP_PAGES && asked) {
+		if (have < CMP_PAGES && asked) {
+			t = ktime_get();
 			ret = hib_wait_io(&hb);
+			io_time = ktime_add(io_time, ktime_sub(ktime_get(), t));
 			if (ret)
 				goto out_finish;
 			have += asked;
@@ -1386,23 +1478,25 @@ static int load_image_lzo(struct swap_map_handle *handle,
 		}
 
 		for (run_threads = thr, thr = 0; thr < run_threads; thr++) {
+			t = ktime_get();
 			wait_event(data[thr].done,
 			           atomic_read(&data[thr].stop));
+			dec_time = ktime_add(dec_time, ktime_sub(ktime_get(), t));
 			atomic_set(&data[thr].stop, 0);
 
 			ret = data[thr].ret;
 
 			if (ret < 0) {
 				printk(KERN_ERR
-				       "PM: LZO decompression failed\n");
+				       "PM: %s decompression failed\n", algo);
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].unc_len ||
-			             data[thr].unc_len > LZO_UNC_SIZE ||
+			             data[thr].unc_len > UNC_SIZE ||
 			             data[thr].unc_len & (PAGE_SIZE - 1))) {
 				printk(KERN_ERR
-				       "PM: Invalid LZO uncompressed length\n");
+				       "PM: Invalid uncompressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -1436,7 +1530,9 @@ static int load_image_lzo(struct swap_map_handle *handle,
 
 out_finish:
 	if (crc->run_threads) {
+		t = ktime_get();
 		wait_event(crc->done, atomic_read(&crc->stop));
+		crc_time = ktime_add(crc_time, ktime_sub(ktime_get(), t));
 		atomic_set(&crc->stop, 0);
 	}
 	stop = ktime_get();
@@ -1456,6 +1552,12 @@ out_finish:
 		}
 	}
 	swsusp_show_speed(start, stop, nr_to_read, "Read");
+	/* Time not spent waiting is copying pages into place */
+	printk(KERN_INFO
+	       "PM: Image loading took %lld ms: waited %lld ms for I/O, "
+	       "%lld ms for decompression, %lld ms for CRC32\n",
+	       ktime_ms_delta(stop, start), ktime_to_ms(io_time),
+	       ktime_to_ms(dec_time), ktime_to_ms(crc_time));
 out_clean:
 	for (i = 0; i < ring_size; i++)
 		free_page((unsigned long)page[i]);
@@ -1465,9 +1567,12 @@ out_clean:
 		kfree(crc);
 	}
 	if (data) {
-		for (thr = 0; thr < nr_threads; thr++)
+		for (thr = 0; thr < nr_threads; thr++) {
 			if (data[thr].thr)
 				kthread_stop(data[thr].thr);
+			if (data[thr].cc)
+				crypto_free_comp(data[thr].cc);
+		}
 		vfree(data);
 	}
 	vfree(page);
@@ -1501,7 +1606,9 @@ int swsusp_read(unsigned int *flags_p)
 	if (!error) {
 		error = (*flags_p & SF_NOCOMPRESS_MODE) ?
 			load_image(&handle, &snapshot, header->pages - 1) :
-			load_image_lzo(&handle, &snapshot, header->pages - 1);
+			load_compressed_image(&handle, &snapshot, header->pages - 1,
+					      *flags_p & SF_COMPRESSION_ALG_LZ4 ?
+					      "lz4" : "lzo");
 	}
 	swap_reader_finish(&handle);
 end:
@@ -45,8 +45,12 @@
  * Encoding is performed by processing 32 input bits in parallel, using 4
  * remainder lookup tables.
  *
+ * Decoding returns immediately when received and calculated ecc match, which
+ * is by far the most common case on NAND flash pages.
+ *
  * The final stage of decoding involves the following internal steps:
- * a. Syndrome computation
+ * a. Syndrome computation, processing 8 ecc bits at a time with Horner's rule
+ *    and one 256-entry lookup table per odd syndrome
  * b. Error locator polynomial computation using Berlekamp-Massey algorithm
  * c. Error locator root finding (by far the most expensive step)
  *
@@ -332,24 +336,17 @@ static inline int a_ilog(struct bch_control *bch, unsigned int x)
 }
 
 /*
- * compute 2t syndromes of ecc polynomial, i.e. ecc(a^j) for j=1..2t
+ * compute odd syndromes of a sparse ecc polynomial, one set bit at a time
  */
-static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
-			      unsigned int *syn)
+static void compute_syndromes_bits(struct bch_control *bch, uint32_t *ecc,
+				   unsigned int *syn)
 {
 	int i, j, s;
-	unsigned int m;
 	uint32_t poly;
 	const int t = GF_T(bch);
 
 	s = bch->ecc_bits;
 
-	/* make sure extra bits in last ecc word are cleared */
-	m = ((unsigned int)s) & 31;
-	if (m)
-		ecc[s/32] &= ~((1u << (32-m))-1);
-	memset(syn, 0, 2*t*sizeof(*syn));
-
 	/* compute v(a^j) for j=1 .. 2t-1 */
 	do {
 		poly = *ecc++;
@@ -362,10 +359,83 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 			poly ^= (1 << i);
 		}
 	} while (s > 0);
+}
+
+/*
+ * compute odd syndromes of a dense ecc polynomial, 8 bits at a time
+ */
+static void compute_syndromes_bytes(struct bch_control *bch, uint32_t *ecc,
+				    unsigned int *syn)
+{
+	int i, k;
+	unsigned int v, e8, b, pad;
+	const uint16_t *tab;
+	const int t = GF_T(bch);
+	const int l = 4*BCH_ECC_WORDS(bch);
+
+	/*
+	 * compute v(a^j) for j=1 .. 2t-1, using Horner's rule on ecc bytes:
+	 * v(a^j) = v(a^j).a^(8j)+tab_j[byte]; odd syndromes are independent,
+	 * so updating all of them for each byte keeps the multiplications
+	 * out of a single dependency chain
+	 */
+	for (k = 0; k < l; k++) {
+		b = (ecc[k/4] >> (24-8*(k & 3))) & 0xff;
+		tab = bch->syn_tab+b;
+		for (i = 0, e8 = 8; i < t; i++, tab += 256) {
+			v = syn[2*i];
+			if (v)
+				v = bch->a_pow_tab[mod_s(bch, a_log(bch, v)+e8)];
+			syn[2*i] = v^*tab;
+			e8 = mod_s(bch, e8+16);
+		}
+	}
+	/*
+	 * the (32*words-ecc_bits) zero padding bits at the end of the last
+	 * word multiplied v(a^j) by a^(j*pad), divide it out
+	 */
+	pad = 8*l-bch->ecc_bits;
+	for (i = 0; pad && (i < t); i++) {
+		v = syn[2*i];
+		if (v)
+			syn[2*i] = bch->a_pow_tab[mod_s(bch, a_log(bch, v)+
+					GF_N(bch)-modulo(bch, (2*i+1)*pad))];
+	}
+}
+
+/*
+ * compute 2t syndromes of ecc polynomial, i.e. ecc(a^j) for j=1..2t
+ */
+static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
+			      unsigned int *syn)
+{
+	int i, w;
+	unsigned int m;
+	const int t = GF_T(bch);
+	const int l = BCH_ECC_WORDS(bch);
+
+	/* make sure extra bits in last ecc word are cleared */
+	m = bch->ecc_bits & 31;
+	if (m)
+		ecc[bch->ecc_bits/32] &= ~((1u << (32-m))-1);
+	memset(syn, 0, 2*t*sizeof(*syn));
+
+	/*
+	 * an error in data flips about half of the ecc bits, use lookup
+	 * tables then; errors confined to the ecc bytes leave only a few bits
+	 * set, which are cheaper to handle one by one
+	 */
+	for (i = 0, w = 0; i < l; i++)
+		w += hweight32(ecc[i]);
+
+	if (w < 4*l)
+		compute_syndromes_bits(bch, ecc, syn);
+	else
+		compute_syndromes_bytes(bch, ecc, syn);
 
 	/* v(a^(2j)) = v(a^j)^2 */
-	for (j = 0; j < t; j++)
-		syn[2*j+1] = gf_sqr(bch, syn[j]);
+	for (i = 0; i < t; i++)
+		syn[2*i+1] = gf_sqr(bch, syn[i]);
 }
 
 static void gf_poly_copy(struct gf_poly *dst, struct gf_poly *src)
@@ -1015,12 +1085,22 @@ int decode_bch(struct bch_control *bch, const uint8_t *data, unsigned int len,
 				bch->ecc_buf[i] ^= bch->ecc_buf2[i];
 				sum |= bch->ecc_buf[i];
 			}
-			if (!sum)
-				/* no error found */
-				return 0;
+		} else {
+			for (i = 0, sum = 0; i < (int)ecc_words; i++)
+				sum |= bch->ecc_buf[i];
 		}
+		if (!sum)
+			/* no error found */
+			return 0;
+
 		compute_syndromes(bch, bch->ecc_buf, bch->syn);
 		syn = bch->syn;
+	} else {
+		/* hw computed syndromes: all zero means no error */
+		for (i = 0, sum = 0; i < 2*GF_T(bch); i++)
+			sum |= syn[i];
+		if (!sum)
+			return 0;
 	}
 
 	err = compute_error_locator_polynomial(bch, syn);
@@ -1107,6 +1187,25 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 	}
 }
 
+/*
+ * compute per-byte syndrome tables: for each odd j=2i+1 < 2t, entry b of
+ * table i holds b(a^j), b being an 8-bit polynomial
+ */
+static void build_syn_tables(struct bch_control *bch)
+{
+	int i, j, b;
+	uint16_t *tab;
+
+	for (i = 0; i < (int)GF_T(bch); i++) {
+		j = 2*i+1;
+		tab = bch->syn_tab+256*i;
+		tab[0] = 0;
+		/* add the contribution of b's lowest set bit to b&(b-1) */
+		for (b = 1; b < 256; b++)
+			tab[b] = tab[b & (b-1)]^a_pow(bch, j*__ffs(b));
+	}
+}
+
 /*
  * build a base for factoring degree 2 polynomials
  */
@@ -1299,6 +1398,7 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	bch->a_pow_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_pow_tab), &err);
 	bch->a_log_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_log_tab), &err);
 	bch->mod8_tab  = bch_alloc(words*1024*sizeof(*bch->mod8_tab), &err);
+	bch->syn_tab   = bch_alloc(t*256*sizeof(*bch->syn_tab), &err);
 	bch->ecc_buf   = bch_alloc(words*sizeof(*bch->ecc_buf), &err);
 	bch->ecc_buf2  = bch_alloc(words*sizeof(*bch->ecc_buf2), &err);
 	bch->xi_tab    = bch_alloc(m*sizeof(*bch->xi_tab), &err);
@@ -1324,6 +1424,8 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	build_mod8_tables(bch, genpoly);
 	kfree(genpoly);
 
+	build_syn_tables(bch);
+
 	err = build_deg2_base(bch);
 	if (err)
 		goto fail;
@@ -1348,6 +1450,7 @@ void free_bch(struct bch_control *bch)
 		kfree(bch->a_pow_tab);
 		kfree(bch->a_log_tab);
 		kfree(bch->mod8_tab);
+		kfree(bch->syn_tab);
 		kfree(bch->ecc_buf);
 		kfree(bch->ecc_buf2);
 		kfree(bch->xi_tab);
@@ -137,6 +137,9 @@
 #ifdef CONFIG_SPARC
 #	define XZ_DEC_SPARC
 #endif
+#ifdef CONFIG_ARM64
+#	define XZ_DEC_ARM64
+#endif
 
 /*
  * This will get the basic headers so that memeq() and others
@@ -48,12 +48,17 @@
  * will stop, and result of the function will be zero.
  * return : the number of bytes written in buffer 'dest', or 0 if the
  * compression fails
+ *
+ * 'acceleration' scales the step used to skip over data where no match is
+ * found: 1 is the regular LZ4 behaviour, larger values search fewer
+ * positions, trading compression ratio for speed.
  */
 static inline int lz4_compressctx(void *ctx,
 		const char *source,
 		char *dest,
 		int isize,
-		int maxoutputsize)
+		int maxoutputsize,
+		int acceleration)
 {
 	HTYPE *hashtable = (HTYPE *)ctx;
 	const u8 *ip = (u8 *)source;
@@ -78,7 +83,8 @@ static inline int lz4_compressctx(void *ctx,
 	if (isize < MINLENGTH)
 		goto _last_literals;
 
-	memset((void *)hashtable, 0, LZ4_MEM_COMPRESS);
+	/* only the part of workmem used by the hash table needs clearing */
+	memset((void *)hashtable, 0, (1U << (MEMORY_USAGE - 2)) * sizeof(HTYPE));
 
 	/* First Byte */
 	hashtable[LZ4_HASH_VALUE(ip)] = ip - base;
@@ -87,7 +93,7 @@ static inline int lz4_compressctx(void *ctx,
 
 	/* Main Loop */
 	for (;;) {
-		int findmatchattempts = (1U << skipstrength) + 3;
+		int findmatchattempts = (acceleration << skipstrength) + 3;
 		const u8 *forwardip = ip;
 		const u8 *ref;
 		u8 *token;
@@ -239,7 +245,8 @@ static inline int lz4_compress64kctx(void *ctx,
 		const char *source,
 		char *dest,
 		int isize,
-		int maxoutputsize)
+		int maxoutputsize,
+		int acceleration)
 {
 	u16 *hashtable = (u16 *)ctx;
 	const u8 *ip = (u8 *) source;
@@ -260,7 +267,7 @@ static inline int lz4_compress64kctx(void *ctx,
 	if (isize < MINLENGTH)
 		goto _last_literals;
 
-	memset((void *)hashtable, 0, LZ4_MEM_COMPRESS);
+	memset((void *)hashtable, 0, HASH64KTABLESIZE * sizeof(u16));
 
 	/* First Byte */
 	ip++;
@@ -268,7 +275,7 @@ static inline int lz4_compress64kctx(void *ctx,
 
 	/* Main Loop */
 	for (;;) {
-		int findmatchattempts = (1U << skipstrength) + 3;
+		int findmatchattempts = (acceleration << skipstrength) + 3;
 		const u8 *forwardip = ip;
 		const u8 *ref;
 		u8 *token;
@@ -415,18 +422,22 @@ _last_literals:
 	return (int)(((char *)op) - dest);
 }
 
-int lz4_compress(const unsigned char *src, size_t src_len,
-			unsigned char *dst, size_t *dst_len, void *wrkmem)
+int lz4_compress_fast(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem,
+			int acceleration)
 {
 	int ret = -1;
 	int out_len = 0;
 
+	acceleration = clamp(acceleration, LZ4_ACCELERATION_DEFAULT,
+			     LZ4_ACCELERATION_MAX);
+
 	if (src_len < LZ4_64KLIMIT)
 		out_len = lz4_compress64kctx(wrkmem, src, dst, src_len,
-				lz4_compressbound(src_len));
+				lz4_compressbound(src_len), acceleration);
 	else
 		out_len = lz4_compressctx(wrkmem, src, dst, src_len,
-				lz4_compressbound(src_len));
+				lz4_compressbound(src_len), acceleration);
 
 	if (out_len < 0)
 		goto exit;
@@ -437,6 +448,14 @@ int lz4_compress(const unsigned char *src, size_t src_len,
 exit:
 	return ret;
 }
+EXPORT_SYMBOL(lz4_compress_fast);
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	return lz4_compress_fast(src, src_len, dst, dst_len, wrkmem,
+				 LZ4_ACCELERATION_DEFAULT);
+}
 EXPORT_SYMBOL(lz4_compress);
 
 MODULE_LICENSE("Dual BSD/GPL");
@@ -0,0 +1,226 @@
+/*
+ * Test cases and benchmark for the generic BCH library (lib/bch.c)
+ *
+ * For a few (m, t) configurations typical of NAND flash, random data blocks
+ * are encoded, up to t random bit errors are injected in data and ecc, and
+ * the decoder is checked to locate all of them, using both the
+ * (data, recv_ecc) and the (calc_ecc) calling conventions.  Average decoding
+ * times for error free, single error and t error blocks are then reported.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/bch.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of random blocks per test (default: 1000)");
+
+struct bch_test_config {
+	int m;
+	int t;
+	unsigned int len;
+};
+
+static const struct bch_test_config bch_test_configs[] = {
+	{ 13,  4,  512 },
+	{ 13,  8,  512 },
+	{ 14, 16, 1024 },
+	{ 14, 24, 1024 },
+	{ 14, 40, 1024 },
+};
+
+struct bch_test {
+	struct bch_control *bch;
+	unsigned int len;
+	uint8_t *data;
+	uint8_t *ecc;
+	uint8_t *recv_ecc;
+	unsigned int *errloc;
+	unsigned int *bits;
+};
+
+/* flip @nerr distinct random bits among data and ecc, remember them */
+static void bch_test_corrupt(struct bch_test *bt, unsigned int nerr)
+{
+	const unsigned int nbits = 8*bt->len+bt->bch->ecc_bits;
+	unsigned int i, j, bit;
+
+	for (i = 0; i < nerr; i++) {
+again:
+		bit = prandom_u32() % nbits;
+		for (j = 0; j < i; j++)
+			if (bt->bits[j] == bit)
+				goto again;
+		bt->bits[i] = bit;
+
+		if (bit < 8*bt->len) {
+			bt->data[bit/8] ^= 1 << (bit % 8);
+		} else {
+			bit -= 8*bt->len;
+			bt->recv_ecc[bit/8] ^= 1 << (7-(bit % 8));
+		}
+	}
+}
+
+/* check that decode_bch() returned exactly the injected error locations */
+static int bch_test_check(struct bch_test *bt, int count, unsigned int nerr)
+{
+	unsigned int i, j, bit;
+
+	if (count != nerr)
+		return -EINVAL;
+
+	for (i = 0; i < nerr; i++) {
+		bit = bt->bits[i];
+		/* errloc bit numbering within ecc bytes is msb first */
+		if (bit >= 8*bt->len)
+			bit = (bit & ~7)|(7-(bit & 7));
+		for (j = 0; j < nerr; j++)
+			if (bt->errloc[j] == bit)
+				break;
+		if (j == nerr)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static int bch_test_block(struct bch_test *bt, unsigned int nerr)
+{
+	struct bch_control *bch = bt->bch;
+	unsigned int i;
+	int count;
+
+	prandom_bytes(bt->data, bt->len);
+	memset(bt->ecc, 0, bch->ecc_bytes);
+	encode_bch(bch, bt->data, bt->len, bt->ecc);
+	memcpy(bt->recv_ecc, bt->ecc, bch->ecc_bytes);
+
+	bch_test_corrupt(bt, nerr);
+
+	count = decode_bch(bch, bt->data, bt->len, bt->recv_ecc, NULL, NULL,
+			   bt->errloc);
+	if (bch_test_check(bt, count, nerr)) {
+		pr_err("m=%d t=%d: %u errors, data/recv_ecc decode returned %d\n",
+		       bch->m, bch->t, nerr, count);
+		return -EINVAL;
+	}
+
+	/* same block, with ecc = recv_ecc ^ calc_ecc provided by the caller */
+	memset(bt->ecc, 0, bch->ecc_bytes);
+	encode_bch(bch, bt->data, bt->len, bt->ecc);
+	for (i = 0; i < bch->ecc_bytes; i++)
+		bt->ecc[i] ^= bt->recv_ecc[i];
+
+	count = decode_bch(bch, NULL, bt->len, NULL, bt->ecc, NULL, bt->errloc);
+	if (bch_test_check(bt, count, nerr)) {
+		pr_err("m=%d t=%d: %u errors, calc_ecc decode returned %d\n",
+		       bch->m, bch->t, nerr, count);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/* average decode_bch() time for blocks with @nerr errors, in ns */
+static u64 bch_test_bench(struct bch_test *bt, unsigned int nerr)
+{
+	struct bch_control *bch = bt->bch;
+	unsigned int i;
+	u64 total = 0;
+	ktime_t start;
+
+	for (i = 0; i < iterations; i++) {
+		prandom_bytes(bt->data, bt->len);
+		memset(bt->ecc, 0, bch->ecc_bytes);
+		encode_bch(bch, bt->data, bt->len, bt->ecc);
+		memcpy(bt->recv_ecc, bt->ecc, bch->ecc_bytes);
+		bch_test_corrupt(bt, nerr);
+
+		memset(bt->ecc, 0, bch->ecc_bytes);
+		encode_bch(bch, bt->data, bt->len, bt->ecc);
+
+		start = ktime_get();
+		decode_bch(bch, NULL, bt->len, bt->recv_ecc, bt->ecc, NULL,
+			   bt->errloc);
+		total += ktime_to_ns(ktime_sub(ktime_get(), start));
+		cond_resched();
+	}
+	return div_u64(total, iterations);
+}
+
+static int bch_test_run(const struct bch_test_config *cfg)
+{
+	struct bch_test bt = { .len = cfg->len };
+	unsigned int i;
+	int err = -ENOMEM;
+
+	bt.bch = init_bch(cfg->m, cfg->t, 0);
+	if (!bt.bch) {
+		/* CONFIG_BCH_CONST_PARAMS builds support a single (m, t) */
+		pr_info("m=%d t=%d: not supported, skipped\n", cfg->m, cfg->t);
+		return 0;
+	}
+
+	bt.data = kmalloc(bt.len, GFP_KERNEL);
+	bt.ecc = kmalloc(bt.bch->ecc_bytes, GFP_KERNEL);
+	bt.recv_ecc = kmalloc(bt.bch->ecc_bytes, GFP_KERNEL);
+	bt.errloc = kcalloc(cfg->t, sizeof(*bt.errloc), GFP_KERNEL);
+	bt.bits = kcalloc(cfg->t, sizeof(*bt.bits), GFP_KERNEL);
+	if (!bt.data || !bt.ecc || !bt.recv_ecc || !bt.errloc || !bt.bits)
+		goto out;
+
+	for (i = 0; i < iterations; i++) {
+		err = bch_test_block(&bt, prandom_u32() % (cfg->t+1));
+		if (err)
+			goto out;
+		cond_resched();
+	}
+
+	pr_info("m=%d t=%d len=%u: decode %llu ns (no error), %llu ns (1 error), %llu ns (%d errors)\n",
+		cfg->m, cfg->t, cfg->len, bch_test_bench(&bt, 0),
+		bch_test_bench(&bt, 1), bch_test_bench(&bt, cfg->t), cfg->t);
+out:
+	kfree(bt.bits);
+	kfree(bt.errloc);
+	kfree(bt.recv_ecc);
+	kfree(bt.ecc);
+	kfree(bt.data);
+	free_bch(bt.bch);
+	return err;
+}
+
+static int __init bch_test_init(void)
+{
+	unsigned int i;
+	int err;
+
+	if (!iterations)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(bch_test_configs); i++) {
+		err = bch_test_run(&bch_test_configs[i]);
+		if (err)
+			return err;
+	}
+	pr_info("self-tests: pass\n");
+	return 0;
+}
+
+static void __exit bch_test_exit(void)
+{
+}
+
+module_init(bch_test_init);
+module_exit(bch_test_exit);
+
+MODULE_DESCRIPTION("BCH encoder/decoder self-test and benchmark");
+MODULE_LICENSE("GPL");
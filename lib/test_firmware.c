@@ -47,9 +47,8 @@ static struct miscdevice test_fw_misc_device = {
 	.fops           = &test_fw_fops,
 };
 
-static ssize_t trigger_request_store(struct device *dev,
-				     struct device_attribute *attr,
-				     const char *buf, size_t count)
+static ssize_t trigger_request(struct device *dev, const char *buf,
+			       size_t count, bool mapped)
 {
 	int rc;
 	char *name;
@@ -64,7 +63,10 @@ static ssize_t trigger_request_store(struct device *dev,
 	mutex_lock(&test_fw_mutex);
 	release_firmware(test_firmware);
 	test_firmware = NULL;
-	rc = request_firmware(&test_firmware, name, dev);
+	if (mapped)
+		rc = request_firmware_mapped(&test_firmware, name, dev);
+	else
+		rc = request_firmware(&test_firmware, name, dev);
 	if (rc) {
 		pr_info("load of '%s' failed: %d\n", name, rc);
 		goto out;
@@ -79,8 +81,23 @@ out:
 
 	return rc;
 }
+
+static ssize_t trigger_request_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	return trigger_request(dev, buf, count, false);
+}
 static DEVICE_ATTR_WO(trigger_request);
 
+static ssize_t trigger_request_mapped_store(struct device *dev,
+					    struct device_attribute *attr,
+					    const char *buf, size_t count)
+{
+	return trigger_request(dev, buf, count, true);
+}
+static DEVICE_ATTR_WO(trigger_request_mapped);
+
 static int __init test_firmware_init(void)
 {
 	int rc;
@@ -96,10 +113,19 @@ static int __init test_firmware_init(void)
 		pr_err("could not create sysfs interface: %d\n", rc);
 		goto dereg;
 	}
+	rc = device_create_file(test_fw_misc_device.this_device,
+				&dev_attr_trigger_request_mapped);
+	if (rc) {
+		pr_err("could not create sysfs interface: %d\n", rc);
+		goto remove_file;
+	}
 
 	pr_warn("interface ready\n");
 
 	return 0;
+remove_file:
+	device_remove_file(test_fw_misc_device.this_device,
+			   &dev_attr_trigger_request);
 dereg:
 	misc_deregister(&test_fw_misc_device);
 	return rc;
@@ -110,6 +136,8 @@ module_init(test_firmware_init);
 static void __exit test_firmware_exit(void)
 {
 	release_firmware(test_firmware);
+	device_remove_file(test_fw_misc_device.this_device,
+			   &dev_attr_trigger_request_mapped);
 	device_remove_file(test_fw_misc_device.this_device,
 			   &dev_attr_trigger_request);
 	misc_deregister(&test_fw_misc_device);
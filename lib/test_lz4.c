@@ -0,0 +1,389 @@
+/*
+ * Test cases and benchmark for the LZ4 library (lib/lz4)
+ *
+ * Pages resembling anonymous memory (heap objects full of pointers and
+ * small integers, mostly empty pages, text) and random pages are
+ * compressed one page at a time, the way zram does, with a range of
+ * acceleration factors.  Every page must decompress back to the original,
+ * and the compression throughput and ratio for each factor are reported.
+ * A fixed input must also compress, with lz4_compress() and at
+ * acceleration 1, to exactly what the compressor produced before
+ * acceleration factors were added.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define TEST_PAGES	256
+
+static unsigned int iterations = 20;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Compression runs per benchmark (default: 20)");
+
+static const int test_accelerations[] = { 1, 2, 4, 8, 16, 32 };
+
+static const char * const test_words[] = {
+	"static", "struct", "return", "unsigned", "int", "if", "else", "for",
+	"while", "the", "of", "to", "and", "http://", ".com", "<div>", "</div>",
+	"\"", ":", ",", "{", "}", " ", " ", "\n", "true", "false", "null",
+};
+
+enum test_kind {
+	TEST_HEAP,
+	TEST_SPARSE,
+	TEST_TEXT,
+	TEST_RANDOM,
+};
+
+static const char * const test_names[] = { "heap", "sparse", "text", "random" };
+
+#define TEST_GOLDEN_LEN	1024
+
+/*
+ * lz4_compress() output for test_fill_golden(), taken from the compressor
+ * as it was before acceleration factors were added.  It is the same for
+ * 32 and 64-bit and with or without efficient unaligned access.
+ */
+static const u8 test_golden[] = {
+	0xf3, 0x0f, 0x6f, 0x66, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x69, 0x66, 0x20,
+	0x66, 0x6f, 0x72, 0x66, 0x6f, 0x72, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e,
+	0x66, 0x6f, 0x72, 0x77, 0x68, 0x69, 0x6c, 0x65, 0x1c, 0x00, 0xf2, 0x11,
+	0x6e, 0x75, 0x6c, 0x6c, 0x61, 0x6e, 0x64, 0x73, 0x74, 0x61, 0x74, 0x69,
+	0x63, 0x74, 0x72, 0x75, 0x65, 0x20, 0x74, 0x68, 0x65, 0x20, 0x73, 0x74,
+	0x72, 0x75, 0x63, 0x74, 0x6f, 0x66, 0x6f, 0x66, 0x35, 0x00, 0x00, 0x26,
+	0x00, 0x30, 0x66, 0x6f, 0x72, 0x07, 0x00, 0x62, 0x6f, 0x66, 0x66, 0x6f,
+	0x72, 0x7d, 0x17, 0x00, 0x90, 0x61, 0x6e, 0x64, 0x61, 0x6e, 0x64, 0x74,
+	0x68, 0x65, 0x2a, 0x00, 0x00, 0x66, 0x00, 0xd2, 0x2e, 0x63, 0x6f, 0x6d,
+	0x68, 0x74, 0x74, 0x70, 0x3a, 0x2f, 0x2f, 0x22, 0x7b, 0x54, 0x00, 0x00,
+	0x21, 0x00, 0x30, 0x72, 0x75, 0x65, 0x3b, 0x00, 0x41, 0x20, 0x3a, 0x74,
+	0x68, 0x09, 0x00, 0x32, 0x65, 0x6c, 0x73, 0x80, 0x00, 0x42, 0x7d, 0x69,
+	0x6e, 0x74, 0x27, 0x00, 0x91, 0x75, 0x6e, 0x73, 0x69, 0x67, 0x6e, 0x65,
+	0x64, 0x3a, 0x98, 0x00, 0x02, 0x5f, 0x00, 0x04, 0x14, 0x00, 0x03, 0x52,
+	0x00, 0x14, 0x7d, 0x10, 0x00, 0x50, 0x20, 0x2c, 0x6f, 0x66, 0x20, 0x51,
+	0x00, 0x62, 0x3c, 0x2f, 0x64, 0x69, 0x76, 0x3e, 0xad, 0x00, 0x25, 0x69,
+	0x66, 0x56, 0x00, 0x10, 0x3a, 0x87, 0x00, 0x02, 0x57, 0x00, 0x00, 0x0a,
+	0x00, 0x01, 0x52, 0x00, 0x02, 0x2b, 0x00, 0x55, 0x69, 0x66, 0x22, 0x6f,
+	0x66, 0x47, 0x00, 0x03, 0x58, 0x00, 0x60, 0x69, 0x6e, 0x74, 0x0a, 0x2c,
+	0x3c, 0x4a, 0x00, 0x21, 0x69, 0x66, 0x1b, 0x01, 0x03, 0x18, 0x00, 0x52,
+	0x61, 0x6e, 0x64, 0x22, 0x7d, 0x47, 0x00, 0x01, 0x1e, 0x00, 0x00, 0x1e,
+	0x01, 0x01, 0x50, 0x00, 0x33, 0x6f, 0x72, 0x0a, 0x23, 0x00, 0x11, 0x20,
+	0x19, 0x00, 0x30, 0x6f, 0x66, 0x22, 0x7c, 0x00, 0x23, 0x74, 0x6f, 0x38,
+	0x01, 0x10, 0x20, 0x0e, 0x00, 0x43, 0x66, 0x6f, 0x72, 0x7b, 0x26, 0x00,
+	0x21, 0x3a, 0x22, 0x83, 0x00, 0x10, 0x0a, 0x3d, 0x00, 0x03, 0x0f, 0x01,
+	0x02, 0x57, 0x00, 0x02, 0xe7, 0x00, 0x53, 0x20, 0x22, 0x74, 0x68, 0x65,
+	0x33, 0x00, 0x22, 0x74, 0x6f, 0x14, 0x00, 0x20, 0x22, 0x7d, 0x2d, 0x00,
+	0x00, 0x04, 0x00, 0x02, 0xb9, 0x00, 0x10, 0x0a, 0x7d, 0x00, 0x41, 0x0a,
+	0x61, 0x6e, 0x64, 0x71, 0x00, 0x30, 0x69, 0x6e, 0x74, 0x10, 0x00, 0x10,
+	0x20, 0x05, 0x00, 0x00, 0x04, 0x00, 0x02, 0x34, 0x00, 0x11, 0x2c, 0xbd,
+	0x00, 0x02, 0xbb, 0x01, 0x01, 0x27, 0x00, 0x02, 0x0b, 0x00, 0x22, 0x74,
+	0x6f, 0xa6, 0x00, 0x13, 0x7d, 0x8e, 0x00, 0x02, 0x51, 0x00, 0x13, 0x22,
+	0x0e, 0x00, 0x03, 0x24, 0x00, 0x31, 0x72, 0x75, 0x65, 0x33, 0x00, 0x33,
+	0x66, 0x6f, 0x72, 0x19, 0x00, 0x02, 0x54, 0x00, 0x01, 0xb9, 0x00, 0x12,
+	0x2c, 0x0c, 0x00, 0x00, 0x8e, 0x00, 0x02, 0xb8, 0x00, 0x02, 0x06, 0x00,
+	0x01, 0x1c, 0x00, 0x01, 0x05, 0x00, 0x11, 0x22, 0x3c, 0x00, 0x04, 0x58,
+	0x01, 0x03, 0x41, 0x00, 0x02, 0x25, 0x00, 0x34, 0x61, 0x6e, 0x64, 0x18,
+	0x00, 0x04, 0x08, 0x00, 0x00, 0xeb, 0x00, 0x05, 0x73, 0x02, 0x02, 0x3b,
+	0x00, 0x06, 0x77, 0x00, 0x30, 0x61, 0x6e, 0x64, 0xda, 0x01, 0x11, 0x3a,
+	0x52, 0x00, 0x11, 0x7d, 0xd2, 0x00, 0x53, 0x74, 0x68, 0x65, 0x22, 0x20,
+	0x55, 0x00, 0x02, 0x8a, 0x00, 0x02, 0xb5, 0x00, 0x40, 0x69, 0x6e, 0x74,
+	0x2c, 0x4c, 0x00, 0x22, 0x6f, 0x66, 0x10, 0x00, 0x22, 0x74, 0x6f, 0x73,
+	0x00, 0x20, 0x2c, 0x7b, 0x14, 0x01, 0x3f, 0x74, 0x72, 0x00, 0x01, 0x00,
+	0xac, 0xf0, 0x31, 0xc0, 0x40, 0x2d, 0x43, 0x0f, 0x42, 0x4d, 0x5d, 0xc7,
+	0xac, 0x66, 0xcb, 0xa2, 0x55, 0x46, 0x64, 0xf1, 0xf1, 0x08, 0xe6, 0x74,
+	0xd2, 0x95, 0x26, 0x15, 0x24, 0xeb, 0x44, 0x84, 0x1a, 0x02, 0xad, 0x4f,
+	0x42, 0xc5, 0x93, 0xe9, 0x04, 0x83, 0x30, 0xce, 0x02, 0xd0, 0xf5, 0xaf,
+	0xdd, 0xb2, 0x7d, 0x4c, 0x8e, 0x9c, 0xe6, 0x6f, 0x5e, 0x81, 0xde, 0x35,
+	0x2e, 0x1a, 0x97, 0x89, 0x8e, 0x14, 0x64,
+};
+
+/* 64 byte objects: a few pointers into one area, small counters, padding */
+static void test_fill_heap(u8 *page, struct rnd_state *rnd)
+{
+	const u64 heap = 0x0000007f80000000ULL;
+	u64 *w = (u64 *)page;
+	unsigned int i;
+	u32 r;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(u64); i++) {
+		r = prandom_u32_state(rnd);
+		switch (i % 8) {
+		case 0:
+		case 1:
+		case 2:
+			w[i] = (r & 3) ? heap + ((r >> 4) & 0xffff0) : 0;
+			break;
+		case 3:
+			w[i] = r & 0xff;
+			break;
+		case 4:
+			w[i] = (u64)(r & 0xffff) << 32 | (r >> 20);
+			break;
+		default:
+			w[i] = (r & 7) ? 0 : r;
+			break;
+		}
+	}
+}
+
+/* a page touched in a few places only */
+static void test_fill_sparse(u8 *page, struct rnd_state *rnd)
+{
+	unsigned int i, n;
+	u32 r;
+
+	memset(page, 0, PAGE_SIZE);
+	n = prandom_u32_state(rnd) % 16 + 1;
+	for (i = 0; i < n; i++) {
+		r = prandom_u32_state(rnd);
+		prandom_bytes_state(rnd, page + (r % (PAGE_SIZE / 64)) * 64,
+				    (r >> 16) % 64 + 1);
+	}
+}
+
+static void test_fill_text(u8 *page, struct rnd_state *rnd)
+{
+	size_t pos = 0, n;
+	const char *w;
+
+	while (pos < PAGE_SIZE) {
+		w = test_words[prandom_u32_state(rnd) % ARRAY_SIZE(test_words)];
+		n = min(strlen(w), PAGE_SIZE - pos);
+		memcpy(page + pos, w, n);
+		pos += n;
+	}
+}
+
+/*
+ * Text, a run of zeroes and a few bytes that don't compress, from a fixed
+ * LCG rather than prandom so that the input can't change under the golden
+ * output.
+ */
+static void test_fill_golden(u8 *buf)
+{
+	size_t pos = 0, n;
+	const char *w;
+	u32 x = 1;
+
+	while (pos < 768) {
+		x = x * 1103515245 + 12345;
+		w = test_words[(x >> 16) % ARRAY_SIZE(test_words)];
+		n = min(strlen(w), 768 - pos);
+		memcpy(buf + pos, w, n);
+		pos += n;
+	}
+	memset(buf + pos, 0, 192);
+	for (pos += 192; pos < TEST_GOLDEN_LEN; pos++) {
+		x = x * 1103515245 + 12345;
+		buf[pos] = x >> 24;
+	}
+}
+
+static void test_fill(u8 *data, enum test_kind kind, struct rnd_state *rnd)
+{
+	unsigned int i;
+	u8 *page;
+
+	for (i = 0; i < TEST_PAGES; i++) {
+		page = data + i * PAGE_SIZE;
+		switch (kind) {
+		case TEST_HEAP:
+			test_fill_heap(page, rnd);
+			break;
+		case TEST_SPARSE:
+			test_fill_sparse(page, rnd);
+			break;
+		case TEST_TEXT:
+			test_fill_text(page, rnd);
+			break;
+		default:
+			prandom_bytes_state(rnd, page, PAGE_SIZE);
+			break;
+		}
+	}
+}
+
+struct lz4_test {
+	u8 *data;
+	u8 *comp;
+	u8 *out;
+	void *wrkmem;
+};
+
+/*
+ * The hash of the match finder reads the input in native byte order, so
+ * the output is only pinned down on little-endian machines.
+ */
+static int test_golden_check(struct lz4_test *lt)
+{
+	size_t comp_len, in_len;
+	int err;
+
+	test_fill_golden(lt->data);
+
+	err = lz4_compress(lt->data, TEST_GOLDEN_LEN, lt->comp, &comp_len,
+			   lt->wrkmem);
+	if (!err && !IS_ENABLED(CONFIG_CPU_BIG_ENDIAN) &&
+	    (comp_len != sizeof(test_golden) ||
+	     memcmp(lt->comp, test_golden, comp_len)))
+		err = -EINVAL;
+	if (err) {
+		pr_err("golden: lz4_compress() output differs\n");
+		return -EINVAL;
+	}
+
+	err = lz4_compress_fast(lt->data, TEST_GOLDEN_LEN, lt->comp, &comp_len,
+				lt->wrkmem, LZ4_ACCELERATION_DEFAULT);
+	if (!err && !IS_ENABLED(CONFIG_CPU_BIG_ENDIAN) &&
+	    (comp_len != sizeof(test_golden) ||
+	     memcmp(lt->comp, test_golden, comp_len)))
+		err = -EINVAL;
+	if (err) {
+		pr_err("golden: acceleration %d output differs\n",
+		       LZ4_ACCELERATION_DEFAULT);
+		return -EINVAL;
+	}
+
+	in_len = sizeof(test_golden);
+	if (lz4_decompress(test_golden, &in_len, lt->out, TEST_GOLDEN_LEN) ||
+	    in_len != sizeof(test_golden) ||
+	    memcmp(lt->out, lt->data, TEST_GOLDEN_LEN)) {
+		pr_err("golden: lz4_decompress() failed\n");
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int test_check(struct lz4_test *lt, const char *name, int acceleration)
+{
+	size_t comp_len, in_len, out_len;
+	unsigned int i;
+	u8 *page;
+
+	for (i = 0; i < TEST_PAGES; i++) {
+		page = lt->data + i * PAGE_SIZE;
+		if (lz4_compress_fast(page, PAGE_SIZE, lt->comp, &comp_len,
+				      lt->wrkmem, acceleration)) {
+			pr_err("%s: acceleration %d: page %u: compression failed\n",
+			       name, acceleration, i);
+			return -EINVAL;
+		}
+
+		in_len = comp_len;
+		if (lz4_decompress(lt->comp, &in_len, lt->out, PAGE_SIZE) ||
+		    in_len != comp_len || memcmp(lt->out, page, PAGE_SIZE)) {
+			pr_err("%s: acceleration %d: page %u: lz4_decompress() failed\n",
+			       name, acceleration, i);
+			return -EINVAL;
+		}
+
+		out_len = PAGE_SIZE;
+		memset(lt->out, 0, PAGE_SIZE);
+		if (lz4_decompress_unknownoutputsize(lt->comp, comp_len,
+						     lt->out, &out_len) ||
+		    out_len != PAGE_SIZE || memcmp(lt->out, page, PAGE_SIZE)) {
+			pr_err("%s: acceleration %d: page %u: lz4_decompress_unknownoutputsize() failed\n",
+			       name, acceleration, i);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static void test_bench(struct lz4_test *lt, const char *name, int acceleration)
+{
+	size_t comp_len, total = 0;
+	unsigned int i, j;
+	ktime_t start;
+	u64 ns;
+
+	start = ktime_get();
+	for (j = 0; j < iterations; j++) {
+		total = 0;
+		for (i = 0; i < TEST_PAGES; i++) {
+			lz4_compress_fast(lt->data + i * PAGE_SIZE, PAGE_SIZE,
+					  lt->comp, &comp_len, lt->wrkmem,
+					  acceleration);
+			total += comp_len;
+		}
+		cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("%s: acceleration %2d: ratio %lu.%02lu, compress %llu MB/s\n",
+		name, acceleration, TEST_PAGES * PAGE_SIZE / total,
+		TEST_PAGES * PAGE_SIZE * 100 / total % 100,
+		div64_u64((u64)TEST_PAGES * PAGE_SIZE * iterations * 1000,
+			  ns ? ns : 1));
+}
+
+static int test_run(struct lz4_test *lt, enum test_kind kind)
+{
+	const char *name = test_names[kind];
+	struct rnd_state rnd;
+	unsigned int i;
+	int err;
+
+	prandom_seed_state(&rnd, kind);
+	test_fill(lt->data, kind, &rnd);
+
+	for (i = 0; i < ARRAY_SIZE(test_accelerations); i++) {
+		err = test_check(lt, name, test_accelerations[i]);
+		if (err)
+			return err;
+		if (iterations)
+			test_bench(lt, name, test_accelerations[i]);
+	}
+	return 0;
+}
+
+static int __init lz4_test_init(void)
+{
+	struct lz4_test lt = { };
+	unsigned int kind;
+	int err = -ENOMEM;
+
+	lt.data = vmalloc(TEST_PAGES * PAGE_SIZE);
+	lt.comp = vmalloc(lz4_compressbound(PAGE_SIZE));
+	lt.out = vmalloc(PAGE_SIZE);
+	lt.wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!lt.data || !lt.comp || !lt.out || !lt.wrkmem)
+		goto out;
+
+	err = test_golden_check(&lt);
+	if (err)
+		goto out;
+
+	for (kind = TEST_HEAP; kind <= TEST_RANDOM; kind++) {
+		err = test_run(&lt, kind);
+		if (err)
+			goto out;
+	}
+	pr_info("self-tests: pass\n");
+out:
+	vfree(lt.wrkmem);
+	vfree(lt.out);
+	vfree(lt.comp);
+	vfree(lt.data);
+	return err;
+}
+
+static void __exit lz4_test_exit(void)
+{
+}
+
+module_init(lz4_test_init);
+module_exit(lz4_test_exit);
+
+MODULE_DESCRIPTION("LZ4 self-test and compression speed/ratio benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,188 @@
+/*
+ * Test cases and benchmark for the regmap MMIO fast path
+ *
+ * Two maps with a flat cache are created over plain memory standing in for
+ * a register block, one using the generic locked path and one with
+ * mmio_fast_path set.  Both must behave identically for cached and volatile
+ * registers, including in cache only mode, and the time taken by
+ * regmap_read() and regmap_update_bits() on each is then reported.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+
+#define TEST_REGS		256
+#define TEST_VOLATILE_BASE	0x200	/* registers from here are volatile */
+
+static unsigned int iterations = 100000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Accesses per benchmark (default: 100000)");
+
+static bool test_volatile_reg(struct device *dev, unsigned int reg)
+{
+	return reg >= TEST_VOLATILE_BASE;
+}
+
+static const struct regmap_config test_regmap_config = {
+	.reg_bits = 32,
+	.val_bits = 32,
+	.reg_stride = 4,
+	.max_register = (TEST_REGS - 1) * 4,
+	.volatile_reg = test_volatile_reg,
+	.cache_type = REGCACHE_FLAT,
+};
+
+struct test_map {
+	const char *name;
+	u32 *regs;
+	struct regmap *map;
+};
+
+static int test_map_init(struct test_map *tm, const char *name, bool fast)
+{
+	struct regmap_config config = test_regmap_config;
+
+	tm->name = name;
+	tm->regs = kzalloc(TEST_REGS * sizeof(*tm->regs), GFP_KERNEL);
+	if (!tm->regs)
+		return -ENOMEM;
+
+	config.mmio_fast_path = fast;
+	tm->map = regmap_init_mmio(NULL, (void __iomem *)tm->regs, &config);
+	if (IS_ERR(tm->map)) {
+		kfree(tm->regs);
+		return PTR_ERR(tm->map);
+	}
+	return 0;
+}
+
+static void test_map_exit(struct test_map *tm)
+{
+	regmap_exit(tm->map);
+	kfree(tm->regs);
+}
+
+#define CHECK(tm, cond)							\
+	do {								\
+		if (!(cond)) {						\
+			pr_err("%s: check failed at line %d: %s\n",	\
+			       (tm)->name, __LINE__, #cond);		\
+			return -EINVAL;					\
+		}							\
+	} while (0)
+
+static int test_map_check(struct test_map *tm)
+{
+	const unsigned int cached = 0x10, vol = TEST_VOLATILE_BASE + 0x10;
+	unsigned int val;
+	bool change;
+
+	/* cached register: written through, then read back from the cache */
+	CHECK(tm, !regmap_write(tm->map, cached, 0x12345678));
+	CHECK(tm, tm->regs[cached / 4] == 0x12345678);
+	tm->regs[cached / 4] = 0;
+	CHECK(tm, !regmap_read(tm->map, cached, &val) && val == 0x12345678);
+
+	/* volatile register: always read from the hardware */
+	tm->regs[vol / 4] = 0xa5a5a5a5;
+	CHECK(tm, !regmap_read(tm->map, vol, &val) && val == 0xa5a5a5a5);
+
+	CHECK(tm, !regmap_update_bits_check(tm->map, vol, 0xff00, 0x1200,
+					    &change) && change);
+	CHECK(tm, tm->regs[vol / 4] == 0xa5a512a5);
+	CHECK(tm, !regmap_update_bits_check(tm->map, vol, 0xff00, 0x1200,
+					    &change) && !change);
+	CHECK(tm, !regmap_update_bits(tm->map, cached, 0xff, 0x11));
+	CHECK(tm, tm->regs[cached / 4] == 0x12345611);
+
+	CHECK(tm, regmap_read(tm->map, cached + 1, &val) == -EINVAL);
+
+	/* cache only: no hardware access until the cache is synced */
+	regcache_cache_only(tm->map, true);
+	CHECK(tm, !regmap_write(tm->map, cached, 0xcafe));
+	CHECK(tm, tm->regs[cached / 4] == 0x12345611);
+	CHECK(tm, !regmap_read(tm->map, cached, &val) && val == 0xcafe);
+	CHECK(tm, regmap_read(tm->map, vol, &val) == -EBUSY);
+	regcache_cache_only(tm->map, false);
+	CHECK(tm, !regcache_sync(tm->map));
+	CHECK(tm, tm->regs[cached / 4] == 0xcafe);
+
+	return 0;
+}
+
+static void test_map_bench(struct test_map *tm)
+{
+	const unsigned int cached = 0x20, vol = TEST_VOLATILE_BASE + 0x20;
+	u64 t_cached, t_vol, t_update;
+	unsigned int i, val;
+	ktime_t start;
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		regmap_read(tm->map, cached, &val);
+	t_cached = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		regmap_read(tm->map, vol, &val);
+	t_vol = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		regmap_update_bits(tm->map, vol, 0xff, i);
+	t_update = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("%s: read %llu ns (cached), %llu ns (volatile), update_bits %llu ns\n",
+		tm->name, div_u64(t_cached, iterations),
+		div_u64(t_vol, iterations), div_u64(t_update, iterations));
+}
+
+static int __init regmap_mmio_test_init(void)
+{
+	struct test_map generic, fast;
+	int ret;
+
+	if (!iterations)
+		return -EINVAL;
+
+	ret = test_map_init(&generic, "generic", false);
+	if (ret)
+		return ret;
+	ret = test_map_init(&fast, "fast path", true);
+	if (ret)
+		goto out_generic;
+
+	ret = test_map_check(&generic);
+	if (!ret)
+		ret = test_map_check(&fast);
+	if (ret)
+		goto out;
+
+	test_map_bench(&generic);
+	test_map_bench(&fast);
+	pr_info("self-tests: pass\n");
+out:
+	test_map_exit(&fast);
+out_generic:
+	test_map_exit(&generic);
+	return ret;
+}
+
+static void __exit regmap_mmio_test_exit(void)
+{
+}
+
+module_init(regmap_mmio_test_init);
+module_exit(regmap_mmio_test_exit);
+
+MODULE_DESCRIPTION("regmap MMIO fast path self-test and benchmark");
+MODULE_LICENSE("GPL");
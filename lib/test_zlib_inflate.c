@@ -0,0 +1,292 @@
+/*
+ * Test cases and benchmark for the zlib inflate library (lib/zlib_inflate)
+ *
+ * Text like, run heavy and random buffers are compressed with zlib_deflate
+ * and inflated back, both in one call and fed in small random pieces of
+ * input and output, and must match the original byte for byte.  Corrupted
+ * copies of the compressed data are then inflated to check that the
+ * decoder never writes past the output buffer, and the inflate throughput
+ * on each buffer is reported.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/zlib.h>
+
+#define TEST_SIZE	(256 * 1024)
+#define TEST_GUARD	64
+
+static unsigned int iterations = 20;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Inflate runs per benchmark (default: 20)");
+
+static unsigned int fuzz_iterations = 1000;
+module_param(fuzz_iterations, uint, 0444);
+MODULE_PARM_DESC(fuzz_iterations, "Corrupted streams per buffer (default: 1000)");
+
+static const char * const test_words[] = {
+	"static", "struct", "return", "unsigned", "int", "if", "else", "for",
+	"while", "the", "of", "to", "and", "page", "lock", "buffer", "inode",
+	"(", ")", "{", "}", ";", " ", " ", "\n", "\t", "->", "*", "=", "0",
+};
+
+enum test_kind {
+	TEST_TEXT,
+	TEST_RUNS,
+	TEST_RANDOM,
+};
+
+static const char * const test_names[] = { "text", "runs", "random" };
+
+/* fill @buf with @len bytes of the given kind, reproducibly */
+static void test_fill(u8 *buf, size_t len, enum test_kind kind,
+		      struct rnd_state *rnd)
+{
+	size_t pos = 0, n, i;
+	const char *w;
+	u32 r;
+
+	while (pos < len) {
+		r = prandom_u32_state(rnd);
+		switch (kind) {
+		case TEST_TEXT:
+			w = test_words[r % ARRAY_SIZE(test_words)];
+			n = min(strlen(w), len - pos);
+			memcpy(buf + pos, w, n);
+			break;
+		case TEST_RUNS:
+			/* short distance matches: periods of 1 to 8 bytes */
+			n = min_t(size_t, (r >> 8) % 300 + 1, len - pos);
+			if (pos < 9 || (r & 0xf) == 0) {
+				buf[pos] = r >> 24;
+				n = 1;
+				break;
+			}
+			for (i = 0; i < n; i++)
+				buf[pos + i] = buf[pos + i - (r & 7) - 1];
+			break;
+		default:
+			n = min_t(size_t, 4, len - pos);
+			memcpy(buf + pos, &r, n);
+			break;
+		}
+		pos += n;
+	}
+}
+
+struct zlib_test {
+	z_stream inf;
+	z_stream def;
+	u8 *data;
+	u8 *comp;
+	u8 *fuzz;
+	u8 *out;
+	size_t comp_len;
+};
+
+static int test_deflate(struct zlib_test *zt, int level)
+{
+	z_stream *s = &zt->def;
+	int ret;
+
+	if (zlib_deflateInit(s, level) != Z_OK)
+		return -EINVAL;
+	s->next_in = zt->data;
+	s->avail_in = TEST_SIZE;
+	s->next_out = zt->comp;
+	s->avail_out = 2 * TEST_SIZE;
+	ret = zlib_deflate(s, Z_FINISH);
+	zlib_deflateEnd(s);
+	if (ret != Z_STREAM_END)
+		return -EINVAL;
+	zt->comp_len = s->total_out;
+	return 0;
+}
+
+/*
+ * Inflate @len bytes from @in into zt->out, @len_out bytes at most, handing
+ * out input and output @chunk bytes at most at a time if @chunk != 0.
+ * Returns the zlib status and stores the output size in *@out_len.
+ */
+static int test_inflate(struct zlib_test *zt, const u8 *in, size_t len,
+			size_t len_out, size_t chunk, size_t *out_len,
+			struct rnd_state *rnd)
+{
+	z_stream *s = &zt->inf;
+	size_t n_in, n_out;
+	int ret;
+
+	if (zlib_inflateInit(s) != Z_OK)
+		return Z_STREAM_ERROR;
+	s->next_in = in;
+	s->next_out = zt->out;
+	do {
+		n_in = in + len - s->next_in;
+		n_out = zt->out + len_out - s->next_out;
+		if (chunk) {
+			n_in = min_t(size_t, n_in,
+				     prandom_u32_state(rnd) % chunk + 1);
+			n_out = min_t(size_t, n_out,
+				      prandom_u32_state(rnd) % chunk + 1);
+		}
+		s->avail_in = n_in;
+		s->avail_out = n_out;
+		ret = zlib_inflate(s, chunk ? Z_SYNC_FLUSH : Z_FINISH);
+	} while (ret == Z_OK);
+	*out_len = s->next_out - zt->out;
+	zlib_inflateEnd(s);
+	return ret;
+}
+
+static int test_check(struct zlib_test *zt, const char *name, size_t chunk,
+		      struct rnd_state *rnd)
+{
+	size_t out_len;
+	int ret;
+
+	memset(zt->out, 0, TEST_SIZE);
+	ret = test_inflate(zt, zt->comp, zt->comp_len, TEST_SIZE, chunk,
+			   &out_len, rnd);
+	if (ret != Z_STREAM_END || out_len != TEST_SIZE ||
+	    memcmp(zt->out, zt->data, TEST_SIZE)) {
+		pr_err("%s: inflate with %zu byte chunks failed (%d, %zu bytes)\n",
+		       name, chunk, ret, out_len);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int test_fuzz(struct zlib_test *zt, const char *name,
+		     struct rnd_state *rnd)
+{
+	unsigned int i, j, errors = 0;
+	size_t out_len;
+	u32 r;
+
+	for (i = 0; i < fuzz_iterations; i++) {
+		memcpy(zt->fuzz, zt->comp, zt->comp_len);
+		for (j = 0; j < 1 + i % 4; j++) {
+			r = prandom_u32_state(rnd);
+			zt->fuzz[r % zt->comp_len] ^= 1 << (r >> 29);
+		}
+		memset(zt->out + TEST_SIZE, 0x5a, TEST_GUARD);
+		if (test_inflate(zt, zt->fuzz, zt->comp_len, TEST_SIZE,
+				 i & 1 ? 37 : 0, &out_len, rnd) != Z_STREAM_END)
+			errors++;
+		if (out_len > TEST_SIZE ||
+		    memchr_inv(zt->out + TEST_SIZE, 0x5a, TEST_GUARD)) {
+			pr_err("%s: corrupted stream %u overran the output\n",
+			       name, i);
+			return -EINVAL;
+		}
+		cond_resched();
+	}
+	pr_info("%s: %u corrupted streams, %u rejected\n", name,
+		fuzz_iterations, errors);
+	return 0;
+}
+
+static void test_bench(struct zlib_test *zt, const char *name, int level)
+{
+	size_t out_len;
+	unsigned int i;
+	ktime_t start;
+	u64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		test_inflate(zt, zt->comp, zt->comp_len, TEST_SIZE, 0,
+			     &out_len, NULL);
+		cond_resched();
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("%s: level %d, %zu -> %u bytes, inflate %llu MB/s\n",
+		name, level, zt->comp_len, TEST_SIZE,
+		div64_u64((u64)TEST_SIZE * iterations * 1000, ns ? ns : 1));
+}
+
+static int test_run(struct zlib_test *zt, enum test_kind kind, int level)
+{
+	const char *name = test_names[kind];
+	struct rnd_state rnd;
+	int err;
+
+	prandom_seed_state(&rnd, kind * 10 + level);
+	test_fill(zt->data, TEST_SIZE, kind, &rnd);
+
+	err = test_deflate(zt, level);
+	if (err) {
+		pr_err("%s: deflate failed\n", name);
+		return err;
+	}
+
+	err = test_check(zt, name, 0, &rnd);
+	if (!err)
+		err = test_check(zt, name, 7, &rnd);
+	if (!err)
+		err = test_check(zt, name, 300, &rnd);
+	if (!err)
+		err = test_check(zt, name, 5000, &rnd);
+	if (!err)
+		err = test_fuzz(zt, name, &rnd);
+	if (!err && iterations)
+		test_bench(zt, name, level);
+	return err;
+}
+
+static int __init zlib_inflate_test_init(void)
+{
+	static const int levels[] = { Z_BEST_SPEED, 6, Z_BEST_COMPRESSION };
+	struct zlib_test zt = { };
+	unsigned int kind, i;
+	int err = -ENOMEM;
+
+	zt.inf.workspace = vmalloc(zlib_inflate_workspacesize());
+	zt.def.workspace = vmalloc(zlib_deflate_workspacesize(MAX_WBITS,
+							      DEF_MEM_LEVEL));
+	zt.data = vmalloc(TEST_SIZE);
+	zt.comp = vmalloc(2 * TEST_SIZE);
+	zt.fuzz = vmalloc(2 * TEST_SIZE);
+	zt.out = vmalloc(TEST_SIZE + TEST_GUARD);
+	if (!zt.inf.workspace || !zt.def.workspace || !zt.data || !zt.comp ||
+	    !zt.fuzz || !zt.out)
+		goto out;
+
+	for (kind = TEST_TEXT; kind <= TEST_RANDOM; kind++) {
+		for (i = 0; i < ARRAY_SIZE(levels); i++) {
+			err = test_run(&zt, kind, levels[i]);
+			if (err)
+				goto out;
+		}
+	}
+	pr_info("self-tests: pass\n");
+out:
+	vfree(zt.out);
+	vfree(zt.fuzz);
+	vfree(zt.comp);
+	vfree(zt.data);
+	vfree(zt.def.workspace);
+	vfree(zt.inf.workspace);
+	return err;
+}
+
+static void __exit zlib_inflate_test_exit(void)
+{
+}
+
+module_init(zlib_inflate_test_init);
+module_exit(zlib_inflate_test_exit);
+
+MODULE_DESCRIPTION("zlib inflate self-test, fuzz test and benchmark");
+MODULE_LICENSE("GPL");
@@ -12,6 +12,7 @@
 #include <linux/fs.h>
 #include <linux/uaccess.h>
 #include <linux/crc32.h>
+#include <linux/string.h>
 #include <linux/xz.h>
 
 /* Maximum supported dictionary size */
@@ -172,6 +173,104 @@ static ssize_t xz_dec_test_write(struct file *file, const char __user *buf,
 	return -EIO;
 }
 
+#ifdef CONFIG_XZ_DEC_ARM64
+/*
+ * 1 KiB of synthetic AArch64 code (BL and ADRP with in and out of range
+ * pages mixed with other instructions) compressed with
+ * "xz --check=crc32 --arm64 --lzma2=preset=6,dict=4KiB".
+ */
+static const uint8_t arm64_test_xz[] = {
+	0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x01, 0x69, 0x22, 0xde, 0x36,
+	0x02, 0x01, 0x0a, 0x00, 0x21, 0x01, 0x00, 0x00, 0xaa, 0x52, 0xa7, 0x39,
+	0xe0, 0x03, 0xff, 0x02, 0x1a, 0x5d, 0x00, 0x07, 0x84, 0x82, 0x2c, 0x1c,
+	0xf1, 0xda, 0xc4, 0x17, 0xb4, 0x0a, 0x4f, 0x08, 0xe4, 0x76, 0x09, 0x04,
+	0xca, 0xc2, 0xa6, 0x68, 0xa2, 0x7a, 0x3b, 0x14, 0x2e, 0xe7, 0x8c, 0x5a,
+	0xda, 0x9b, 0xe7, 0x5e, 0x75, 0xe2, 0x7e, 0x82, 0x2b, 0x8c, 0xe1, 0xef,
+	0x5b, 0xa4, 0xea, 0xc8, 0x09, 0x48, 0xd4, 0x4f, 0x06, 0xfd, 0x4f, 0xda,
+	0xf0, 0xd6, 0x91, 0x58, 0xb6, 0xf4, 0x37, 0xe9, 0xbe, 0xef, 0x7f, 0x8f,
+	0xff, 0xfe, 0x5a, 0xd8, 0x30, 0x85, 0x8b, 0x88, 0xf3, 0x3e, 0x0b, 0xc7,
+	0x04, 0x5c, 0x04, 0x12, 0x0d, 0x58, 0x9b, 0xd3, 0xa1, 0x8c, 0x91, 0xfb,
+	0xa1, 0x6b, 0x7e, 0x3d, 0x8d, 0xb9, 0x20, 0x90, 0xb3, 0xda, 0x86, 0xa4,
+	0x1f, 0xed, 0xc2, 0xd1, 0x45, 0xfb, 0xce, 0x2f, 0x90, 0x52, 0xbc, 0xf2,
+	0xb1, 0x35, 0x37, 0x62, 0xfd, 0xb0, 0xdf, 0xde, 0x67, 0x9c, 0x87, 0x77,
+	0x8c, 0x6f, 0xc0, 0xad, 0xf8, 0xb3, 0x45, 0x65, 0x17, 0x48, 0x74, 0x18,
+	0x30, 0x9a, 0x8b, 0xc5, 0x4b, 0x11, 0xdc, 0x34, 0x5b, 0x4a, 0x10, 0x7d,
+	0xe8, 0xe3, 0xa2, 0x5e, 0xf4, 0x8d, 0x06, 0xab, 0x6a, 0xa0, 0xc5, 0x7e,
+	0x8d, 0xdb, 0xbd, 0x8f, 0xb7, 0x0a, 0x34, 0x2b, 0xa0, 0x7c, 0x5a, 0xa4,
+	0x49, 0xeb, 0x60, 0xa8, 0x24, 0x44, 0x08, 0xd0, 0x6a, 0x64, 0x14, 0x71,
+	0xa2, 0x40, 0xaa, 0xdb, 0x82, 0xbd, 0x8b, 0x38, 0xef, 0x6f, 0xaa, 0x4e,
+	0xaa, 0x22, 0x80, 0x35, 0x7a, 0xcc, 0xf4, 0xf3, 0xa6, 0x0d, 0x27, 0x12,
+	0x10, 0xe7, 0x15, 0x81, 0x32, 0x5e, 0x8b, 0xae, 0xa5, 0xe4, 0x34, 0xae,
+	0x43, 0xf4, 0xf8, 0x48, 0x67, 0x7f, 0x52, 0xb5, 0x80, 0x22, 0x13, 0xd4,
+	0x8e, 0x3f, 0xe7, 0xc6, 0x01, 0x93, 0x7a, 0x65, 0x00, 0x65, 0x6a, 0x3a,
+	0x24, 0xd3, 0x33, 0x28, 0x2a, 0xb2, 0x0d, 0x68, 0x4f, 0x75, 0xdc, 0x16,
+	0x53, 0x97, 0x1d, 0xd0, 0xbd, 0x7e, 0xd2, 0x07, 0x71, 0x06, 0xd9, 0xe5,
+	0xae, 0xed, 0x9e, 0x1d, 0x2a, 0xaf, 0xc4, 0xb3, 0xb3, 0xa0, 0x71, 0x96,
+	0x50, 0xbd, 0xd8, 0xf4, 0x6d, 0x55, 0x7e, 0x4b, 0x66, 0x79, 0xb7, 0x4c,
+	0x57, 0x16, 0x82, 0xb2, 0x40, 0x90, 0xd3, 0xa8, 0x59, 0x9c, 0xa2, 0xe5,
+	0x04, 0x01, 0xe9, 0xb8, 0x6a, 0x7b, 0xd5, 0xbe, 0xff, 0x71, 0x4e, 0x98,
+	0x01, 0x82, 0x1c, 0xcd, 0x2e, 0x60, 0x0f, 0x99, 0x79, 0x57, 0x8d, 0x78,
+	0xb8, 0xc7, 0x4f, 0xc1, 0x3e, 0xfc, 0x48, 0x61, 0x6e, 0xa6, 0xd2, 0x38,
+	0x08, 0xca, 0x53, 0x8e, 0x54, 0xf3, 0x94, 0x14, 0x9c, 0x4f, 0x0d, 0xa7,
+	0xf9, 0xb0, 0xa5, 0x8b, 0x95, 0xda, 0xaa, 0xbe, 0xba, 0xfc, 0xfd, 0x34,
+	0x2d, 0x0f, 0xcc, 0x0f, 0x77, 0x7f, 0x53, 0x67, 0x55, 0x30, 0xd7, 0xf8,
+	0x2e, 0x69, 0x38, 0xc8, 0x54, 0x35, 0x51, 0xa5, 0xb4, 0xf3, 0xd0, 0x13,
+	0x96, 0x85, 0x5e, 0xd5, 0x7d, 0x65, 0x38, 0x5f, 0xe2, 0xce, 0xdf, 0x09,
+	0x44, 0x15, 0xdf, 0x95, 0x0d, 0x77, 0x65, 0x85, 0xc7, 0x6c, 0xa2, 0xe3,
+	0x81, 0xf9, 0x4c, 0x0e, 0x6e, 0xab, 0x08, 0xaf, 0x65, 0xba, 0xcd, 0x06,
+	0xc7, 0xa0, 0x22, 0x74, 0x44, 0x8a, 0xdf, 0xab, 0x9c, 0x5b, 0xff, 0x0d,
+	0x29, 0x31, 0xd1, 0x1d, 0x88, 0x50, 0x33, 0x7d, 0xe4, 0xd7, 0x84, 0x33,
+	0x38, 0xd0, 0x97, 0xec, 0xfc, 0xc1, 0x53, 0x94, 0xa7, 0xa9, 0x3b, 0x68,
+	0x29, 0x3c, 0xaa, 0xcc, 0x8b, 0xcd, 0x86, 0x14, 0xba, 0x1d, 0x7f, 0x75,
+	0x3a, 0xc6, 0x37, 0xda, 0x12, 0xf6, 0x34, 0x9f, 0xe1, 0x57, 0xcc, 0x12,
+	0x92, 0x92, 0xfb, 0x71, 0xc2, 0x94, 0xb0, 0x9b, 0x46, 0xda, 0xf7, 0xc7,
+	0xa8, 0x38, 0xc7, 0xd0, 0x7e, 0xde, 0x90, 0x53, 0xcd, 0x74, 0x7f, 0x96,
+	0xab, 0xd3, 0x1a, 0x53, 0x10, 0xf4, 0x6d, 0xc6, 0x3e, 0xd5, 0x3e, 0x64,
+	0x3f, 0x99, 0x25, 0x31, 0x4d, 0x6c, 0xf6, 0x72, 0x6f, 0x61, 0xe4, 0x3d,
+	0x6f, 0x3f, 0xbb, 0xaa, 0x1e, 0x00, 0x00, 0x00, 0x6f, 0x67, 0x23, 0x10,
+	0x00, 0x01, 0xb2, 0x04, 0x80, 0x08, 0x00, 0x00, 0xe0, 0x27, 0x9d, 0x82,
+	0x3e, 0x30, 0x0d, 0x8b, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x59, 0x5a,
+};
+
+#define ARM64_TEST_SIZE 1024
+#define ARM64_TEST_CRC32 0x1023676F
+
+/*
+ * Decode the built-in ARM64 BCJ test file with the same decoder state and
+ * buffers as the device, feeding the input in small pieces so that filtered
+ * instructions straddle the xz_dec_run() calls.
+ */
+static bool __init xz_dec_test_arm64(void)
+{
+	size_t in = 0;
+	size_t total = 0;
+
+	xz_dec_reset(state);
+	crc = 0xFFFFFFFF;
+	buffers.in_pos = 0;
+	buffers.in_size = 0;
+
+	do {
+		if (buffers.in_pos == buffers.in_size
+				&& in < sizeof(arm64_test_xz)) {
+			buffers.in_pos = 0;
+			buffers.in_size = min(sizeof(arm64_test_xz) - in,
+					(size_t)13);
+			memcpy(buffer_in, arm64_test_xz + in, buffers.in_size);
+			in += buffers.in_size;
+		}
+
+		buffers.out_pos = 0;
+		ret = xz_dec_run(state, &buffers);
+		crc = crc32(crc, buffer_out, buffers.out_pos);
+		total += buffers.out_pos;
+	} while (ret == XZ_OK);
+
+	return ret == XZ_STREAM_END && total == ARM64_TEST_SIZE
+			&& ~crc == ARM64_TEST_CRC32;
+}
+#endif
+
 /* Allocate the XZ decoder state and register the character device. */
 static int __init xz_dec_test_init(void)
 {
@@ -186,6 +285,16 @@ static int __init xz_dec_test_init(void)
 	if (state == NULL)
 		return -ENOMEM;
 
+#ifdef CONFIG_XZ_DEC_ARM64
+	if (!xz_dec_test_arm64()) {
+		printk(KERN_ERR DEVICE_NAME ": ARM64 BCJ self-test failed\n");
+		xz_dec_end(state);
+		return -EINVAL;
+	}
+
+	printk(KERN_INFO DEVICE_NAME ": ARM64 BCJ self-test passed\n");
+#endif
+
 	device_major = register_chrdev(0, DEVICE_NAME, &fileops);
 	if (device_major < 0) {
 		xz_dec_end(state);
@@ -4,6 +4,7 @@
  */
 
 #include <linux/zutil.h>
+#include <asm/unaligned.h>
 #include "inftrees.h"
 #include "inflate.h"
 #include "inffast.h"
@@ -38,6 +39,14 @@ get_unaligned16(const unsigned short *p)
 	return mm.us;
 }
 
+/*
+   With INFLATE_WIDE (a 64-bit hold and cheap unaligned loads), the bit
+   buffer is refilled with a single 8 byte load per symbol.  That leaves at
+   least 56 bits, more than the 48 a whole length/distance pair can use, so
+   no other refill is needed.  Bytes loaded past the ones accounted for in
+   bits are loaded again by the next refill, at the same position in hold.
+   Matches from the output are copied 8 bytes at a time.
+ */
 #ifdef POSTINC
 #  define OFF 0
 #  define PUP(a) *(a)++
@@ -59,7 +68,7 @@ get_unaligned16(const unsigned short *p)
    Entry assumptions:
 
         state->mode == LEN
-        strm->avail_in >= 6
+        strm->avail_in >= INFLATE_FAST_MIN_IN (6, or 8 with INFLATE_WIDE)
         strm->avail_out >= 258
         start >= strm->avail_out
         state->bits < 8
@@ -116,7 +125,7 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* copy state to local variables */
     state = (struct inflate_state *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
     end = out + (strm->avail_out - 257);
@@ -137,12 +146,18 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_WIDE
+        hold |= (unsigned long)get_unaligned_le64(in + OFF) << bits;
+        in += (63 - bits) >> 3;
+        bits |= 56;
+#else
         if (bits < 15) {
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
         }
+#endif
         this = lcode[hold & lmask];
       dolen:
         op = (unsigned)(this.bits);
@@ -156,20 +171,24 @@ void inflate_fast(z_streamp strm, unsigned start)
             len = (unsigned)(this.val);
             op &= 15;                           /* number of extra bits */
             if (op) {
+#ifndef INFLATE_WIDE
                 if (bits < op) {
                     hold += (unsigned long)(PUP(in)) << bits;
                     bits += 8;
                 }
+#endif
                 len += (unsigned)hold & ((1U << op) - 1);
                 hold >>= op;
                 bits -= op;
             }
+#ifndef INFLATE_WIDE
             if (bits < 15) {
                 hold += (unsigned long)(PUP(in)) << bits;
                 bits += 8;
                 hold += (unsigned long)(PUP(in)) << bits;
                 bits += 8;
             }
+#endif
             this = dcode[hold & dmask];
           dodist:
             op = (unsigned)(this.bits);
@@ -179,6 +198,7 @@ void inflate_fast(z_streamp strm, unsigned start)
             if (op & 16) {                      /* distance base */
                 dist = (unsigned)(this.val);
                 op &= 15;                       /* number of extra bits */
+#ifndef INFLATE_WIDE
                 if (bits < op) {
                     hold += (unsigned long)(PUP(in)) << bits;
                     bits += 8;
@@ -187,6 +207,7 @@ void inflate_fast(z_streamp strm, unsigned start)
                         bits += 8;
                     }
                 }
+#endif
                 dist += (unsigned)hold & ((1U << op) - 1);
 #ifdef INFLATE_STRICT
                 if (dist > dmax) {
@@ -257,6 +278,37 @@ void inflate_fast(z_streamp strm, unsigned start)
                             PUP(out) = PUP(from);
                     }
                 }
+#ifdef INFLATE_WIDE
+                else {
+                    from = out - dist;          /* copy direct from output */
+                    if (dist < 8) {
+                        /*
+                         * The output repeats every dist bytes: write the
+                         * first multiple of dist that is at least 8 byte
+                         * by byte, then copy words from that far back.
+                         */
+                        unsigned period = dist * ((8 + dist - 1) / dist);
+
+                        op = period < len ? period : len;
+                        len -= op;
+                        do {
+                            PUP(out) = PUP(from);
+                        } while (--op);
+                        from = out - period;
+                    }
+                    while (len >= 8) {
+                        put_unaligned(get_unaligned((u64 *)(from + OFF)),
+                                      (u64 *)(out + OFF));
+                        out += 8;
+                        from += 8;
+                        len -= 8;
+                    }
+                    while (len) {
+                        PUP(out) = PUP(from);
+                        len--;
+                    }
+                }
+#else
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
@@ -303,6 +355,7 @@ void inflate_fast(z_streamp strm, unsigned start)
 		    if (len & 1)
 			PUP(out) = PUP(from);
                 }
+#endif
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
                 this = dcode[this.val + (hold & ((1U << op) - 1))];
@@ -338,7 +391,9 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_IN - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_IN - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
                                  257 + (end - out) : 257 - (out - end));
     state->hold = hold;
@@ -8,4 +8,11 @@
    subject to change. Applications should only use zlib.h.
  */
 
+#if BITS_PER_LONG == 64 && defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#  define INFLATE_WIDE
+#  define INFLATE_FAST_MIN_IN 8
+#else
+#  define INFLATE_FAST_MIN_IN 6
+#endif
+
 void inflate_fast (z_streamp strm, unsigned start);
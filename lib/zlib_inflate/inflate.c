@@ -536,7 +536,11 @@ int zlib_inflate(z_streamp strm, int flush)
             /* build code tables */
             state->next = state->codes;
             state->lencode = (code const *)(state->next);
+#ifdef INFLATE_WIDE
+            state->lenbits = 10;
+#else
             state->lenbits = 9;
+#endif
             ret = zlib_inflate_table(LENS, state->lens, state->nlen, &(state->next),
                                 &(state->lenbits), state->work);
             if (ret) {
@@ -555,7 +559,7 @@ int zlib_inflate(z_streamp strm, int flush)
             }
             state->mode = LEN;
         case LEN:
-            if (have >= 6 && left >= 258) {
+            if (have >= INFLATE_FAST_MIN_IN && left >= 258) {
                 RESTORE();
                 inflate_fast(strm, out);
                 LOAD();
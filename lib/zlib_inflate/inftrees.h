@@ -42,7 +42,9 @@ typedef struct {
    exhaustive search was 1444 code structures (852 for length/literals
    and 592 for distances, the latter actually the result of an
    exhaustive search).  The true maximum is not known, but the value
-   below is more than safe. */
+   below is more than safe.  With INFLATE_WIDE, inflate() builds
+   length/literal tables with a 10 bit root, for which the exhaustive
+   maximum is 1332, still below ENOUGH - MAXD. */
 #define ENOUGH 2048
 #define MAXD 592
 
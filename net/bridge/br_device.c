@@ -104,9 +104,17 @@ static int br_dev_init(struct net_device *dev)
 	if (!br->stats)
 		return -ENOMEM;
 
+	err = br_fdb_hash_init(br);
+	if (err) {
+		free_percpu(br->stats);
+		return err;
+	}
+
 	err = br_vlan_init(br);
-	if (err)
+	if (err) {
+		br_fdb_hash_fini(br);
 		free_percpu(br->stats);
+	}
 	br_set_lockdep_class(dev);
 
 	return err;
@@ -355,6 +363,7 @@ static void br_dev_free(struct net_device *dev)
 {
 	struct net_bridge *br = netdev_priv(dev);
 
+	br_fdb_hash_fini(br);
 	free_percpu(br->stats);
 	free_netdev(dev);
 }
@@ -386,6 +395,7 @@ void br_dev_setup(struct net_device *dev)
 	spin_lock_init(&br->lock);
 	INIT_LIST_HEAD(&br->port_list);
 	spin_lock_init(&br->hash_lock);
+	INIT_HLIST_HEAD(&br->fdb_list);
 
 	br->bridge_id.prio[0] = 0x80;
 	br->bridge_id.prio[1] = 0x00;
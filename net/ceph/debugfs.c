@@ -3,6 +3,7 @@
 #include <linux/device.h>
 #include <linux/slab.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/ctype.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
@@ -55,15 +56,23 @@ static int osdmap_show(struct seq_file *s, void *p)
 	int i;
 	struct ceph_client *client = s->private;
 	struct ceph_osdmap *map = client->osdc.osdmap;
+	u64 hits = 0, misses = 0;
 	struct rb_node *n;
+	int cpu;
 
 	if (map == NULL)
 		return 0;
 
+	for_each_possible_cpu(cpu) {
+		hits += per_cpu_ptr(map->pg_cache_stats, cpu)->hits;
+		misses += per_cpu_ptr(map->pg_cache_stats, cpu)->misses;
+	}
+
 	seq_printf(s, "epoch %d\n", map->epoch);
 	seq_printf(s, "flags%s%s\n",
 		   (map->flags & CEPH_OSDMAP_NEARFULL) ?  " NEARFULL" : "",
 		   (map->flags & CEPH_OSDMAP_FULL) ?  " FULL" : "");
+	seq_printf(s, "pg_cache hits %llu misses %llu\n", hits, misses);
 
 	for (n = rb_first(&map->pg_pools); n; n = rb_next(n)) {
 		struct ceph_pg_pool_info *pool =
@@ -2178,6 +2178,7 @@ void ceph_osdc_handle_map(struct ceph_osd_client *osdc, struct ceph_msg *msg)
 done:
 	downgrade_write(&osdc->map_sem);
 	ceph_monc_got_osdmap(&osdc->client->monc, osdc->osdmap->epoch);
+	ceph_osdmap_precompute_pgs(osdc->osdmap);
 
 	/*
 	 * subscribe to subsequent osdmap updates if full to ensure
@@ -3,6 +3,8 @@
 
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
 #include <asm/div64.h>
 
 #include <linux/ceph/libceph.h>
@@ -533,6 +535,7 @@ EXPORT_SYMBOL(ceph_pg_poolid_by_name);
 static void __remove_pg_pool(struct rb_root *root, struct ceph_pg_pool_info *pi)
 {
 	rb_erase(&pi->node, root);
+	kvfree(pi->pg_cache);
 	kfree(pi->name);
 	kfree(pi);
 }
@@ -558,6 +561,10 @@ static int decode_pool(void **p, void *end, struct ceph_pg_pool_info *pi)
 	ceph_decode_need(p, end, len, bad);
 	pool_end = *p + len;
 
+	/* size and pg_num may change, the cache is rebuilt on demand */
+	kvfree(pi->pg_cache);
+	pi->pg_cache = NULL;
+
 	pi->type = ceph_decode_8(p);
 	pi->size = ceph_decode_8(p);
 	pi->crush_ruleset = ceph_decode_8(p);
@@ -681,6 +688,7 @@ void ceph_osdmap_destroy(struct ceph_osdmap *map)
 	kfree(map->osd_weight);
 	kfree(map->osd_addr);
 	kfree(map->osd_primary_affinity);
+	free_percpu(map->pg_cache_stats);
 	kfree(map);
 }
 
@@ -1182,6 +1190,12 @@ struct ceph_osdmap *ceph_osdmap_decode(void **p, void *end)
 	map->pg_temp = RB_ROOT;
 	map->primary_temp = RB_ROOT;
 	mutex_init(&map->crush_scratch_mutex);
+	spin_lock_init(&map->pg_cache_lock);
+	map->pg_cache_stats = alloc_percpu(struct ceph_pg_cache_stats);
+	if (!map->pg_cache_stats) {
+		kfree(map);
+		return ERR_PTR(-ENOMEM);
+	}
 
 	ret = osdmap_decode(p, end, map);
 	if (ret) {
@@ -1757,25 +1771,13 @@ static int apply_temps(struct ceph_osdmap *osdmap,
 	return temp_len;
 }
 
-/*
- * Calculate acting set for given pgid.
- *
- * Return acting set length, or error.  *primary is set to acting
- * primary osd id, or -1 if acting set is empty or on error.
- */
-int ceph_calc_pg_acting(struct ceph_osdmap *osdmap, struct ceph_pg pgid,
-			int *osds, int *primary)
+static int __calc_pg_acting(struct ceph_osdmap *osdmap,
+			    struct ceph_pg_pool_info *pool, struct ceph_pg pgid,
+			    int *osds, int *primary)
 {
-	struct ceph_pg_pool_info *pool;
 	u32 pps;
 	int len;
 
-	pool = __lookup_pg_pool(&osdmap->pg_pools, pgid.pool);
-	if (!pool) {
-		*primary = -1;
-		return -ENOENT;
-	}
-
 	if (pool->flags & CEPH_POOL_FLAG_HASHPSPOOL) {
 		/* hash pool id and seed so that pool PGs do not overlap */
 		pps = crush_hash32_2(CRUSH_HASH_RJENKINS1,
@@ -1809,6 +1811,192 @@ int ceph_calc_pg_acting(struct ceph_osdmap *osdmap, struct ceph_pg pgid,
 	return len;
 }
 
+/*
+ * PG mapping cache.
+ *
+ * The acting set of a PG is a pure function of the osdmap, so it only
+ * needs to be run through CRUSH once per epoch.  Each pool gets a lazily
+ * allocated array with one slot per PG (the seed folded by pg_num: both
+ * pps and the pg_temp lookups are invariant under that fold).  Pools with
+ * more than CEPH_PG_CACHE_MAX_PGS PGs get that many slots instead, each
+ * shared by the PGs equal to it modulo the slot count and tagged with the
+ * PG it holds.  A slot is valid only if it holds the PG looked up and was
+ * filled at the current epoch, so there is nothing
+ * to flush when an incremental map bumps map->epoch in place; decode_pool()
+ * drops the whole array if the pool itself changes.
+ *
+ * Map updates happen under osdc->map_sem held for write, lookups under it
+ * held for read.  Lookups that fill a slot serialize on pg_cache_lock and
+ * bump the slot's seqcount; hits only read the slot and retry if it was
+ * rewritten meanwhile, so they don't touch any shared cacheline.  The
+ * hit/miss counters are per cpu for the same reason.
+ */
+#define CEPH_PG_CACHE_MAX_PGS	65536
+
+struct ceph_pg_cache_entry {
+	seqcount_t seq;		/* raw accessors only, the slots are memset */
+	u32 epoch;
+	u32 ps;
+	int len;
+	int primary;
+	int osds[];
+};
+
+static unsigned int pg_cache_precompute;
+module_param(pg_cache_precompute, uint, 0644);
+MODULE_PARM_DESC(pg_cache_precompute,
+		 "precompute PG mappings for pools with at most this many PGs (0 = off, capped at 65536)");
+
+static int pg_cache_width(struct ceph_pg_pool_info *pool)
+{
+	return min_t(int, pool->size, CEPH_PG_MAX_SIZE);
+}
+
+static size_t pg_cache_stride(struct ceph_pg_pool_info *pool)
+{
+	return sizeof(struct ceph_pg_cache_entry) +
+	       pg_cache_width(pool) * sizeof(int);
+}
+
+static u32 pg_cache_slots(struct ceph_pg_pool_info *pool)
+{
+	return min_t(u32, pool->pg_num, CEPH_PG_CACHE_MAX_PGS);
+}
+
+static struct ceph_pg_cache_entry *
+pg_cache_entry(struct ceph_pg_pool_info *pool, u32 ps)
+{
+	u32 slot = ps < CEPH_PG_CACHE_MAX_PGS ? ps : ps % pg_cache_slots(pool);
+
+	return pool->pg_cache + slot * pg_cache_stride(pool);
+}
+
+/*
+ * Return the pool's cache, allocating it if necessary, or NULL if the
+ * pool should not (or cannot) be cached.
+ */
+static void *pg_cache_get(struct ceph_osdmap *osdmap,
+			  struct ceph_pg_pool_info *pool)
+{
+	void *cache;
+	size_t size;
+
+	cache = READ_ONCE(pool->pg_cache);
+	if (cache)
+		return cache;
+
+	if (!osdmap->epoch || !pool->pg_num)
+		return NULL;
+
+	/* zeroed slots carry epoch 0 and are therefore invalid */
+	size = pg_cache_slots(pool) * pg_cache_stride(pool);
+	cache = ceph_kvmalloc(size, GFP_NOFS);
+	if (!cache)
+		return NULL;
+	memset(cache, 0, size);
+
+	if (cmpxchg(&pool->pg_cache, NULL, cache)) {
+		kvfree(cache);
+		cache = pool->pg_cache;
+	}
+	return cache;
+}
+
+/*
+ * Calculate acting set for given pgid.
+ *
+ * Return acting set length, or error.  *primary is set to acting
+ * primary osd id, or -1 if acting set is empty or on error.
+ */
+int ceph_calc_pg_acting(struct ceph_osdmap *osdmap, struct ceph_pg pgid,
+			int *osds, int *primary)
+{
+	struct ceph_pg_pool_info *pool;
+	struct ceph_pg_cache_entry *entry;
+	unsigned int seq;
+	bool hit;
+	u32 ps;
+	int len;
+
+	pool = __lookup_pg_pool(&osdmap->pg_pools, pgid.pool);
+	if (!pool) {
+		*primary = -1;
+		return -ENOENT;
+	}
+
+	if (!pg_cache_get(osdmap, pool))
+		return __calc_pg_acting(osdmap, pool, pgid, osds, primary);
+
+	ps = ceph_stable_mod(pgid.seed, pool->pg_num, pool->pg_num_mask);
+	entry = pg_cache_entry(pool, ps);
+
+	do {
+		seq = raw_read_seqcount_begin(&entry->seq);
+		hit = READ_ONCE(entry->epoch) == osdmap->epoch &&
+		      READ_ONCE(entry->ps) == ps;
+		if (hit) {
+			/* each field is valid on its own, retry if mixed */
+			len = READ_ONCE(entry->len);
+			memcpy(osds, entry->osds, len * sizeof(int));
+			*primary = entry->primary;
+		}
+	} while (read_seqcount_retry(&entry->seq, seq));
+
+	if (hit) {
+		this_cpu_inc(osdmap->pg_cache_stats->hits);
+		return len;
+	}
+	this_cpu_inc(osdmap->pg_cache_stats->misses);
+
+	len = __calc_pg_acting(osdmap, pool, pgid, osds, primary);
+	if (len < 0 || len > pg_cache_width(pool))
+		return len;
+
+	spin_lock(&osdmap->pg_cache_lock);
+	raw_write_seqcount_begin(&entry->seq);
+	memcpy(entry->osds, osds, len * sizeof(int));
+	entry->len = len;
+	entry->primary = *primary;
+	entry->ps = ps;
+	entry->epoch = osdmap->epoch;
+	raw_write_seqcount_end(&entry->seq);
+	spin_unlock(&osdmap->pg_cache_lock);
+
+	return len;
+}
+
+/*
+ * Fill the PG mapping cache of every pool with at most
+ * pg_cache_precompute PGs, so that the first I/O to each PG after a map
+ * change doesn't have to run CRUSH.  Pools too large for a slot per PG
+ * are only cached as they are used.  Caller must hold osdc->map_sem.
+ */
+void ceph_osdmap_precompute_pgs(struct ceph_osdmap *osdmap)
+{
+	unsigned int max_pgs = min_t(unsigned int, READ_ONCE(pg_cache_precompute),
+				     CEPH_PG_CACHE_MAX_PGS);
+	int osds[CEPH_PG_MAX_SIZE];
+	struct rb_node *n;
+	int primary;
+
+	if (!max_pgs)
+		return;
+
+	for (n = rb_first(&osdmap->pg_pools); n; n = rb_next(n)) {
+		struct ceph_pg_pool_info *pool =
+			rb_entry(n, struct ceph_pg_pool_info, node);
+		struct ceph_pg pgid = { .pool = pool->id };
+
+		if (pool->pg_num > max_pgs)
+			continue;
+
+		for (pgid.seed = 0; pgid.seed < pool->pg_num; pgid.seed++) {
+			ceph_calc_pg_acting(osdmap, pgid, osds, &primary);
+			cond_resched();
+		}
+	}
+}
+
 /*
  * Return primary osd for given pgid, or -1 if none.
  */
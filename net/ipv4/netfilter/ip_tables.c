@@ -69,31 +69,92 @@ void *ipt_alloc_initial_table(const struct xt_table *info)
 }
 EXPORT_SYMBOL_GPL(ipt_alloc_initial_table);
 
-/* Returns whether matches rule or not. */
+/* Skip steps.
+ *
+ * For every rule and every criterion of its struct ipt_ip we record the
+ * offset of the next rule in the blob whose value for that criterion
+ * differs.  A packet that fails a criterion on one rule fails it on all
+ * following rules sharing the same value too, so the traversal can jump
+ * straight past them without changing first-match semantics or counters.
+ *
+ * The steps live right behind the entries in the same xt_table_info
+ * allocation, indexed by entry offset >> IPT_SKIP_SHIFT: every entry is
+ * larger than 1 << IPT_SKIP_SHIFT bytes, so each gets a unique slot.
+ */
+enum {
+	IPT_SKIP_SRC,
+	IPT_SKIP_DST,
+	IPT_SKIP_IN,
+	IPT_SKIP_OUT,
+	IPT_SKIP_PROTO,
+	IPT_SKIP_FRAG,
+	IPT_SKIP_COUNT,
+};
+
+#define IPT_SKIP_SHIFT	7
+
+static inline unsigned int ipt_skip_size(unsigned int size)
+{
+#ifdef CONFIG_IP_NF_IPTABLES_SKIP_STEPS
+	return sizeof(u32) +
+	       ((size >> IPT_SKIP_SHIFT) + 1) * IPT_SKIP_COUNT * sizeof(u32);
+#else
+	return 0;
+#endif
+}
+
+static inline u32 *ipt_skip_base(const void *entry0, unsigned int size)
+{
+	return (u32 *)(entry0 + ALIGN(size, sizeof(u32)));
+}
+
+/* Allocates a table_info for a @size byte ruleset plus its skip steps. */
+static struct xt_table_info *ipt_alloc_table_info(unsigned int size)
+{
+	struct xt_table_info *info;
+
+	if (ipt_skip_size(size) > UINT_MAX - size)
+		return NULL;
+
+	info = xt_alloc_table_info(size + ipt_skip_size(size));
+	if (info)
+		info->size = size;
+	return info;
+}
+
+/* Returns whether matches rule or not; on mismatch *crit is set to the
+ * IPT_SKIP_* criterion that failed. */
 /* Performance critical - called for every packet */
 static inline bool
 ip_packet_match(const struct iphdr *ip,
 		const char *indev,
 		const char *outdev,
 		const struct ipt_ip *ipinfo,
-		int isfrag)
+		int isfrag, unsigned int *crit)
 {
 	unsigned long ret;
 
 #define FWINV(bool, invflg) ((bool) ^ !!(ipinfo->invflags & (invflg)))
 
 	if (FWINV((ip->saddr&ipinfo->smsk.s_addr) != ipinfo->src.s_addr,
-		  IPT_INV_SRCIP) ||
-	    FWINV((ip->daddr&ipinfo->dmsk.s_addr) != ipinfo->dst.s_addr,
-		  IPT_INV_DSTIP)) {
-		dprintf("Source or dest mismatch.\n");
+		  IPT_INV_SRCIP)) {
+		dprintf("Source mismatch.\n");
 
 		dprintf("SRC: %pI4. Mask: %pI4. Target: %pI4.%s\n",
 			&ip->saddr, &ipinfo->smsk.s_addr, &ipinfo->src.s_addr,
 			ipinfo->invflags & IPT_INV_SRCIP ? " (INV)" : "");
+		*crit = IPT_SKIP_SRC;
+		return false;
+	}
+
+	if (FWINV((ip->daddr&ipinfo->dmsk.s_addr) != ipinfo->dst.s_addr,
+		  IPT_INV_DSTIP)) {
+		dprintf("Dest mismatch.\n");
+
 		dprintf("DST: %pI4 Mask: %pI4 Target: %pI4.%s\n",
 			&ip->daddr, &ipinfo->dmsk.s_addr, &ipinfo->dst.s_addr,
 			ipinfo->invflags & IPT_INV_DSTIP ? " (INV)" : "");
+		*crit = IPT_SKIP_DST;
 		return false;
 	}
 
@@ -103,6 +164,7 @@ ip_packet_match(const struct iphdr *ip,
 		dprintf("VIA in mismatch (%s vs %s).%s\n",
 			indev, ipinfo->iniface,
 			ipinfo->invflags & IPT_INV_VIA_IN ? " (INV)" : "");
+		*crit = IPT_SKIP_IN;
 		return false;
 	}
 
@@ -112,6 +174,7 @@ ip_packet_match(const struct iphdr *ip,
 		dprintf("VIA out mismatch (%s vs %s).%s\n",
 			outdev, ipinfo->outiface,
 			ipinfo->invflags & IPT_INV_VIA_OUT ? " (INV)" : "");
+		*crit = IPT_SKIP_OUT;
 		return false;
 	}
 
@@ -121,6 +184,7 @@ ip_packet_match(const struct iphdr *ip,
 		dprintf("Packet protocol %hi does not match %hi.%s\n",
 			ip->protocol, ipinfo->proto,
 			ipinfo->invflags & IPT_INV_PROTO ? " (INV)" : "");
+		*crit = IPT_SKIP_PROTO;
 		return false;
 	}
 
@@ -129,12 +193,48 @@ ip_packet_match(const struct iphdr *ip,
 	if (FWINV((ipinfo->flags&IPT_F_FRAG) && !isfrag, IPT_INV_FRAG)) {
 		dprintf("Fragment rule but not fragment.%s\n",
 			ipinfo->invflags & IPT_INV_FRAG ? " (INV)" : "");
+		*crit = IPT_SKIP_FRAG;
 		return false;
 	}
 
 	return true;
 }
 
+#ifdef CONFIG_IP_NF_IPTABLES_SKIP_STEPS
+/* Whether rules @a and @b give the same result for criterion @crit on
+ * any packet.  May report false negatives, never false positives. */
+static bool ipt_skip_same(const struct ipt_ip *a, const struct ipt_ip *b,
+			  unsigned int crit)
+{
+	u8 inv = a->invflags ^ b->invflags;
+
+	switch (crit) {
+	case IPT_SKIP_SRC:
+		return a->src.s_addr == b->src.s_addr &&
+		       a->smsk.s_addr == b->smsk.s_addr &&
+		       !(inv & IPT_INV_SRCIP);
+	case IPT_SKIP_DST:
+		return a->dst.s_addr == b->dst.s_addr &&
+		       a->dmsk.s_addr == b->dmsk.s_addr &&
+		       !(inv & IPT_INV_DSTIP);
+	case IPT_SKIP_IN:
+		return !memcmp(a->iniface, b->iniface, IFNAMSIZ) &&
+		       !memcmp(a->iniface_mask, b->iniface_mask, IFNAMSIZ) &&
+		       !(inv & IPT_INV_VIA_IN);
+	case IPT_SKIP_OUT:
+		return !memcmp(a->outiface, b->outiface, IFNAMSIZ) &&
+		       !memcmp(a->outiface_mask, b->outiface_mask, IFNAMSIZ) &&
+		       !(inv & IPT_INV_VIA_OUT);
+	case IPT_SKIP_PROTO:
+		return a->proto == b->proto && !(inv & IPT_INV_PROTO);
+	case IPT_SKIP_FRAG:
+		return (a->flags & IPT_F_FRAG) == (b->flags & IPT_F_FRAG) &&
+		       !(inv & IPT_INV_FRAG);
+	}
+	return false;
+}
+#endif
+
 static bool
 ip_checkentry(const struct ipt_ip *ip)
 {
@@ -282,6 +382,22 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/* Next rule that can possibly match after @e failed criterion @crit. */
+static inline struct ipt_entry *
+ipt_skip_entry(const void *table_base, const u32 *skip,
+	       const struct ipt_entry *e, unsigned int crit)
+{
+#ifdef CONFIG_IP_NF_IPTABLES_SKIP_STEPS
+	if (crit < IPT_SKIP_COUNT) {
+		unsigned int slot;
+
+		slot = ((const void *)e - table_base) >> IPT_SKIP_SHIFT;
+		return get_entry(table_base, skip[slot * IPT_SKIP_COUNT + crit]);
+	}
+#endif
+	return ipt_next_entry(e);
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(struct sk_buff *skb,
@@ -295,8 +411,9 @@ ipt_do_table(struct sk_buff *skb,
 	unsigned int verdict = NF_DROP;
 	const char *indev, *outdev;
 	const void *table_base;
+	const u32 *skip;
 	struct ipt_entry *e, **jumpstack;
-	unsigned int stackidx, cpu;
+	unsigned int stackidx, cpu, crit;
 	const struct xt_table_info *private;
 	struct xt_action_param acpar;
 	unsigned int addend;
@@ -332,6 +449,7 @@ ipt_do_table(struct sk_buff *skb,
 	 */
 	smp_read_barrier_depends();
 	table_base = private->entries;
+	skip       = ipt_skip_base(table_base, private->size);
 	jumpstack  = (struct ipt_entry **)private->jumpstack[cpu];
 
 	/* Switch to alternate jumpstack if we're being invoked via TEE.
@@ -357,17 +475,19 @@ ipt_do_table(struct sk_buff *skb,
 
 		IP_NF_ASSERT(e);
 		if (!ip_packet_match(ip, indev, outdev,
-		    &e->ip, acpar.fragoff)) {
+		    &e->ip, acpar.fragoff, &crit)) {
  no_match:
-			e = ipt_next_entry(e);
+			e = ipt_skip_entry(table_base, skip, e, crit);
 			continue;
 		}
 
 		xt_ematch_foreach(ematch, e) {
 			acpar.match     = ematch->u.kernel.match;
 			acpar.matchinfo = ematch->data;
-			if (!acpar.match->match(skb, &acpar))
+			if (!acpar.match->match(skb, &acpar)) {
+				crit = IPT_SKIP_COUNT;
 				goto no_match;
+			}
 		}
 
 		counter = xt_get_this_cpu_counter(&e->counters);
@@ -799,6 +919,52 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+#ifdef CONFIG_IP_NF_IPTABLES_SKIP_STEPS
+/* Computes the skip steps for the entries at @offsets: one linear pass per
+ * criterion, closing a run whenever the criterion value changes. */
+static void
+build_skip_steps(const struct xt_table_info *newinfo, void *entry0,
+		 const unsigned int *offsets)
+{
+	u32 *skip = ipt_skip_base(entry0, newinfo->size);
+	unsigned int number = newinfo->number;
+	unsigned int crit, run, i;
+
+	BUILD_BUG_ON(sizeof(struct ipt_entry) + sizeof(struct xt_entry_target)
+		     <= (1 << IPT_SKIP_SHIFT));
+
+	for (crit = 0; crit < IPT_SKIP_COUNT; crit++) {
+		run = 0;
+		for (i = 1; i <= number; i++) {
+			const struct ipt_entry *head = entry0 + offsets[run];
+			const struct ipt_entry *e;
+
+			if (i < number) {
+				e = entry0 + offsets[i];
+				if (ipt_skip_same(&head->ip, &e->ip, crit))
+					continue;
+			}
+
+			/* The last run has no differing successor: fall
+			 * back to plain next-entry stepping. */
+			for (; run < i; run++) {
+				e = entry0 + offsets[run];
+				skip[(offsets[run] >> IPT_SKIP_SHIFT) *
+				     IPT_SKIP_COUNT + crit] =
+					i < number ? offsets[i] :
+					offsets[run] + e->next_offset;
+			}
+		}
+	}
+}
+#else
+static inline void
+build_skip_steps(const struct xt_table_info *newinfo, void *entry0,
+		 const unsigned int *offsets)
+{
+}
+#endif
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -870,6 +1036,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		ret = -ELOOP;
 		goto out_free;
 	}
+	build_skip_steps(newinfo, entry0, offsets);
 	kvfree(offsets);
 
 	/* Finally, each sanity check must pass */
@@ -1286,7 +1453,7 @@ do_replace(struct net *net, const void __user *user, unsigned int len)
 
 	tmp.name[sizeof(tmp.name)-1] = 0;
 
-	newinfo = xt_alloc_table_info(tmp.size);
+	newinfo = ipt_alloc_table_info(tmp.size);
 	if (!newinfo)
 		return -ENOMEM;
 
@@ -1606,7 +1773,7 @@ translate_compat_table(struct net *net,
 	}
 
 	ret = -ENOMEM;
-	newinfo = xt_alloc_table_info(size);
+	newinfo = ipt_alloc_table_info(size);
 	if (!newinfo)
 		goto out_unlock;
 
@@ -1687,7 +1854,7 @@ compat_do_replace(struct net *net, void __user *user, unsigned int len)
 
 	tmp.name[sizeof(tmp.name)-1] = 0;
 
-	newinfo = xt_alloc_table_info(tmp.size);
+	newinfo = ipt_alloc_table_info(tmp.size);
 	if (!newinfo)
 		return -ENOMEM;
 
@@ -1938,7 +2105,7 @@ struct xt_table *ipt_register_table(struct net *net,
 	void *loc_cpu_entry;
 	struct xt_table *new_table;
 
-	newinfo = xt_alloc_table_info(repl->size);
+	newinfo = ipt_alloc_table_info(repl->size);
 	if (!newinfo) {
 		ret = -ENOMEM;
 		goto out;
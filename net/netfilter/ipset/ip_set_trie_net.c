@@ -0,0 +1,823 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Kernel module implementing an IP set type: the trie:net type
+ *
+ * The elements are the same as of hash:net, but they are stored in a
+ * path-compressed binary trie, so matching a packet is a single walk down
+ * the trie instead of one hash lookup per distinct prefix length in the set.
+ */
+
+#include <linux/module.h>
+#include <linux/ip.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/bitops.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/ipset/pfxlen.h>
+#include <linux/netfilter/ipset/ip_set.h>
+#include <linux/netfilter/ipset/ip_set_hash.h>
+
+#define IPSET_TYPE_REV_MIN	0
+#define IPSET_TYPE_REV_MAX	0
+
+MODULE_LICENSE("GPL");
+IP_SET_MODULE_DESC("trie:net", IPSET_TYPE_REV_MIN, IPSET_TYPE_REV_MAX);
+MODULE_ALIAS("ip_set_trie:net");
+
+#define HOST_MASK(set)		((set)->family == NFPROTO_IPV4 ? 32 : 128)
+
+/* Prefix lengths strictly grow downwards, so no path is longer than this */
+#define TRIE_NET_DEPTH		(128 + 1)
+
+#define trie_net_deref(p, set) \
+	rcu_dereference_protected(p, lockdep_is_held(&(set)->lock))
+
+/* Node flags */
+#define TRIE_NET_INTERMEDIATE	1	/* branching point, not an element */
+
+/* Trie node: element nodes are set->dsize long and carry the extensions */
+struct trie_net_node {
+	struct rcu_head rcu;
+	struct trie_net_node __rcu *child[2];
+	union nf_inet_addr ip;
+	u8 cidr;
+	u8 nomatch;
+	u8 flags;
+} __aligned(__alignof__(u64));
+
+/* Element passed to the add/del/test functions */
+struct trie_net_elem {
+	union nf_inet_addr ip;
+	u8 cidr;
+};
+
+/* Slot stack for the post-order walk of the pruning */
+struct trie_net_walk {
+	struct trie_net_node __rcu **slot;
+	bool done;
+};
+
+/* Type structure */
+struct trie_net {
+	struct trie_net_node __rcu *root;
+	struct timer_list gc;		/* garbage collection */
+	u32 maxelem;			/* max elements in the trie */
+	u32 elements;			/* current element number */
+	u32 nodes;			/* elements plus intermediate nodes */
+	u8 max_cidr;			/* largest prefix length in the set */
+	u32 nets[TRIE_NET_DEPTH];	/* elements per prefix length */
+	struct trie_net_walk walk[2 * TRIE_NET_DEPTH + 1];
+};
+
+/* Common functions */
+
+static inline u8
+trie_net_bit(const union nf_inet_addr *ip, u8 n)
+{
+	return (ntohl(ip->all[n / 32]) >> (31 - n % 32)) & 1;
+}
+
+/* Number of leading bits the addresses share, at most limit */
+static inline u8
+trie_net_match_len(const union nf_inet_addr *a, const union nf_inet_addr *b,
+		   u8 limit)
+{
+	u32 diff;
+	u8 len = 0;
+	int i;
+
+	for (i = 0; i < 4 && len < limit; i++, len += 32) {
+		diff = ntohl(a->all[i] ^ b->all[i]);
+		if (diff) {
+			len += 31 - __fls(diff);
+			break;
+		}
+	}
+	return min(len, limit);
+}
+
+static inline void
+trie_net_netmask(const struct ip_set *set, union nf_inet_addr *ip, u8 cidr)
+{
+	if (set->family == NFPROTO_IPV4)
+		ip->ip &= ip_set_netmask(cidr);
+	else
+		ip6_netmask(ip, cidr);
+}
+
+static inline bool
+trie_net_equal(const struct trie_net_node *node, const struct trie_net_elem *d)
+{
+	return node->cidr == d->cidr &&
+	       ipv6_addr_equal(&node->ip.in6, &d->ip.in6);
+}
+
+/* The node is a live element of the set */
+static inline bool
+trie_net_active(const struct ip_set *set, const struct trie_net_node *node)
+{
+	return !(node->flags & TRIE_NET_INTERMEDIATE) &&
+	       !(SET_WITH_TIMEOUT(set) &&
+		 ip_set_timeout_expired(ext_timeout(node, set)));
+}
+
+static void
+trie_net_add_cidr(struct trie_net *map, u8 cidr)
+{
+	map->nets[cidr]++;
+	if (cidr > map->max_cidr)
+		map->max_cidr = cidr;
+}
+
+static void
+trie_net_del_cidr(struct trie_net *map, u8 cidr)
+{
+	map->nets[cidr]--;
+	while (map->max_cidr && !map->nets[map->max_cidr])
+		map->max_cidr--;
+}
+
+/* Lookup functions, called under rcu_read_lock_bh() */
+
+static struct trie_net_node *
+trie_net_lookup(const struct ip_set *set, const union nf_inet_addr *ip)
+{
+	const struct trie_net *map = set->data;
+	struct trie_net_node *node, *found = NULL;
+
+	node = rcu_dereference_bh(map->root);
+	while (node) {
+		if (trie_net_match_len(&node->ip, ip, node->cidr) < node->cidr)
+			break;
+		/* The deeper the node, the longer the matching prefix */
+		if (trie_net_active(set, node))
+			found = node;
+		if (node->cidr == HOST_MASK(set))
+			break;
+		node = rcu_dereference_bh(node->child[trie_net_bit(ip,
+								   node->cidr)]);
+	}
+	return found;
+}
+
+static struct trie_net_node *
+trie_net_lookup_exact(const struct ip_set *set, const struct trie_net_elem *d)
+{
+	const struct trie_net *map = set->data;
+	struct trie_net_node *node;
+
+	node = rcu_dereference_bh(map->root);
+	while (node && node->cidr < d->cidr) {
+		if (trie_net_match_len(&node->ip, &d->ip, node->cidr) <
+		    node->cidr)
+			return NULL;
+		node = rcu_dereference_bh(node->child[trie_net_bit(&d->ip,
+								   node->cidr)]);
+	}
+	if (node && trie_net_equal(node, d) && trie_net_active(set, node))
+		return node;
+	return NULL;
+}
+
+/* Update functions, called under set->lock */
+
+/* Return the slot pointing to the node which equals to d or which should
+ * be below d, or to NULL. The slot of the parent node is stored in parent.
+ */
+static struct trie_net_node __rcu **
+trie_net_find(struct ip_set *set, const struct trie_net_elem *d,
+	      struct trie_net_node __rcu ***parent)
+{
+	struct trie_net *map = set->data;
+	struct trie_net_node __rcu **slot = &map->root;
+	struct trie_net_node *node;
+
+	*parent = NULL;
+	while ((node = trie_net_deref(*slot, set)) != NULL) {
+		if (node->cidr >= d->cidr ||
+		    trie_net_match_len(&node->ip, &d->ip, node->cidr) <
+		    node->cidr)
+			break;
+		*parent = slot;
+		slot = &node->child[trie_net_bit(&d->ip, node->cidr)];
+	}
+	return slot;
+}
+
+/* Link in the new element at the slot returned by trie_net_find() */
+static int
+trie_net_link(struct ip_set *set, struct trie_net_node __rcu **slot,
+	      struct trie_net_node *new)
+{
+	struct trie_net *map = set->data;
+	struct trie_net_node *node, *im;
+	u8 len, bit;
+
+	node = trie_net_deref(*slot, set);
+	if (!node) {
+		rcu_assign_pointer(*slot, new);
+		goto out;
+	}
+
+	len = trie_net_match_len(&node->ip, &new->ip,
+				 min(node->cidr, new->cidr));
+	if (len == node->cidr) {
+		/* Intermediate node of the same prefix: replace it */
+		RCU_INIT_POINTER(new->child[0],
+				 trie_net_deref(node->child[0], set));
+		RCU_INIT_POINTER(new->child[1],
+				 trie_net_deref(node->child[1], set));
+		rcu_assign_pointer(*slot, new);
+		kfree_rcu(node, rcu);
+		return 0;
+	}
+	if (len == new->cidr) {
+		/* The new element covers the node */
+		RCU_INIT_POINTER(new->child[trie_net_bit(&node->ip, len)],
+				 node);
+		rcu_assign_pointer(*slot, new);
+		goto out;
+	}
+
+	/* The prefixes diverge at bit len: add a branching point */
+	im = kzalloc(sizeof(*im), GFP_ATOMIC);
+	if (!im)
+		return -ENOMEM;
+	im->ip = new->ip;
+	trie_net_netmask(set, &im->ip, len);
+	im->cidr = len;
+	im->flags = TRIE_NET_INTERMEDIATE;
+	bit = trie_net_bit(&new->ip, len);
+	RCU_INIT_POINTER(im->child[bit], new);
+	RCU_INIT_POINTER(im->child[!bit], node);
+	rcu_assign_pointer(*slot, im);
+	map->nodes++;
+out:
+	map->nodes++;
+	return 0;
+}
+
+/* Turn an element into an intermediate node */
+static void
+trie_net_unset_elem(struct ip_set *set, struct trie_net_node *node)
+{
+	struct trie_net *map = set->data;
+
+	node->flags |= TRIE_NET_INTERMEDIATE;
+	map->elements--;
+	trie_net_del_cidr(map, node->cidr);
+	ip_set_ext_destroy(set, node);
+}
+
+/* Remove an intermediate node which does not branch anymore */
+static bool
+trie_net_compact(struct ip_set *set, struct trie_net_node __rcu **slot,
+		 struct trie_net_node *node)
+{
+	struct trie_net *map = set->data;
+	struct trie_net_node *c0, *c1;
+
+	if (!(node->flags & TRIE_NET_INTERMEDIATE))
+		return false;
+	c0 = trie_net_deref(node->child[0], set);
+	c1 = trie_net_deref(node->child[1], set);
+	if (c0 && c1)
+		return false;
+
+	rcu_assign_pointer(*slot, c0 ? c0 : c1);
+	map->nodes--;
+	kfree_rcu(node, rcu);
+	return true;
+}
+
+/* Delete the timed out elements or all elements when flushing. The trie is
+ * walked in post-order, so the subtrees are already compacted when a node
+ * is checked.
+ */
+static void
+trie_net_prune(struct ip_set *set, bool flush)
+{
+	struct trie_net *map = set->data;
+	struct trie_net_walk *w = map->walk;
+	struct trie_net_node *node;
+	int sp = 0;
+
+	w[0].slot = &map->root;
+	w[0].done = false;
+	while (sp >= 0) {
+		node = trie_net_deref(*w[sp].slot, set);
+		if (!node) {
+			sp--;
+			continue;
+		}
+		if (!w[sp].done) {
+			w[sp].done = true;
+			w[++sp].slot = &node->child[1];
+			w[sp].done = false;
+			w[++sp].slot = &node->child[0];
+			w[sp].done = false;
+			continue;
+		}
+		if (!(node->flags & TRIE_NET_INTERMEDIATE) &&
+		    (flush ||
+		     (SET_WITH_TIMEOUT(set) &&
+		      ip_set_timeout_expired(ext_timeout(node, set)))))
+			trie_net_unset_elem(set, node);
+		trie_net_compact(set, w[sp].slot, node);
+		sp--;
+	}
+}
+
+static int
+trie_net_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	      struct ip_set_ext *mext, u32 flags)
+{
+	const struct trie_net_elem *d = value;
+	struct trie_net_node *node;
+
+	/* If we test an IP address and not a network address,
+	 * look up the longest matching prefix
+	 */
+	if (d->cidr == HOST_MASK(set))
+		node = trie_net_lookup(set, &d->ip);
+	else
+		node = trie_net_lookup_exact(set, d);
+	if (!node)
+		return 0;
+
+	if (SET_WITH_COUNTER(set))
+		ip_set_update_counter(ext_counter(node, set),
+				      ext, mext, flags);
+	if (SET_WITH_SKBINFO(set))
+		ip_set_get_skbinfo(ext_skbinfo(node, set),
+				   ext, mext, flags);
+	return node->nomatch ? -ENOTEMPTY : 1;
+}
+
+static int
+trie_net_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	     struct ip_set_ext *mext, u32 flags)
+{
+	struct trie_net *map = set->data;
+	const struct trie_net_elem *d = value;
+	struct trie_net_node __rcu **slot, **parent;
+	struct trie_net_node *node, *new;
+	bool flag_exist = flags & IPSET_FLAG_EXIST;
+	int ret;
+
+	if (map->elements >= map->maxelem && SET_WITH_TIMEOUT(set))
+		trie_net_prune(set, false);
+
+	slot = trie_net_find(set, d, &parent);
+	node = trie_net_deref(*slot, set);
+	if (node && trie_net_equal(node, d) &&
+	    !(node->flags & TRIE_NET_INTERMEDIATE)) {
+		if (!flag_exist &&
+		    !(SET_WITH_TIMEOUT(set) &&
+		      ip_set_timeout_expired(ext_timeout(node, set))))
+			return -IPSET_ERR_EXIST;
+		/* Just the extensions could be overwritten */
+		new = node;
+		goto overwrite_extensions;
+	}
+	if (map->elements >= map->maxelem) {
+		if (net_ratelimit())
+			pr_warn("Set %s is full, maxelem %u reached\n",
+				set->name, map->maxelem);
+		return -IPSET_ERR_HASH_FULL;
+	}
+
+	new = kzalloc(set->dsize, GFP_ATOMIC);
+	if (!new)
+		return -ENOMEM;
+	new->ip = d->ip;
+	new->cidr = d->cidr;
+
+overwrite_extensions:
+	new->nomatch = (flags >> 16) & IPSET_FLAG_NOMATCH;
+	if (SET_WITH_COUNTER(set))
+		ip_set_init_counter(ext_counter(new, set), ext);
+	if (SET_WITH_COMMENT(set))
+		ip_set_init_comment(ext_comment(new, set), ext);
+	if (SET_WITH_SKBINFO(set))
+		ip_set_init_skbinfo(ext_skbinfo(new, set), ext);
+	/* Must come last for the case when timed out entry is reused */
+	if (SET_WITH_TIMEOUT(set))
+		ip_set_timeout_set(ext_timeout(new, set), ext->timeout);
+	if (new == node)
+		return 0;
+
+	ret = trie_net_link(set, slot, new);
+	if (ret) {
+		ip_set_ext_destroy(set, new);
+		kfree(new);
+		return ret;
+	}
+	map->elements++;
+	trie_net_add_cidr(map, d->cidr);
+
+	return 0;
+}
+
+static int
+trie_net_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
+	     struct ip_set_ext *mext, u32 flags)
+{
+	const struct trie_net_elem *d = value;
+	struct trie_net_node __rcu **slot, **parent;
+	struct trie_net_node *node;
+
+	slot = trie_net_find(set, d, &parent);
+	node = trie_net_deref(*slot, set);
+	if (!node || !trie_net_equal(node, d) || !trie_net_active(set, node))
+		return -IPSET_ERR_EXIST;
+
+	trie_net_unset_elem(set, node);
+	/* Removing a leaf may leave its parent without a branch */
+	if (trie_net_compact(set, slot, node) && parent)
+		trie_net_compact(set, parent, trie_net_deref(*parent, set));
+
+	return 0;
+}
+
+static int
+trie_net_kadt(struct ip_set *set, const struct sk_buff *skb,
+	      const struct xt_action_param *par,
+	      enum ipset_adt adt, struct ip_set_adt_opt *opt)
+{
+	const struct trie_net *map = set->data;
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = HOST_MASK(set) };
+	struct ip_set_ext ext = IP_SET_INIT_KEXT(skb, opt, set);
+
+	/* Add/delete the network of the largest prefix length in the set */
+	if (adt != IPSET_TEST && map->max_cidr)
+		e.cidr = map->max_cidr;
+
+	if (set->family == NFPROTO_IPV4)
+		ip4addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.ip);
+	else
+		ip6addrptr(skb, opt->flags & IPSET_DIM_ONE_SRC, &e.ip.in6);
+	trie_net_netmask(set, &e.ip, e.cidr);
+
+	return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+}
+
+static int
+trie_net_uadt(struct ip_set *set, struct nlattr *tb[],
+	      enum ipset_adt adt, u32 *lineno, u32 flags, bool retried)
+{
+	ipset_adtfn adtfn = set->variant->adt[adt];
+	struct trie_net_elem e = { .cidr = HOST_MASK(set) };
+	struct ip_set_ext ext = IP_SET_INIT_UEXT(set);
+	u32 ip = 0, ip_to = 0, last;
+	int ret;
+
+	if (tb[IPSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[IPSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[IPSET_ATTR_IP] ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_CADT_FLAGS)))
+		return -IPSET_ERR_PROTOCOL;
+	if (unlikely(tb[IPSET_ATTR_IP_TO] && set->family != NFPROTO_IPV4))
+		return -IPSET_ERR_HASH_RANGE_UNSUPPORTED;
+
+	if (set->family == NFPROTO_IPV4)
+		ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP], &ip);
+	else
+		ret = ip_set_get_ipaddr6(tb[IPSET_ATTR_IP], &e.ip);
+	if (ret)
+		return ret;
+
+	ret = ip_set_get_extensions(set, tb, &ext);
+	if (ret)
+		return ret;
+
+	if (tb[IPSET_ATTR_CIDR]) {
+		e.cidr = nla_get_u8(tb[IPSET_ATTR_CIDR]);
+		if (!e.cidr || e.cidr > HOST_MASK(set))
+			return -IPSET_ERR_INVALID_CIDR;
+	}
+
+	if (tb[IPSET_ATTR_CADT_FLAGS]) {
+		u32 cadt_flags = ip_set_get_h32(tb[IPSET_ATTR_CADT_FLAGS]);
+
+		if (cadt_flags & IPSET_FLAG_NOMATCH)
+			flags |= (IPSET_FLAG_NOMATCH << 16);
+	}
+
+	if (adt == IPSET_TEST || !tb[IPSET_ATTR_IP_TO]) {
+		if (set->family == NFPROTO_IPV4)
+			e.ip.ip = htonl(ip);
+		trie_net_netmask(set, &e.ip, e.cidr);
+		ret = adtfn(set, &e, &ext, &ext, flags);
+		return ip_set_enomatch(ret, flags, adt, set) ? -ret :
+		       ip_set_eexist(ret, flags) ? 0 : ret;
+	}
+
+	ret = ip_set_get_hostipaddr4(tb[IPSET_ATTR_IP_TO], &ip_to);
+	if (ret)
+		return ret;
+	if (ip_to < ip)
+		swap(ip, ip_to);
+	if (ip + UINT_MAX == ip_to)
+		return -IPSET_ERR_HASH_RANGE;
+
+	while (!after(ip, ip_to)) {
+		e.ip.ip = htonl(ip);
+		last = ip_set_range_to_cidr(ip, ip_to, &e.cidr);
+		ret = adtfn(set, &e, &ext, &ext, flags);
+		if (ret && !ip_set_eexist(ret, flags))
+			return ret;
+
+		ret = 0;
+		ip = last + 1;
+	}
+	return ret;
+}
+
+static void
+trie_net_flush(struct ip_set *set)
+{
+	trie_net_prune(set, true);
+}
+
+static void
+trie_net_destroy(struct ip_set *set)
+{
+	struct trie_net *map = set->data;
+
+	if (SET_WITH_TIMEOUT(set))
+		del_timer_sync(&map->gc);
+
+	spin_lock_bh(&set->lock);
+	trie_net_prune(set, true);
+	spin_unlock_bh(&set->lock);
+	kfree(map);
+
+	set->data = NULL;
+}
+
+static int
+trie_net_head(struct ip_set *set, struct sk_buff *skb)
+{
+	const struct trie_net *map = set->data;
+	struct nlattr *nested;
+	size_t memsize;
+
+	memsize = sizeof(*map) + map->elements * set->dsize +
+		  (map->nodes - map->elements) * sizeof(struct trie_net_node);
+
+	nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	if (nla_put_net32(skb, IPSET_ATTR_MAXELEM, htonl(map->maxelem)) ||
+	    nla_put_net32(skb, IPSET_ATTR_REFERENCES, htonl(set->ref - 1)) ||
+	    nla_put_net32(skb, IPSET_ATTR_MEMSIZE, htonl(memsize)))
+		goto nla_put_failure;
+	if (unlikely(ip_set_put_flags(skb, set)))
+		goto nla_put_failure;
+	ipset_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static bool
+trie_net_data_list(const struct ip_set *set, struct sk_buff *skb,
+		   const struct trie_net_node *node)
+{
+	u32 flags = node->nomatch ? IPSET_FLAG_NOMATCH : 0;
+
+	if (set->family == NFPROTO_IPV4) {
+		if (nla_put_ipaddr4(skb, IPSET_ATTR_IP, node->ip.ip))
+			goto nla_put_failure;
+	} else {
+		if (nla_put_ipaddr6(skb, IPSET_ATTR_IP, &node->ip.in6))
+			goto nla_put_failure;
+	}
+	if (nla_put_u8(skb, IPSET_ATTR_CIDR, node->cidr) ||
+	    (flags &&
+	     nla_put_net32(skb, IPSET_ATTR_CADT_FLAGS, htonl(flags))))
+		goto nla_put_failure;
+	return false;
+
+nla_put_failure:
+	return true;
+}
+
+/* Elements are dumped in pre-order, the position is their index in it */
+static int
+trie_net_list(const struct ip_set *set,
+	      struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct trie_net *map = set->data;
+	struct trie_net_node **stack, *node, *child;
+	struct nlattr *atd, *nested;
+	u32 i = 0, first = cb->args[IPSET_CB_ARG0];
+	int j, sp = 0, ret = 0;
+
+	stack = kmalloc_array(TRIE_NET_DEPTH + 1, sizeof(*stack), GFP_ATOMIC);
+	if (!stack)
+		return -ENOMEM;
+
+	atd = ipset_nest_start(skb, IPSET_ATTR_ADT);
+	if (!atd) {
+		kfree(stack);
+		return -EMSGSIZE;
+	}
+
+	rcu_read_lock();
+	node = rcu_dereference(map->root);
+	if (node)
+		stack[sp++] = node;
+	while (sp) {
+		node = stack[--sp];
+		for (j = 1; j >= 0; j--) {
+			child = rcu_dereference(node->child[j]);
+			if (child)
+				stack[sp++] = child;
+		}
+		if (!trie_net_active(set, node) || i++ < first)
+			continue;
+		nested = ipset_nest_start(skb, IPSET_ATTR_DATA);
+		if (!nested) {
+			if (i - 1 == first) {
+				nla_nest_cancel(skb, atd);
+				ret = -EMSGSIZE;
+				goto out;
+			}
+			goto nla_put_failure;
+		}
+		if (trie_net_data_list(set, skb, node))
+			goto nla_put_failure;
+		if (ip_set_put_extensions(skb, set, node, true))
+			goto nla_put_failure;
+		ipset_nest_end(skb, nested);
+	}
+
+	ipset_nest_end(skb, atd);
+	/* Set listing finished */
+	cb->args[IPSET_CB_ARG0] = 0;
+	goto out;
+
+nla_put_failure:
+	nla_nest_cancel(skb, nested);
+	if (unlikely(i - 1 == first)) {
+		pr_warn("Can't list set %s: one element does not fit into a message. Please report it!\n",
+			set->name);
+		cb->args[IPSET_CB_ARG0] = 0;
+		ret = -EMSGSIZE;
+	} else {
+		cb->args[IPSET_CB_ARG0] = i - 1;
+	}
+	ipset_nest_end(skb, atd);
+out:
+	rcu_read_unlock();
+	kfree(stack);
+	return ret;
+}
+
+static bool
+trie_net_same_set(const struct ip_set *a, const struct ip_set *b)
+{
+	const struct trie_net *x = a->data;
+	const struct trie_net *y = b->data;
+
+	return x->maxelem == y->maxelem &&
+	       a->timeout == b->timeout &&
+	       a->extensions == b->extensions;
+}
+
+static const struct ip_set_type_variant trie_net_variant = {
+	.kadt	= trie_net_kadt,
+	.uadt	= trie_net_uadt,
+	.adt	= {
+		[IPSET_ADD] = trie_net_add,
+		[IPSET_DEL] = trie_net_del,
+		[IPSET_TEST] = trie_net_test,
+	},
+	.destroy = trie_net_destroy,
+	.flush	= trie_net_flush,
+	.head	= trie_net_head,
+	.list	= trie_net_list,
+	.same_set = trie_net_same_set,
+};
+
+static void
+trie_net_gc(unsigned long ul_set)
+{
+	struct ip_set *set = (struct ip_set *)ul_set;
+	struct trie_net *map = set->data;
+
+	spin_lock_bh(&set->lock);
+	trie_net_prune(set, false);
+	spin_unlock_bh(&set->lock);
+
+	map->gc.expires = jiffies + IPSET_GC_PERIOD(set->timeout) * HZ;
+	add_timer(&map->gc);
+}
+
+static void
+trie_net_gc_init(struct ip_set *set, void (*gc)(unsigned long ul_set))
+{
+	struct trie_net *map = set->data;
+
+	init_timer(&map->gc);
+	map->gc.data = (unsigned long)set;
+	map->gc.function = gc;
+	map->gc.expires = jiffies + IPSET_GC_PERIOD(set->timeout) * HZ;
+	add_timer(&map->gc);
+}
+
+/* Create trie:net type of sets */
+
+static int
+trie_net_create(struct net *net, struct ip_set *set, struct nlattr *tb[],
+		u32 flags)
+{
+	u32 maxelem = IPSET_DEFAULT_MAXELEM;
+	struct trie_net *map;
+
+	if (!(set->family == NFPROTO_IPV4 || set->family == NFPROTO_IPV6))
+		return -IPSET_ERR_INVALID_FAMILY;
+
+	if (unlikely(!ip_set_optattr_netorder(tb, IPSET_ATTR_MAXELEM) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_TIMEOUT) ||
+		     !ip_set_optattr_netorder(tb, IPSET_ATTR_CADT_FLAGS)))
+		return -IPSET_ERR_PROTOCOL;
+
+	if (tb[IPSET_ATTR_MAXELEM])
+		maxelem = ip_set_get_h32(tb[IPSET_ATTR_MAXELEM]);
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+	map->maxelem = maxelem;
+	set->data = map;
+
+	set->variant = &trie_net_variant;
+	set->dsize = ip_set_elem_len(set, tb, sizeof(struct trie_net_node),
+				     __alignof__(struct trie_net_node));
+	if (tb[IPSET_ATTR_TIMEOUT]) {
+		set->timeout = ip_set_timeout_uget(tb[IPSET_ATTR_TIMEOUT]);
+		trie_net_gc_init(set, trie_net_gc);
+	}
+	return 0;
+}
+
+static struct ip_set_type trie_net_type __read_mostly = {
+	.name		= "trie:net",
+	.protocol	= IPSET_PROTOCOL,
+	.features	= IPSET_TYPE_IP | IPSET_TYPE_NOMATCH,
+	.dimension	= IPSET_DIM_ONE,
+	.family		= NFPROTO_UNSPEC,
+	.revision_min	= IPSET_TYPE_REV_MIN,
+	.revision_max	= IPSET_TYPE_REV_MAX,
+	.create		= trie_net_create,
+	.create_policy	= {
+		[IPSET_ATTR_MAXELEM]	= { .type = NLA_U32 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_CADT_FLAGS]	= { .type = NLA_U32 },
+	},
+	.adt_policy	= {
+		[IPSET_ATTR_IP]		= { .type = NLA_NESTED },
+		[IPSET_ATTR_IP_TO]	= { .type = NLA_NESTED },
+		[IPSET_ATTR_CIDR]	= { .type = NLA_U8 },
+		[IPSET_ATTR_TIMEOUT]	= { .type = NLA_U32 },
+		[IPSET_ATTR_LINENO]	= { .type = NLA_U32 },
+		[IPSET_ATTR_CADT_FLAGS]	= { .type = NLA_U32 },
+		[IPSET_ATTR_BYTES]	= { .type = NLA_U64 },
+		[IPSET_ATTR_PACKETS]	= { .type = NLA_U64 },
+		[IPSET_ATTR_COMMENT]	= { .type = NLA_NUL_STRING,
+					    .len  = IPSET_MAX_COMMENT_SIZE },
+		[IPSET_ATTR_SKBMARK]	= { .type = NLA_U64 },
+		[IPSET_ATTR_SKBPRIO]	= { .type = NLA_U32 },
+		[IPSET_ATTR_SKBQUEUE]	= { .type = NLA_U16 },
+	},
+	.me		= THIS_MODULE,
+};
+
+static int __init
+trie_net_init(void)
+{
+	return ip_set_type_register(&trie_net_type);
+}
+
+static void __exit
+trie_net_fini(void)
+{
+	rcu_barrier();
+	ip_set_type_unregister(&trie_net_type);
+}
+
+module_init(trie_net_init);
+module_exit(trie_net_fini);
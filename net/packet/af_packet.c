@@ -178,6 +178,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 
 #define PGV_FROM_VMALLOC 1
 
+/* TX ring frames sent per doorbell on the qdisc bypass path */
+#define PACKET_TX_BATCH 32
+
 #define BLOCK_STATUS(x)	((x)->hdr.bh1.block_status)
 #define BLOCK_NUM_PKTS(x)	((x)->hdr.bh1.num_pkts)
 #define BLOCK_O2FP(x)		((x)->hdr.bh1.offset_to_first_pkt)
@@ -282,6 +285,55 @@ drop:
 	return NET_XMIT_DROP;
 }
 
+/* Hand a list of validated skbs for the same tx queue to the driver under
+ * a single lock hold, with xmit_more set on all but the last one so that
+ * the doorbell is rung once per batch.  skbs which could not be sent are
+ * left on the list; they go back to the ring rather than being dropped.
+ */
+static int packet_direct_xmit_batch(struct sk_buff_head *batch)
+{
+	struct sk_buff *skb = skb_peek(batch);
+	struct net_device *dev = skb->dev;
+	struct netdev_queue *txq;
+	int ret = NETDEV_TX_BUSY;
+	bool more, doorbell_owed = false;
+
+	if (unlikely(!netif_running(dev) ||
+		     !netif_carrier_ok(dev)))
+		return NET_XMIT_DROP;
+
+	txq = skb_get_tx_queue(dev, skb);
+
+	local_bh_disable();
+
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	while (!skb_queue_empty(batch) &&
+	       !netif_xmit_frozen_or_drv_stopped(txq)) {
+		skb = __skb_dequeue(batch);
+		more = !skb_queue_empty(batch);
+		ret = netdev_start_xmit(skb, dev, txq, more);
+		/*
+		 * The skb before this one went out with xmit_more set, so
+		 * the driver has not rung the doorbell for it yet.  Offer
+		 * this one again as the last of the batch, like the qdisc
+		 * does with a requeued skb.  A driver that stops the queue
+		 * rings the doorbell itself.
+		 */
+		if (!dev_xmit_complete(ret) && more && doorbell_owed)
+			ret = netdev_start_xmit(skb, dev, txq, false);
+		if (!dev_xmit_complete(ret)) {
+			__skb_queue_head(batch, skb);
+			break;
+		}
+		doorbell_owed = more;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+
+	local_bh_enable();
+
+	return ret;
+}
+
 static struct net_device *packet_cached_dev_get(struct packet_sock *po)
 {
 	struct net_device *dev;
@@ -1196,6 +1248,13 @@ static void packet_increment_head(struct packet_ring_buffer *buff)
 	buff->head = buff->head != buff->frame_max ? buff->head+1 : 0;
 }
 
+static void packet_rewind_head(struct packet_ring_buffer *buff,
+			       unsigned int n)
+{
+	buff->head = (buff->head + buff->frame_max + 1 - n) %
+		     (buff->frame_max + 1);
+}
+
 static void packet_inc_pending(struct packet_ring_buffer *rb)
 {
 	this_cpu_inc(*rb->pending_refcnt);
@@ -2481,9 +2540,41 @@ static int tpacket_fill_skb(struct packet_sock *po, struct sk_buff *skb,
 	return tp_len;
 }
 
-static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
+/* Push out the frames tpacket_snd() queued for the qdisc bypass.  Frames
+ * the driver did not take are handed back to userspace as still pending
+ * and the ring head is moved back to the first of them, just like a frame
+ * which failed to be sent on its own.
+ */
+static int tpacket_flush_batch(struct packet_sock *po,
+			       struct sk_buff_head *batch)
 {
 	struct sk_buff *skb;
+	unsigned int unsent;
+	void *ph;
+	int err;
+
+	if (skb_queue_empty(batch))
+		return 0;
+
+	err = packet_direct_xmit_batch(batch);
+	unsent = skb_queue_len(batch);
+	if (likely(!unsent))
+		return 0;
+
+	packet_rewind_head(&po->tx_ring, unsent);
+	while ((skb = __skb_dequeue(batch)) != NULL) {
+		ph = skb_shinfo(skb)->destructor_arg;
+		kfree_skb(skb);
+		__packet_set_status(po, ph, TP_STATUS_SEND_REQUEST);
+	}
+
+	return net_xmit_errno(err) ? : -ENOBUFS;
+}
+
+static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
+{
+	struct sk_buff_head batch;
+	struct sk_buff *skb, *orig_skb;
 	struct net_device *dev;
 	__be16 proto;
 	int err, reserve = 0;
@@ -2495,7 +2586,9 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 	int len_sum = 0;
 	int status = TP_STATUS_AVAILABLE;
 	int hlen, tlen;
+	bool batched = packet_use_direct_xmit(po);
 
+	__skb_queue_head_init(&batch);
 	mutex_lock(&po->pg_vec_lock);
 
 	/* packet_sendmsg() check on tx_ring.pg_vec was lockless,
@@ -2546,6 +2639,10 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 		ph = packet_current_frame(po, &po->tx_ring,
 					  TP_STATUS_SEND_REQUEST);
 		if (unlikely(ph == NULL)) {
+			/* Batched frames count as pending until sent */
+			err = tpacket_flush_batch(po, &batch);
+			if (unlikely(err))
+				goto out_put;
 			if (need_wait && need_resched())
 				schedule();
 			continue;
@@ -2572,6 +2669,10 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 			tp_len = -EMSGSIZE;
 
 		if (unlikely(tp_len < 0)) {
+			/* Keep the batched frames contiguous in the ring */
+			err = tpacket_flush_batch(po, &batch);
+			if (unlikely(err))
+				goto out_status;
 			if (po->tp_loss) {
 				__packet_set_status(po, ph,
 						TP_STATUS_AVAILABLE);
@@ -2587,11 +2688,42 @@ static int tpacket_snd(struct packet_sock *po, struct msghdr *msg)
 
 		packet_pick_tx_queue(dev, skb);
 
+		if (batched && !skb_queue_empty(&batch) &&
+		    skb_get_queue_mapping(skb) !=
+		    skb_get_queue_mapping(skb_peek(&batch))) {
+			err = tpacket_flush_batch(po, &batch);
+			if (unlikely(err))
+				goto out_status;
+		}
+
 		skb->destructor = tpacket_destruct_skb;
 		__packet_set_status(po, ph, TP_STATUS_SENDING);
 		packet_inc_pending(&po->tx_ring);
 
 		status = TP_STATUS_SEND_REQUEST;
+		if (batched) {
+			orig_skb = skb;
+			skb = validate_xmit_skb_list(skb, dev);
+			if (likely(skb == orig_skb)) {
+				__skb_queue_tail(&batch, skb);
+				packet_increment_head(&po->tx_ring);
+				len_sum += tp_len;
+				/* Don't sleep on sndbuf for skbs we hold */
+				if (skb_queue_len(&batch) >= PACKET_TX_BATCH ||
+				    !sock_writeable(&po->sk)) {
+					err = tpacket_flush_batch(po, &batch);
+					if (unlikely(err))
+						goto out_put;
+				}
+				continue;
+			}
+			atomic_long_inc(&dev->tx_dropped);
+			kfree_skb_list(skb);
+			skb = NULL;
+			/* orig_skb was destructed already */
+			err = -ENOBUFS;
+			goto out_status;
+		}
 		err = po->xmit(skb);
 		if (unlikely(err > 0)) {
 			err = net_xmit_errno(err);
@@ -2625,6 +2757,12 @@ out_status:
 	__packet_set_status(po, ph, status);
 	kfree_skb(skb);
 out_put:
+	if (unlikely(!skb_queue_empty(&batch))) {
+		int ret = tpacket_flush_batch(po, &batch);
+
+		if (ret)
+			err = ret;
+	}
 	dev_put(dev);
 out:
 	mutex_unlock(&po->pg_vec_lock);
@@ -759,6 +759,20 @@ rpcrdma_conn_func(struct rpcrdma_ep *ep)
 	schedule_delayed_work(&ep->rep_connect_worker, 0);
 }
 
+/* Account the round trip of a request in the per-transport latency
+ * histogram.  Caller holds the transport_lock.
+ */
+static void
+rpcrdma_update_rtt_hist(struct rpcrdma_xprt *r_xprt, struct rpc_rqst *rqst)
+{
+	s64 usecs = ktime_us_delta(ktime_get(), rqst->rq_xtime);
+	int bucket = 0;
+
+	if (usecs > 1)
+		bucket = min_t(int, ilog2(usecs), RPCRDMA_RTT_BUCKETS - 1);
+	r_xprt->rx_stats.rtt_usec_hist[bucket]++;
+}
+
 /* Process received RPC/RDMA messages.
  *
  * Errors must result in the RPC task either being awakened, or
@@ -812,6 +826,7 @@ rpcrdma_reply_handler(struct rpcrdma_rep *rep)
 	/* from here on, the reply is no longer an orphan */
 	req->rl_reply = rep;
 	xprt->reestablish_timeout = 0;
+	rpcrdma_update_rtt_hist(r_xprt, rqst);
 
 	/* check for expected message types */
 	/* The order of some of these tests is important. */
@@ -68,6 +68,7 @@ static unsigned int xprt_rdma_max_inline_write = RPCRDMA_DEF_INLINE;
 static unsigned int xprt_rdma_inline_write_padding;
 static unsigned int xprt_rdma_memreg_strategy = RPCRDMA_FRMR;
 		int xprt_rdma_pad_optimize = 1;
+unsigned int xprt_rdma_send_batch = RPCRDMA_DEF_SEND_BATCH;
 
 #if IS_ENABLED(CONFIG_SUNRPC_DEBUG)
 
@@ -77,6 +78,8 @@ static unsigned int zero;
 static unsigned int max_padding = PAGE_SIZE;
 static unsigned int min_memreg = RPCRDMA_BOUNCEBUFFERS;
 static unsigned int max_memreg = RPCRDMA_LAST - 1;
+static unsigned int min_send_batch = 1;
+static unsigned int max_send_batch = RPCRDMA_MAX_SEND_BATCH;
 
 static struct ctl_table_header *sunrpc_table_header;
 
@@ -129,6 +132,15 @@ static struct ctl_table xr_tunables_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "rdma_send_batch",
+		.data		= &xprt_rdma_send_batch,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &min_send_batch,
+		.extra2		= &max_send_batch,
+	},
 	{ },
 };
 
@@ -589,6 +601,19 @@ xprt_rdma_free(void *buffer)
 	rpcrdma_buffer_put(req);
 }
 
+/*
+ * Another task is queued to transmit and will be given the transport
+ * as soon as the current sender lets go of it, so its SEND can share
+ * a doorbell with ours.  If the congestion window is closed, nobody is
+ * woken and the pending SENDs have to go out now: their replies are
+ * what opens the window.
+ */
+static bool
+xprt_rdma_more_sends(struct rpc_xprt *xprt)
+{
+	return xprt->sending.qlen && xprt->cong < xprt->cwnd;
+}
+
 /*
  * send_request invokes the meat of RPC RDMA. It must do the following:
  *  1.  Marshal the RPC request into an RPC RDMA request, which means
@@ -621,7 +646,8 @@ xprt_rdma_send_request(struct rpc_task *task)
 		goto drop_connection;
 	req->rl_connect_cookie = xprt->connect_cookie;
 
-	if (rpcrdma_ep_post(&r_xprt->rx_ia, &r_xprt->rx_ep, req))
+	if (rpcrdma_ep_post(&r_xprt->rx_ia, &r_xprt->rx_ep, req,
+			    xprt_rdma_more_sends(xprt)))
 		goto drop_connection;
 
 	rqst->rq_xmit_bytes_sent += rqst->rq_snd_buf.len;
@@ -639,10 +665,33 @@ drop_connection:
 	return -ENOTCONN;	/* implies disconnect */
 }
 
+/*
+ * Called with the transport_lock held by the task that owns the
+ * transport.  Post any SENDs still waiting for a doorbell unless the
+ * next owner is going to do it.
+ */
+static void
+xprt_rdma_release_xprt(struct rpc_xprt *xprt, struct rpc_task *task)
+{
+	struct rpcrdma_xprt *r_xprt = rpcx_to_rdmax(xprt);
+	struct rpcrdma_ep *ep = &r_xprt->rx_ep;
+
+	if (xprt->snd_task == task && ep->rep_send_head &&
+	    !xprt_rdma_more_sends(xprt) &&
+	    rpcrdma_ep_post_flush(&r_xprt->rx_ia, ep)) {
+		/* can't take transport_lock for xprt_disconnect_done() */
+		ep->rep_connected = -EIO;
+		rpcrdma_conn_func(ep);
+	}
+
+	xprt_release_xprt_cong(xprt, task);
+}
+
 static void xprt_rdma_print_stats(struct rpc_xprt *xprt, struct seq_file *seq)
 {
 	struct rpcrdma_xprt *r_xprt = rpcx_to_rdmax(xprt);
 	long idle_time = 0;
+	int i;
 
 	if (xprt_connected(xprt))
 		idle_time = (long)(jiffies - xprt->last_used) / HZ;
@@ -671,6 +720,14 @@ static void xprt_rdma_print_stats(struct rpc_xprt *xprt, struct seq_file *seq)
 		   r_xprt->rx_stats.failed_marshal_count,
 		   r_xprt->rx_stats.bad_reply_count,
 		   r_xprt->rx_stats.nomsg_call_count);
+	seq_printf(seq, "\txprt-rdma:\t%u %u %lu %lu",
+		   r_xprt->rx_ep.rep_inline_send,
+		   r_xprt->rx_ep.rep_inline_recv,
+		   r_xprt->rx_stats.send_wr_count,
+		   r_xprt->rx_stats.send_doorbell_count);
+	for (i = 0; i < RPCRDMA_RTT_BUCKETS; i++)
+		seq_printf(seq, " %lu", r_xprt->rx_stats.rtt_usec_hist[i]);
+	seq_putc(seq, '\n');
 }
 
 static int
@@ -690,7 +747,7 @@ xprt_rdma_disable_swap(struct rpc_xprt *xprt)
 
 static struct rpc_xprt_ops xprt_rdma_procs = {
 	.reserve_xprt		= xprt_reserve_xprt_cong,
-	.release_xprt		= xprt_release_xprt_cong, /* sunrpc/xprt.c */
+	.release_xprt		= xprt_rdma_release_xprt,
 	.alloc_slot		= xprt_alloc_slot,
 	.release_request	= xprt_release_rqst_cong,       /* ditto */
 	.set_retrans_timeout	= xprt_set_retrans_timeout_def, /* ditto */
@@ -272,6 +272,42 @@ rpcrdma_flush_cqs(struct rpcrdma_ep *ep)
 		rpcrdma_sendcq_process_wc(&wc);
 }
 
+/*
+ * Lower the inline thresholds to what the server can receive and send,
+ * if it told us.  The thresholds are never raised beyond the locally
+ * configured values, which is what the buffers were sized for.
+ */
+static void
+rpcrdma_update_connect_private(struct rpcrdma_xprt *r_xprt,
+			       struct rdma_conn_param *param)
+{
+	const struct rpcrdma_connect_private *pmsg = param->private_data;
+	struct rpcrdma_create_data_internal *cdata = &r_xprt->rx_data;
+	struct rpcrdma_ep *ep = &r_xprt->rx_ep;
+	unsigned int rsize, wsize;
+
+	ep->rep_inline_send = cdata->inline_wsize;
+	ep->rep_inline_recv = cdata->inline_rsize;
+
+	if (!pmsg || param->private_data_len < sizeof(*pmsg) ||
+	    pmsg->cp_magic != rpcrdma_cmp_magic ||
+	    pmsg->cp_version != RPCRDMA_CMP_VERSION)
+		return;
+
+	/* the server's send size is our receive size, and vice versa */
+	rsize = rpcrdma_decode_buffer_size(pmsg->cp_send_size);
+	wsize = rpcrdma_decode_buffer_size(pmsg->cp_recv_size);
+
+	if (rsize < ep->rep_inline_recv)
+		ep->rep_inline_recv = rsize;
+	if (wsize < ep->rep_inline_send)
+		ep->rep_inline_send = wsize;
+
+	dprintk("RPC:       %s: server send %u recv %u, using send %u recv %u\n",
+		__func__, rsize, wsize, ep->rep_inline_send,
+		ep->rep_inline_recv);
+}
+
 static int
 rpcrdma_conn_upcall(struct rdma_cm_id *id, struct rdma_cm_event *event)
 {
@@ -305,6 +341,7 @@ rpcrdma_conn_upcall(struct rdma_cm_id *id, struct rdma_cm_event *event)
 		break;
 	case RDMA_CM_EVENT_ESTABLISHED:
 		connstate = 1;
+		rpcrdma_update_connect_private(xprt, &event->param.conn);
 		ib_query_qp(ia->ri_id->qp, attr,
 			    IB_QP_MAX_QP_RD_ATOMIC | IB_QP_MAX_DEST_RD_ATOMIC,
 			    iattr);
@@ -352,6 +389,8 @@ connected:
 			ia->ri_ops->ro_displayname,
 			xprt->rx_buf.rb_max_requests,
 			ird, ird < 4 && ird < tird / 2 ? " (low!)" : "");
+		pr_info("rpcrdma: inline thresholds: send %u, receive %u\n",
+			ep->rep_inline_send, ep->rep_inline_recv);
 	} else if (connstate < 0) {
 		pr_info("rpcrdma: connection to %pIS:%u closed (%d)\n",
 			sap, rpc_get_port(sap), connstate);
@@ -664,9 +703,18 @@ rpcrdma_ep_create(struct rpcrdma_ep *ep, struct rpcrdma_ia *ia,
 
 	/* Initialize cma parameters */
 
-	/* RPC/RDMA does not use private data */
-	ep->rep_remote_cma.private_data = NULL;
-	ep->rep_remote_cma.private_data_len = 0;
+	/* Advertise our inline buffer sizes to the server */
+	ep->rep_inline_send = cdata->inline_wsize;
+	ep->rep_inline_recv = cdata->inline_rsize;
+	ep->rep_cm_private.cp_magic = rpcrdma_cmp_magic;
+	ep->rep_cm_private.cp_version = RPCRDMA_CMP_VERSION;
+	ep->rep_cm_private.cp_flags = 0;
+	ep->rep_cm_private.cp_send_size =
+		rpcrdma_encode_buffer_size(cdata->inline_wsize);
+	ep->rep_cm_private.cp_recv_size =
+		rpcrdma_encode_buffer_size(cdata->inline_rsize);
+	ep->rep_remote_cma.private_data = &ep->rep_cm_private;
+	ep->rep_remote_cma.private_data_len = sizeof(ep->rep_cm_private);
 
 	/* Client offers RDMA Read but does not initiate */
 	ep->rep_remote_cma.initiator_depth = 0;
@@ -879,6 +927,11 @@ rpcrdma_ep_disconnect(struct rpcrdma_ep *ep, struct rpcrdma_ia *ia)
 {
 	int rc;
 
+	/* Unposted SENDs are retransmitted after reconnect */
+	ep->rep_send_head = NULL;
+	ep->rep_send_tail = NULL;
+	ep->rep_send_count = 0;
+
 	rpcrdma_flush_cqs(ep);
 	rc = rdma_disconnect(ia->ri_id);
 	if (!rc) {
@@ -1245,17 +1298,53 @@ rpcrdma_free_regbuf(struct rpcrdma_ia *ia, struct rpcrdma_regbuf *rb)
 }
 
 /*
- * Prepost any receive buffer, then post send.
+ * Post the SENDs queued by rpcrdma_ep_post() with a single doorbell.
+ */
+int
+rpcrdma_ep_post_flush(struct rpcrdma_ia *ia, struct rpcrdma_ep *ep)
+{
+	struct rpcrdma_xprt *r_xprt = container_of(ep, struct rpcrdma_xprt,
+						   rx_ep);
+	struct ib_send_wr *send_wr_fail;
+	int rc;
+
+	if (!ep->rep_send_head)
+		return 0;
+
+	dprintk("RPC:       %s: posting %u SENDs\n", __func__,
+		ep->rep_send_count);
+
+	rc = ib_post_send(ia->ri_id->qp, ep->rep_send_head, &send_wr_fail);
+	if (rc)
+		dprintk("RPC:       %s: ib_post_send returned %i\n", __func__,
+			rc);
+
+	r_xprt->rx_stats.send_doorbell_count++;
+	ep->rep_send_head = NULL;
+	ep->rep_send_tail = NULL;
+	ep->rep_send_count = 0;
+	return rc;
+}
+
+/*
+ * Prepost any receive buffer, then queue the send.
  *
  * Receive buffer is donated to hardware, reclaimed upon recv completion.
+ * The SEND is posted right away unless the caller knows that another
+ * RPC is about to be sent, in which case it is chained to the pending
+ * SENDs and posted by a later call, or by rpcrdma_ep_post_flush(), once
+ * xprt_rdma_send_batch of them have accumulated.
  */
 int
 rpcrdma_ep_post(struct rpcrdma_ia *ia,
 		struct rpcrdma_ep *ep,
-		struct rpcrdma_req *req)
+		struct rpcrdma_req *req,
+		bool more)
 {
+	struct rpcrdma_xprt *r_xprt = container_of(ep, struct rpcrdma_xprt,
+						   rx_ep);
 	struct ib_device *device = ia->ri_device;
-	struct ib_send_wr send_wr, *send_wr_fail;
+	struct ib_send_wr *send_wr = &req->rl_send_wr;
 	struct rpcrdma_rep *rep = req->rl_reply;
 	struct ib_sge *iov = req->rl_send_iov;
 	int i, rc;
@@ -1267,29 +1356,36 @@ rpcrdma_ep_post(struct rpcrdma_ia *ia,
 		req->rl_reply = NULL;
 	}
 
-	send_wr.next = NULL;
-	send_wr.wr_id = RPCRDMA_IGNORE_COMPLETION;
-	send_wr.sg_list = iov;
-	send_wr.num_sge = req->rl_niovs;
-	send_wr.opcode = IB_WR_SEND;
+	send_wr->next = NULL;
+	send_wr->wr_id = RPCRDMA_IGNORE_COMPLETION;
+	send_wr->sg_list = iov;
+	send_wr->num_sge = req->rl_niovs;
+	send_wr->opcode = IB_WR_SEND;
 
-	for (i = 0; i < send_wr.num_sge; i++)
+	for (i = 0; i < send_wr->num_sge; i++)
 		ib_dma_sync_single_for_device(device, iov[i].addr,
 					      iov[i].length, DMA_TO_DEVICE);
-	dprintk("RPC:       %s: posting %d s/g entries\n",
-		__func__, send_wr.num_sge);
+	dprintk("RPC:       %s: queueing %d s/g entries\n",
+		__func__, send_wr->num_sge);
 
 	if (DECR_CQCOUNT(ep) > 0)
-		send_wr.send_flags = 0;
+		send_wr->send_flags = 0;
 	else { /* Provider must take a send completion every now and then */
 		INIT_CQCOUNT(ep);
-		send_wr.send_flags = IB_SEND_SIGNALED;
+		send_wr->send_flags = IB_SEND_SIGNALED;
 	}
 
-	rc = ib_post_send(ia->ri_id->qp, &send_wr, &send_wr_fail);
-	if (rc)
-		dprintk("RPC:       %s: ib_post_send returned %i\n", __func__,
-			rc);
+	if (ep->rep_send_tail)
+		ep->rep_send_tail->next = send_wr;
+	else
+		ep->rep_send_head = send_wr;
+	ep->rep_send_tail = send_wr;
+	ep->rep_send_count++;
+	r_xprt->rx_stats.send_wr_count++;
+
+	rc = 0;
+	if (!more || ep->rep_send_count >= READ_ONCE(xprt_rdma_send_batch))
+		rc = rpcrdma_ep_post_flush(ia, ep);
 out:
 	return rc;
 }
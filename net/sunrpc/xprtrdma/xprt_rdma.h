@@ -83,9 +83,19 @@ struct rpcrdma_ep {
 	int			rep_connected;
 	struct ib_qp_init_attr	rep_attr;
 	wait_queue_head_t 	rep_connect_wait;
+	struct rpcrdma_connect_private	rep_cm_private;
 	struct rdma_conn_param	rep_remote_cma;
 	struct sockaddr_storage	rep_remote_addr;
 	struct delayed_work	rep_connect_worker;
+
+	/* inline thresholds after negotiation with the peer */
+	unsigned int		rep_inline_send;
+	unsigned int		rep_inline_recv;
+
+	/* SENDs waiting for the next doorbell, serialized by XPRT_LOCKED */
+	struct ib_send_wr	*rep_send_head;
+	struct ib_send_wr	*rep_send_tail;
+	unsigned int		rep_send_count;
 };
 
 /*
@@ -94,6 +104,13 @@ struct rpcrdma_ep {
  */
 #define RPCRDMA_MAX_UNSIGNALED_SENDS	(32)
 
+/*
+ * Maximum number of SEND Work Requests chained onto one
+ * ib_post_send() call.
+ */
+#define RPCRDMA_DEF_SEND_BATCH		(16)
+#define RPCRDMA_MAX_SEND_BATCH		(64)
+
 #define INIT_CQCOUNT(ep) atomic_set(&(ep)->rep_cqcount, (ep)->rep_cqinit)
 #define DECR_CQCOUNT(ep) atomic_sub_return(1, &(ep)->rep_cqcount)
 
@@ -271,6 +288,7 @@ struct rpcrdma_req {
 	struct rpcrdma_buffer	*rl_buffer;
 	struct rpcrdma_rep	*rl_reply;/* holder for reply buffer */
 	struct ib_sge		rl_send_iov[RPCRDMA_MAX_IOVS];
+	struct ib_send_wr	rl_send_wr;
 	struct rpcrdma_regbuf	*rl_rdmabuf;
 	struct rpcrdma_regbuf	*rl_sendbuf;
 	struct rpcrdma_mr_seg	rl_segments[RPCRDMA_MAX_SEGS];
@@ -329,10 +347,10 @@ struct rpcrdma_create_data_internal {
 };
 
 #define RPCRDMA_INLINE_READ_THRESHOLD(rq) \
-	(rpcx_to_rdmad(rq->rq_xprt).inline_rsize)
+	(rpcx_to_rdmax(rq->rq_xprt)->rx_ep.rep_inline_recv)
 
 #define RPCRDMA_INLINE_WRITE_THRESHOLD(rq)\
-	(rpcx_to_rdmad(rq->rq_xprt).inline_wsize)
+	(rpcx_to_rdmax(rq->rq_xprt)->rx_ep.rep_inline_send)
 
 #define RPCRDMA_INLINE_PAD_VALUE(rq)\
 	rpcx_to_rdmad(rq->rq_xprt).padding
@@ -340,6 +358,8 @@ struct rpcrdma_create_data_internal {
 /*
  * Statistics for RPCRDMA
  */
+#define RPCRDMA_RTT_BUCKETS	(20)
+
 struct rpcrdma_stats {
 	unsigned long		read_chunk_count;
 	unsigned long		write_chunk_count;
@@ -355,6 +375,12 @@ struct rpcrdma_stats {
 	unsigned long		bad_reply_count;
 	unsigned long		nomsg_call_count;
 	unsigned long		bcall_count;
+
+	unsigned long		send_wr_count;
+	unsigned long		send_doorbell_count;
+
+	/* RPC round trip times, bucket n counts [2^n, 2^(n+1)) usecs */
+	unsigned long		rtt_usec_hist[RPCRDMA_RTT_BUCKETS];
 };
 
 /*
@@ -406,6 +432,7 @@ struct rpcrdma_xprt {
  * Setting this to 1 enhances certain unaligned read/write performance.
  * Default is 0, see sysctl entry and rpc_rdma.c rpcrdma_convert_iovs() */
 extern int xprt_rdma_pad_optimize;
+extern unsigned int xprt_rdma_send_batch;
 
 /*
  * Interface Adapter calls - xprtrdma/verbs.c
@@ -423,7 +450,8 @@ int rpcrdma_ep_connect(struct rpcrdma_ep *, struct rpcrdma_ia *);
 void rpcrdma_ep_disconnect(struct rpcrdma_ep *, struct rpcrdma_ia *);
 
 int rpcrdma_ep_post(struct rpcrdma_ia *, struct rpcrdma_ep *,
-				struct rpcrdma_req *);
+				struct rpcrdma_req *, bool);
+int rpcrdma_ep_post_flush(struct rpcrdma_ia *, struct rpcrdma_ep *);
 int rpcrdma_ep_post_recv(struct rpcrdma_ia *, struct rpcrdma_ep *,
 				struct rpcrdma_rep *);
 
@@ -16,6 +16,8 @@
 #include <net/ip_tunnels.h>
 #include <net/ip6_tunnel.h>
 
+#include "xfrm_parallel.h"
+
 static struct kmem_cache *secpath_cachep __read_mostly;
 
 static DEFINE_SPINLOCK(xfrm_input_afinfo_lock);
@@ -190,6 +192,7 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 	struct xfrm_mode *inner_mode;
 	u32 mark = skb->mark;
 	unsigned int family;
+	struct xfrm_par_slot *par_slot;
 	int decaps = 0;
 	int async = 0;
 
@@ -199,6 +202,8 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 		x = xfrm_input_state(skb);
 		seq = XFRM_SKB_CB(skb)->seq.input.low;
 		family = x->outer_mode->afinfo->family;
+		if (xfrm_par_enabled(x) && xfrm_par_input_done(x, skb, nexthdr))
+			return 0;
 		goto resume;
 	}
 
@@ -279,9 +284,21 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 			goto drop_unlock;
 		}
 
+		/* Parallel crypto takes its ring slot in replay check order */
+		par_slot = NULL;
+		if (xfrm_par_enabled(x)) {
+			par_slot = xfrm_par_reserve(x, skb, false);
+			if (IS_ERR(par_slot)) {
+				XFRM_INC_STATS(net, LINUX_MIB_XFRMINBUFFERERROR);
+				goto drop_unlock;
+			}
+		}
+
 		spin_unlock(&x->lock);
 
 		if (xfrm_tunnel_check(skb, x, family)) {
+			if (par_slot)
+				xfrm_par_cancel(par_slot);
 			XFRM_INC_STATS(net, LINUX_MIB_XFRMINSTATEMODEERROR);
 			goto drop;
 		}
@@ -294,7 +311,10 @@ int xfrm_input(struct sk_buff *skb, int nexthdr, __be32 spi, int encap_type)
 		skb_dst_force(skb);
 		dev_hold(skb->dev);
 
-		nexthdr = x->type->input(x, skb);
+		if (par_slot)
+			nexthdr = xfrm_par_dispatch(par_slot);
+		else
+			nexthdr = x->type->input(x, skb);
 
 		if (nexthdr == -EINPROGRESS)
 			return 0;
@@ -398,4 +418,5 @@ void __init xfrm_input_init(void)
 					   sizeof(struct sec_path),
 					   0, SLAB_HWCACHE_ALIGN|SLAB_PANIC,
 					   NULL);
+	xfrm_par_init();
 }
@@ -19,6 +19,8 @@
 #include <net/dst.h>
 #include <net/xfrm.h>
 
+#include "xfrm_parallel.h"
+
 static int xfrm_output2(struct net *net, struct sock *sk, struct sk_buff *skb);
 
 static int xfrm_skb_check_space(struct sk_buff *skb)
@@ -55,6 +57,7 @@ static int xfrm_output_one(struct sk_buff *skb, int err)
 	struct dst_entry *dst = skb_dst(skb);
 	struct xfrm_state *x = dst->xfrm;
 	struct net *net = xs_net(x);
+	struct xfrm_par_slot *par_slot;
 
 	if (err <= 0)
 		goto resume;
@@ -98,11 +101,25 @@ static int xfrm_output_one(struct sk_buff *skb, int err)
 		x->curlft.bytes += skb->len;
 		x->curlft.packets++;
 
+		/* Parallel crypto takes its ring slot in sequence order */
+		par_slot = NULL;
+		if (xfrm_par_enabled(x)) {
+			par_slot = xfrm_par_reserve(x, skb, true);
+			if (IS_ERR(par_slot)) {
+				XFRM_INC_STATS(net, LINUX_MIB_XFRMOUTERROR);
+				err = PTR_ERR(par_slot);
+				goto error;
+			}
+		}
+
 		spin_unlock_bh(&x->lock);
 
 		skb_dst_force(skb);
 
-		err = x->type->output(x, skb);
+		if (par_slot)
+			err = xfrm_par_dispatch(par_slot);
+		else
+			err = x->type->output(x, skb);
 		if (err == -EINPROGRESS)
 			goto out;
 
@@ -134,7 +151,12 @@ out:
 
 int xfrm_output_resume(struct sk_buff *skb, int err)
 {
-	struct net *net = xs_net(skb_dst(skb)->xfrm);
+	struct xfrm_state *x = skb_dst(skb)->xfrm;
+	struct net *net = xs_net(x);
+
+	if (err <= 0 && xfrm_par_enabled(x) &&
+	    xfrm_par_output_done(x, skb, err))
+		return 0;
 
 	while (likely((err = xfrm_output_one(skb, err)) == 0)) {
 		nf_reset(skb);
@@ -0,0 +1,390 @@
+/*
+ * xfrm_parallel.c - Spread the crypto of a single SA over several CPUs.
+ *
+ * An SA flagged with XFRM_SA_XFLAG_PARALLEL does not run its ESP/AH
+ * transform on the CPU that received (or sent) the packet.  Packets are
+ * instead handed out in batches of XFRM_PAR_BATCH to per-CPU workers,
+ * round robin over the first net.core.xfrm_parallel_cpus online CPUs.
+ * Every packet takes a slot in a per-SA, per-direction ring under x->lock,
+ * in the same critical section that assigns its sequence number (output)
+ * or checks it against the replay window (input).  Slots are delivered
+ * back into xfrm_input_resume() or xfrm_output_resume() strictly in ring
+ * order, so the SA's packet order and the in-order advance of its replay
+ * window are preserved.  A packet that finds the ring full is dropped: it
+ * must not overtake the packets in flight, and x->lock can't be held while
+ * waiting for a slot.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/cpumask.h>
+#include <linux/hashtable.h>
+#include <linux/list.h>
+#include <linux/percpu.h>
+#include <linux/rhashtable.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <net/xfrm.h>
+
+#include "xfrm_parallel.h"
+
+#define XFRM_PAR_RING	128	/* packets in flight per SA and direction */
+#define XFRM_PAR_BATCH	16	/* consecutive packets given to one CPU */
+#define XFRM_PAR_HASH_BITS	6	/* busy slots, hashed by skb */
+
+enum {
+	XFRM_PAR_FREE,
+	XFRM_PAR_BUSY,
+	XFRM_PAR_DONE,
+};
+
+struct xfrm_par_queue;
+
+struct xfrm_par_slot {
+	struct list_head	list;
+	struct hlist_node	node;
+	struct xfrm_par_queue	*q;
+	struct sk_buff		*skb;
+	int			ret;
+	int			state;
+	int			cpu;
+};
+
+struct xfrm_par_queue {
+	spinlock_t		lock;
+	struct xfrm_state	*x;
+	bool			output;
+	bool			draining;
+	u32			head;	/* oldest slot not yet delivered */
+	u32			tail;	/* next slot to hand out */
+	unsigned int		batch;	/* packets left for the current cpu */
+	unsigned int		cpu_idx;
+	int			cpu;
+	DECLARE_HASHTABLE(busy, XFRM_PAR_HASH_BITS);
+	struct xfrm_par_slot	slots[XFRM_PAR_RING];
+};
+
+struct xfrm_par_ctx {
+	struct rhash_head	node;
+	struct xfrm_state	*x;
+	struct rcu_head		rcu;
+	struct xfrm_par_queue	in;
+	struct xfrm_par_queue	out;
+};
+
+struct xfrm_par_cpu {
+	spinlock_t		lock;
+	struct list_head	list;
+	struct work_struct	work;
+};
+
+static DEFINE_PER_CPU(struct xfrm_par_cpu, xfrm_par_cpus);
+static DEFINE_PER_CPU(struct sk_buff *, xfrm_par_delivering);
+static struct workqueue_struct *xfrm_par_wq __read_mostly;
+static struct rhashtable xfrm_par_ctxs;
+
+static const struct rhashtable_params xfrm_par_params = {
+	.head_offset		= offsetof(struct xfrm_par_ctx, node),
+	.key_offset		= offsetof(struct xfrm_par_ctx, x),
+	.key_len		= sizeof(struct xfrm_state *),
+	.automatic_shrinking	= true,
+};
+
+static struct xfrm_par_ctx *xfrm_par_ctx_get(struct xfrm_state *x)
+{
+	return rhashtable_lookup_fast(&xfrm_par_ctxs, &x, xfrm_par_params);
+}
+
+static void xfrm_par_queue_init(struct xfrm_par_queue *q,
+				struct xfrm_state *x, bool output)
+{
+	int i;
+
+	spin_lock_init(&q->lock);
+	q->x = x;
+	q->output = output;
+	for (i = 0; i < XFRM_PAR_RING; i++)
+		q->slots[i].q = q;
+}
+
+int xfrm_par_state_init(struct xfrm_state *x)
+{
+	struct xfrm_par_ctx *ctx;
+	int err;
+
+	if (!xfrm_par_enabled(x) || xfrm_par_ctx_get(x))
+		return 0;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->x = x;
+	xfrm_par_queue_init(&ctx->in, x, false);
+	xfrm_par_queue_init(&ctx->out, x, true);
+
+	err = rhashtable_lookup_insert_fast(&xfrm_par_ctxs, &ctx->node,
+					    xfrm_par_params);
+	if (err)
+		kfree(ctx);
+	return err;
+}
+
+/* Packets in flight hold a reference on x, so the rings are empty here. */
+void xfrm_par_state_destroy(struct xfrm_state *x)
+{
+	struct xfrm_par_ctx *ctx;
+
+	if (!xfrm_par_enabled(x))
+		return;
+
+	ctx = xfrm_par_ctx_get(x);
+	if (!ctx)
+		return;
+
+	WARN_ON(ctx->in.head != ctx->in.tail || ctx->out.head != ctx->out.tail);
+	rhashtable_remove_fast(&xfrm_par_ctxs, &ctx->node, xfrm_par_params);
+	kfree_rcu(ctx, rcu);
+}
+
+/*
+ * Called with q->lock held, drops it.  Only one CPU delivers at a time;
+ * a CPU finishing a packet while another one is delivering just leaves
+ * its slot marked done and the deliverer picks it up.
+ */
+static void xfrm_par_deliver(struct xfrm_par_queue *q)
+	__releases(q->lock)
+{
+	struct xfrm_par_slot *slot;
+	struct sk_buff *skb;
+	int ret;
+
+	if (q->draining) {
+		spin_unlock_bh(&q->lock);
+		return;
+	}
+	q->draining = true;
+
+	while (q->head != q->tail) {
+		slot = &q->slots[q->head & (XFRM_PAR_RING - 1)];
+		if (slot->state != XFRM_PAR_DONE)
+			break;
+
+		skb = slot->skb;
+		ret = slot->ret;
+		slot->skb = NULL;
+		slot->state = XFRM_PAR_FREE;
+		q->head++;
+		if (!skb)	/* cancelled */
+			continue;
+		spin_unlock_bh(&q->lock);
+
+		local_bh_disable();
+		__this_cpu_write(xfrm_par_delivering, skb);
+		if (q->output)
+			xfrm_output_resume(skb, ret);
+		else
+			xfrm_input_resume(skb, ret);
+		__this_cpu_write(xfrm_par_delivering, NULL);
+		local_bh_enable();
+
+		spin_lock_bh(&q->lock);
+	}
+
+	q->draining = false;
+	spin_unlock_bh(&q->lock);
+}
+
+static void xfrm_par_complete(struct xfrm_par_slot *slot, int ret)
+{
+	struct xfrm_par_queue *q = slot->q;
+
+	spin_lock_bh(&q->lock);
+	hash_del(&slot->node);
+	slot->ret = ret;
+	slot->state = XFRM_PAR_DONE;
+	xfrm_par_deliver(q);
+}
+
+/*
+ * Asynchronous crypto completes through xfrm_{input,output}_resume(),
+ * which hand the packet back here if it still owns a busy slot.  Packets
+ * that we are delivering ourselves are recognised without a lookup, and
+ * busy slots are found through a hash of their skb.
+ */
+static bool xfrm_par_done(struct xfrm_state *x, struct sk_buff *skb,
+			  bool output, int ret)
+{
+	struct xfrm_par_queue *q;
+	struct xfrm_par_slot *slot;
+	struct xfrm_par_ctx *ctx;
+
+	if (this_cpu_read(xfrm_par_delivering) == skb)
+		return false;
+
+	ctx = xfrm_par_ctx_get(x);
+	if (!ctx)
+		return false;
+	q = output ? &ctx->out : &ctx->in;
+
+	spin_lock_bh(&q->lock);
+	hash_for_each_possible(q->busy, slot, node, (unsigned long)skb) {
+		if (slot->skb == skb) {
+			hash_del(&slot->node);
+			slot->ret = ret;
+			slot->state = XFRM_PAR_DONE;
+			xfrm_par_deliver(q);
+			return true;
+		}
+	}
+	spin_unlock_bh(&q->lock);
+
+	return false;
+}
+
+bool xfrm_par_input_done(struct xfrm_state *x, struct sk_buff *skb,
+			 int nexthdr)
+{
+	return xfrm_par_done(x, skb, false, nexthdr);
+}
+
+bool xfrm_par_output_done(struct xfrm_state *x, struct sk_buff *skb, int err)
+{
+	return xfrm_par_done(x, skb, true, err);
+}
+
+static void xfrm_par_crypt(struct xfrm_par_slot *slot)
+{
+	struct xfrm_state *x = slot->q->x;
+	struct sk_buff *skb = slot->skb;
+	int ret;
+
+	if (slot->q->output)
+		ret = x->type->output(x, skb);
+	else
+		ret = x->type->input(x, skb);
+
+	if (ret != -EINPROGRESS)
+		xfrm_par_complete(slot, ret);
+}
+
+static void xfrm_par_work(struct work_struct *work)
+{
+	struct xfrm_par_cpu *pcpu = container_of(work, struct xfrm_par_cpu,
+						 work);
+	struct xfrm_par_slot *slot, *tmp;
+	LIST_HEAD(list);
+
+	spin_lock_bh(&pcpu->lock);
+	list_splice_init(&pcpu->list, &list);
+	spin_unlock_bh(&pcpu->lock);
+
+	list_for_each_entry_safe(slot, tmp, &list, list) {
+		local_bh_disable();
+		xfrm_par_crypt(slot);
+		local_bh_enable();
+		cond_resched();
+	}
+}
+
+/*
+ * Called with x->lock held, right after the packet's sequence number was
+ * assigned or checked, so that ring order is sequence order.  Returns NULL
+ * if the SA has no parallel context and the packet is transformed in
+ * place, or ERR_PTR(-ENOBUFS) if the ring is full and it has to be dropped.
+ */
+struct xfrm_par_slot *xfrm_par_reserve(struct xfrm_state *x,
+				       struct sk_buff *skb, bool output)
+{
+	struct xfrm_par_slot *slot = ERR_PTR(-ENOBUFS);
+	struct xfrm_par_queue *q;
+	struct xfrm_par_ctx *ctx;
+	unsigned int ncpus;
+	u32 limit;
+
+	ctx = xfrm_par_ctx_get(x);
+	if (!ctx)
+		return NULL;
+
+	if (output) {
+		q = &ctx->out;
+		limit = XFRM_PAR_RING;
+	} else {
+		q = &ctx->in;
+		limit = min_t(u32, xfrm_replay_par_limit(x), XFRM_PAR_RING);
+	}
+
+	spin_lock_bh(&q->lock);
+	if (q->tail - q->head >= limit)
+		goto out;
+
+	slot = &q->slots[q->tail++ & (XFRM_PAR_RING - 1)];
+	slot->skb = skb;
+	slot->state = XFRM_PAR_BUSY;
+	hash_add(q->busy, &slot->node, (unsigned long)skb);
+
+	if (!q->batch) {
+		ncpus = num_online_cpus();
+		if (xs_net(x)->xfrm.sysctl_par_cpus > 0 &&
+		    xs_net(x)->xfrm.sysctl_par_cpus < ncpus)
+			ncpus = xs_net(x)->xfrm.sysctl_par_cpus;
+		q->cpu_idx = (q->cpu_idx + 1) % ncpus;
+		q->cpu = cpumask_local_spread(q->cpu_idx, NUMA_NO_NODE);
+		q->batch = XFRM_PAR_BATCH;
+	}
+	q->batch--;
+	slot->cpu = q->cpu;
+out:
+	spin_unlock_bh(&q->lock);
+	return slot;
+}
+
+/*
+ * Hands a reserved slot to its worker.  Returns -EINPROGRESS; the caller
+ * then treats the packet exactly like one under asynchronous crypto.
+ */
+int xfrm_par_dispatch(struct xfrm_par_slot *slot)
+{
+	struct xfrm_par_cpu *pcpu = per_cpu_ptr(&xfrm_par_cpus, slot->cpu);
+
+	spin_lock_bh(&pcpu->lock);
+	list_add_tail(&slot->list, &pcpu->list);
+	spin_unlock_bh(&pcpu->lock);
+	queue_work_on(slot->cpu, xfrm_par_wq, &pcpu->work);
+
+	return -EINPROGRESS;
+}
+
+/* The packet of a reserved slot was dropped before it could be dispatched */
+void xfrm_par_cancel(struct xfrm_par_slot *slot)
+{
+	struct xfrm_par_queue *q = slot->q;
+
+	spin_lock_bh(&q->lock);
+	hash_del(&slot->node);
+	slot->skb = NULL;
+	slot->state = XFRM_PAR_DONE;
+	xfrm_par_deliver(q);
+}
+
+void __init xfrm_par_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct xfrm_par_cpu *pcpu = per_cpu_ptr(&xfrm_par_cpus, cpu);
+
+		spin_lock_init(&pcpu->lock);
+		INIT_LIST_HEAD(&pcpu->list);
+		INIT_WORK(&pcpu->work, xfrm_par_work);
+	}
+
+	xfrm_par_wq = alloc_workqueue("xfrm_par",
+				      WQ_MEM_RECLAIM | WQ_CPU_INTENSIVE, 0);
+	if (!xfrm_par_wq || rhashtable_init(&xfrm_par_ctxs, &xfrm_par_params))
+		panic("xfrm: cannot initialize parallel crypto\n");
+}
@@ -0,0 +1,82 @@
+#ifndef _XFRM_PARALLEL_H
+#define _XFRM_PARALLEL_H
+
+#include <linux/skbuff.h>
+#include <net/xfrm.h>
+
+struct xfrm_par_slot;
+
+#ifdef CONFIG_XFRM_PARALLEL
+
+static inline bool xfrm_par_enabled(const struct xfrm_state *x)
+{
+	return x->props.extra_flags & XFRM_SA_XFLAG_PARALLEL;
+}
+
+int xfrm_par_state_init(struct xfrm_state *x);
+void xfrm_par_state_destroy(struct xfrm_state *x);
+
+struct xfrm_par_slot *xfrm_par_reserve(struct xfrm_state *x,
+				       struct sk_buff *skb, bool output);
+int xfrm_par_dispatch(struct xfrm_par_slot *slot);
+void xfrm_par_cancel(struct xfrm_par_slot *slot);
+
+bool xfrm_par_input_done(struct xfrm_state *x, struct sk_buff *skb,
+			 int nexthdr);
+bool xfrm_par_output_done(struct xfrm_state *x, struct sk_buff *skb, int err);
+
+u32 xfrm_replay_par_limit(struct xfrm_state *x);
+
+void __init xfrm_par_init(void);
+
+#else
+
+static inline bool xfrm_par_enabled(const struct xfrm_state *x)
+{
+	return false;
+}
+
+static inline int xfrm_par_state_init(struct xfrm_state *x)
+{
+	return 0;
+}
+
+static inline void xfrm_par_state_destroy(struct xfrm_state *x)
+{
+}
+
+static inline struct xfrm_par_slot *xfrm_par_reserve(struct xfrm_state *x,
+						     struct sk_buff *skb,
+						     bool output)
+{
+	return NULL;
+}
+
+static inline int xfrm_par_dispatch(struct xfrm_par_slot *slot)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline void xfrm_par_cancel(struct xfrm_par_slot *slot)
+{
+}
+
+static inline bool xfrm_par_input_done(struct xfrm_state *x,
+				       struct sk_buff *skb, int nexthdr)
+{
+	return false;
+}
+
+static inline bool xfrm_par_output_done(struct xfrm_state *x,
+					struct sk_buff *skb, int err)
+{
+	return false;
+}
+
+static inline void xfrm_par_init(void)
+{
+}
+
+#endif /* CONFIG_XFRM_PARALLEL */
+
+#endif /* _XFRM_PARALLEL_H */
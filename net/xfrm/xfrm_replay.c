@@ -21,6 +21,8 @@
 #include <linux/export.h>
 #include <net/xfrm.h>
 
+#include "xfrm_parallel.h"
+
 u32 xfrm_replay_seqhi(struct xfrm_state *x, __be32 net_seq)
 {
 	u32 seq, seq_hi, bottom;
@@ -46,6 +48,22 @@ u32 xfrm_replay_seqhi(struct xfrm_state *x, __be32 net_seq)
 	return seq_hi;
 }
 
+#ifdef CONFIG_XFRM_PARALLEL
+/*
+ * With parallel crypto, xfrm_replay_seqhi() is evaluated when a packet is
+ * dispatched, but the window only advances once the packets before it
+ * have been delivered.  Keep no more packets in flight than fit into the
+ * window so the inferred high bits cannot go stale and fail the recheck.
+ */
+u32 xfrm_replay_par_limit(struct xfrm_state *x)
+{
+	if (!(x->props.flags & XFRM_STATE_ESN) || !x->replay_esn)
+		return U32_MAX;
+
+	return max_t(u32, x->replay_esn->replay_window, 1);
+}
+#endif
+
 static void xfrm_replay_notify(struct xfrm_state *x, int event)
 {
 	struct km_event c;
@@ -27,6 +27,7 @@
 #include <linux/kernel.h>
 
 #include "xfrm_hash.h"
+#include "xfrm_parallel.h"
 
 /* Each xfrm_state may be linked to two tables:
 
@@ -349,6 +350,7 @@ static void xfrm_state_gc_destroy(struct xfrm_state *x)
 		x->type->destructor(x);
 		xfrm_put_type(x->type);
 	}
+	xfrm_par_state_destroy(x);
 	security_xfrm_state_free(x);
 	kfree(x);
 }
@@ -2083,6 +2085,10 @@ int __xfrm_init_state(struct xfrm_state *x, bool init_replay)
 			goto error;
 	}
 
+	err = xfrm_par_state_init(x);
+	if (err)
+		goto error;
+
 	x->km.state = XFRM_STATE_VALID;
 
 error:
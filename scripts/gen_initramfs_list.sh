@@ -24,6 +24,9 @@ $0 [-o <file>] [-u <uid>] [-g <gid>] {-d | <cpio_source>} ...
 	-g <gid>       Group ID to map to group ID 0 (root).
 		       <gid> is only meaningful if <cpio_source> is a
 		       directory.  "squash" forces all files to gid 0.
+	-s <size>      With -o, split the archive into segments of about
+		       <size> bytes, compressed separately so that the
+		       kernel can decompress them in parallel.
 	<cpio_source>  File list or directory for cpio archive.
 		       If <cpio_source> is a .cpio file it will be used
 		       as direct input to initramfs.
@@ -227,6 +230,7 @@ output="/dev/stdout"
 output_file=""
 is_cpio_compressed=
 compr="gzip -n -9 -f"
+segment_size=
 
 arg="$1"
 case "$arg" in
@@ -274,6 +278,10 @@ while [ $# -gt 0 ]; do
 			root_gid="$1"
 			shift
 			;;
+		"-s")	# compressed segment size
+			segment_size="$1"
+			shift
+			;;
 		"-d")	# display default initramfs list
 			default_list="$arg"
 			${dep_list}default_initramfs
@@ -307,7 +315,14 @@ if [ ! -z ${output_file} ]; then
 			fi
 		fi
 		cpio_tfile="$(mktemp ${TMPDIR:-/tmp}/cpiofile.XXXXXX)"
-		usr/gen_init_cpio $timestamp ${cpio_list} > ${cpio_tfile}
+		if [ -n "${segment_size}" -a "${compr}" != "cat" ]; then
+			# gen_init_cpio compresses the segments itself
+			usr/gen_init_cpio $timestamp -s ${segment_size} \
+				-c "${compr} -" ${cpio_list} > ${cpio_tfile}
+			is_cpio_compressed="compressed"
+		else
+			usr/gen_init_cpio $timestamp ${cpio_list} > ${cpio_tfile}
+		fi
 	else
 		cpio_tfile=${cpio_file}
 	fi
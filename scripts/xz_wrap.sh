@@ -18,6 +18,12 @@ case $SRCARCH in
 	ia64)           BCJ=--ia64; LZMA2OPTS=pb=4 ;;
 	arm)            BCJ=--arm ;;
 	sparc)          BCJ=--sparc ;;
+	arm64)          BCJ=--arm64 ;;
 esac
 
+# The ARM64 filter needs XZ Utils 5.4.0 or later.
+if [ "$BCJ" = --arm64 ] && ! xz --arm64 -c </dev/null >/dev/null 2>&1; then
+	BCJ=
+fi
+
 exec xz --check=crc32 $BCJ --lzma2=$LZMA2OPTS,dict=32MiB
@@ -0,0 +1,419 @@
+/*
+ * Binder transaction stress test.
+ *
+ * Becomes the context manager of a binder device and serves handle 0 from
+ * a pool of looper threads, while forked clients hammer it from several
+ * threads each with synchronous calls, with a one-way call mixed in every
+ * few.  Every server thread echoes the payload back, so each client checks
+ * that it got the reply to its own call.  The server checks that the
+ * synchronous calls, and separately the one-way calls, of every client
+ * thread arrive in the order they were made, and that no one-way call is
+ * lost.  This exercises target thread selection, the thread, proc and
+ * node work queues and the wake-ups between them.
+ *
+ * It needs a binder device without a context manager, e.g. an extra name
+ * in CONFIG_ANDROID_BINDER_DEVICES, and is skipped otherwise.
+ *
+ * Usage: binder_stress [-d device] [-s server threads] [-c clients]
+ *			[-t threads per client] [-n calls per thread]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/android/binder.h>
+
+#define MAP_SIZE	(1024 * 1024)
+#define MAX_CLIENTS	64
+#define MAX_THREADS	64
+#define ONEWAY_EVERY	8
+
+enum {
+	CALL_SYNC = 1,
+	CALL_ONEWAY,
+};
+
+struct payload {
+	uint32_t client;
+	uint32_t thread;
+	uint32_t seq;
+	uint32_t check;
+};
+
+static const char *device = "/dev/binder";
+static int server_threads = 16;
+static int clients = 4;
+static int client_threads = 8;
+static int calls = 10000;
+
+static int server_fd;
+/* last sequence number seen from each client thread */
+static uint32_t last_sync[MAX_CLIENTS][MAX_THREADS];
+static uint32_t last_oneway[MAX_CLIENTS][MAX_THREADS];
+static unsigned long oneway_calls;
+static int server_errors;
+
+static uint32_t payload_check(const struct payload *p)
+{
+	return (p->client * 2654435761u) ^ (p->thread << 16) ^ p->seq;
+}
+
+static int binder_open(void)
+{
+	struct binder_version version;
+	int fd;
+
+	fd = open(device, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	if (ioctl(fd, BINDER_VERSION, &version) ||
+	    version.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION ||
+	    mmap(NULL, MAP_SIZE, PROT_READ, MAP_PRIVATE, fd, 0) ==
+	    MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int binder_write_read(int fd, void *wbuf, size_t wsize,
+			     void *rbuf, size_t rsize, size_t *consumed)
+{
+	struct binder_write_read bwr = {
+		.write_size = wsize,
+		.write_buffer = (binder_uintptr_t)wbuf,
+		.read_size = rsize,
+		.read_buffer = (binder_uintptr_t)rbuf,
+	};
+	int ret;
+
+	/* an interrupted call picks up where write_consumed left off */
+	do {
+		ret = ioctl(fd, BINDER_WRITE_READ, &bwr);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+		return -1;
+	*consumed = bwr.read_consumed;
+	return 0;
+}
+
+/* append a command and its argument to a write buffer */
+static size_t put_cmd(char *buf, size_t pos, uint32_t cmd,
+		      const void *arg, size_t size)
+{
+	memcpy(buf + pos, &cmd, sizeof(cmd));
+	memcpy(buf + pos + sizeof(cmd), arg, size);
+	return pos + sizeof(cmd) + size;
+}
+
+static void server_check(const struct binder_transaction_data *tr)
+{
+	const struct payload *p = (const void *)(uintptr_t)tr->data.ptr.buffer;
+	uint32_t *last;
+
+	if (tr->data_size != sizeof(*p) || p->client >= MAX_CLIENTS ||
+	    p->thread >= MAX_THREADS || p->check != payload_check(p)) {
+		fprintf(stderr, "server: corrupt payload\n");
+		__atomic_add_fetch(&server_errors, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/* binder only orders one-way calls among themselves */
+	if (tr->flags & TF_ONE_WAY) {
+		last = &last_oneway[p->client][p->thread];
+		__atomic_add_fetch(&oneway_calls, 1, __ATOMIC_RELAXED);
+	} else {
+		last = &last_sync[p->client][p->thread];
+	}
+	if (__atomic_exchange_n(last, p->seq, __ATOMIC_ACQ_REL) >= p->seq) {
+		fprintf(stderr, "server: client %u thread %u: call %u out of order\n",
+			p->client, p->thread, p->seq);
+		__atomic_add_fetch(&server_errors, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static void *server_thread(void *arg)
+{
+	struct binder_transaction_data reply;
+	uint32_t rbuf[256], cmd;
+	char wbuf[512];
+	size_t wpos, rpos, rsize;
+	binder_uintptr_t buffer;
+
+	wpos = put_cmd(wbuf, 0, BC_ENTER_LOOPER, NULL, 0);
+	for (;;) {
+		if (binder_write_read(server_fd, wbuf, wpos, rbuf,
+				      sizeof(rbuf), &rsize)) {
+			perror("server: BINDER_WRITE_READ");
+			exit(1);
+		}
+		wpos = 0;
+
+		for (rpos = 0; rpos < rsize; ) {
+			struct binder_transaction_data tr;
+
+			memcpy(&cmd, (char *)rbuf + rpos, sizeof(cmd));
+			rpos += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_TRANSACTION_COMPLETE:
+			case BR_SPAWN_LOOPER:
+				break;
+			case BR_TRANSACTION:
+				memcpy(&tr, (char *)rbuf + rpos, sizeof(tr));
+				rpos += sizeof(tr);
+				server_check(&tr);
+				buffer = tr.data.ptr.buffer;
+				if (!(tr.flags & TF_ONE_WAY)) {
+					/* echo the payload back */
+					memset(&reply, 0, sizeof(reply));
+					reply.data_size = tr.data_size;
+					reply.data.ptr.buffer = buffer;
+					wpos = put_cmd(wbuf, wpos, BC_REPLY,
+						       &reply, sizeof(reply));
+				}
+				wpos = put_cmd(wbuf, wpos, BC_FREE_BUFFER,
+					       &buffer, sizeof(buffer));
+				break;
+			default:
+				fprintf(stderr, "server: unexpected command %#x\n",
+					cmd);
+				exit(1);
+			}
+		}
+	}
+	return NULL;
+}
+
+struct client_arg {
+	int fd;
+	uint32_t client;
+	uint32_t thread;
+	int errors;
+};
+
+/* Make one call; returns 0 once it completed and its reply checked out */
+static int client_call(struct client_arg *ca, uint32_t seq)
+{
+	struct binder_transaction_data tr = { };
+	struct payload p, *r;
+	uint32_t rbuf[128], cmd;
+	char wbuf[128];
+	size_t wpos, rpos, rsize;
+	int oneway = !(seq % ONEWAY_EVERY);
+	binder_uintptr_t buffer;
+	int done = 0, ret = 0;
+
+	p.client = ca->client;
+	p.thread = ca->thread;
+	p.seq = seq;
+	p.check = payload_check(&p);
+
+	tr.target.handle = 0;
+	tr.code = oneway ? CALL_ONEWAY : CALL_SYNC;
+	tr.flags = oneway ? TF_ONE_WAY : 0;
+	tr.data_size = sizeof(p);
+	tr.data.ptr.buffer = (binder_uintptr_t)&p;
+	wpos = put_cmd(wbuf, 0, BC_TRANSACTION, &tr, sizeof(tr));
+
+	while (!done) {
+		if (binder_write_read(ca->fd, wbuf, wpos, rbuf, sizeof(rbuf),
+				      &rsize)) {
+			perror("client: BINDER_WRITE_READ");
+			return -1;
+		}
+		wpos = 0;
+
+		for (rpos = 0; rpos < rsize; ) {
+			memcpy(&cmd, (char *)rbuf + rpos, sizeof(cmd));
+			rpos += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+				break;
+			case BR_TRANSACTION_COMPLETE:
+				if (oneway)
+					done = 1;
+				break;
+			case BR_REPLY:
+				memcpy(&tr, (char *)rbuf + rpos, sizeof(tr));
+				rpos += sizeof(tr);
+				r = (void *)(uintptr_t)tr.data.ptr.buffer;
+				if (tr.data_size != sizeof(*r) ||
+				    memcmp(r, &p, sizeof(p))) {
+					fprintf(stderr, "client %u thread %u: wrong reply to call %u\n",
+						ca->client, ca->thread, seq);
+					ret = -1;
+				}
+				buffer = tr.data.ptr.buffer;
+				wpos = put_cmd(wbuf, wpos, BC_FREE_BUFFER,
+					       &buffer, sizeof(buffer));
+				done = 1;
+				break;
+			case BR_DEAD_REPLY:
+			case BR_FAILED_REPLY:
+				fprintf(stderr, "client %u thread %u: call %u failed\n",
+					ca->client, ca->thread, seq);
+				return -1;
+			default:
+				fprintf(stderr, "client: unexpected command %#x\n",
+					cmd);
+				return -1;
+			}
+		}
+	}
+
+	/* hand the reply buffer back */
+	if (wpos && binder_write_read(ca->fd, wbuf, wpos, NULL, 0, &rsize)) {
+		perror("client: BC_FREE_BUFFER");
+		return -1;
+	}
+	return ret;
+}
+
+static void *client_thread(void *arg)
+{
+	struct client_arg *ca = arg;
+	uint32_t seq;
+
+	for (seq = 1; seq <= (uint32_t)calls; seq++) {
+		if (client_call(ca, seq)) {
+			ca->errors++;
+			break;
+		}
+	}
+	return NULL;
+}
+
+static int client(uint32_t id)
+{
+	struct client_arg ca[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	int fd, i, errors = 0;
+
+	fd = binder_open();
+	if (fd < 0) {
+		perror("client: open");
+		return 1;
+	}
+	for (i = 0; i < client_threads; i++) {
+		ca[i].fd = fd;
+		ca[i].client = id;
+		ca[i].thread = i;
+		ca[i].errors = 0;
+		if (pthread_create(&threads[i], NULL, client_thread, &ca[i])) {
+			fprintf(stderr, "client: pthread_create failed\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < client_threads; i++) {
+		pthread_join(threads[i], NULL);
+		errors += ca[i].errors;
+	}
+	return errors ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	pid_t pids[MAX_CLIENTS];
+	pthread_t thread;
+	unsigned long oneway_expected;
+	int opt, i, status, failed = 0;
+
+	while ((opt = getopt(argc, argv, "d:s:c:t:n:")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = optarg;
+			break;
+		case 's':
+			server_threads = atoi(optarg);
+			break;
+		case 'c':
+			clients = atoi(optarg);
+			break;
+		case 't':
+			client_threads = atoi(optarg);
+			break;
+		case 'n':
+			calls = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-d device] [-s server threads] [-c clients] [-t threads per client] [-n calls per thread]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (server_threads < 1 || clients < 1 || clients > MAX_CLIENTS ||
+	    client_threads < 1 || client_threads > MAX_THREADS || calls < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	server_fd = binder_open();
+	if (server_fd < 0) {
+		printf("binder_stress: %s: %s, skipped\n", device,
+		       strerror(errno));
+		return 0;
+	}
+	if (ioctl(server_fd, BINDER_SET_CONTEXT_MGR, 0)) {
+		printf("binder_stress: %s already has a context manager, skipped\n",
+		       device);
+		return 0;
+	}
+
+	for (i = 0; i < clients; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (!pids[i])
+			_exit(client(i));
+	}
+
+	for (i = 0; i < server_threads; i++) {
+		if (pthread_create(&thread, NULL, server_thread, NULL)) {
+			fprintf(stderr, "pthread_create failed\n");
+			return 1;
+		}
+	}
+
+	for (i = 0; i < clients; i++) {
+		if (waitpid(pids[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status))
+			failed = 1;
+	}
+
+	/* give the server some time to finish the last one-way calls */
+	oneway_expected = (unsigned long)clients * client_threads *
+			  (calls / ONEWAY_EVERY);
+	for (i = 0; i < 100; i++) {
+		if (__atomic_load_n(&oneway_calls, __ATOMIC_RELAXED) >=
+		    oneway_expected)
+			break;
+		usleep(100000);
+	}
+	if (__atomic_load_n(&oneway_calls, __ATOMIC_RELAXED) !=
+	    oneway_expected) {
+		fprintf(stderr, "server: %lu of %lu one-way calls arrived\n",
+			__atomic_load_n(&oneway_calls, __ATOMIC_RELAXED),
+			oneway_expected);
+		failed = 1;
+	}
+	if (__atomic_load_n(&server_errors, __ATOMIC_RELAXED))
+		failed = 1;
+
+	printf("%d clients x %d threads x %d calls, %d server threads\n",
+	       clients, client_threads, calls, server_threads);
+	printf("binder_stress: %s\n", failed ? "FAIL" : "PASS");
+	return failed;
+}
@@ -0,0 +1,103 @@
+#!/bin/sh
+# This validates that the kernel will load firmware out of its list of
+# firmware locations on disk. Since the user helper does similar work,
+# we reset the custom load directory to a location the user helper doesn't
+# know so we can be sure we're not accidentally testing the user helper.
+set -e
+
+modprobe test_firmware
+
+DIR=/sys/devices/virtual/misc/test_firmware
+
+OLD_TIMEOUT=$(cat /sys/class/firmware/timeout)
+OLD_FWPATH=$(cat /sys/module/firmware_class/parameters/path)
+
+FWPATH=$(mktemp -d)
+FW="$FWPATH/test-firmware.bin"
+
+test_finish()
+{
+	echo "$OLD_TIMEOUT" >/sys/class/firmware/timeout
+	echo -n "$OLD_FWPATH" >/sys/module/firmware_class/parameters/path
+	rm -f "$FW"
+	rmdir "$FWPATH"
+}
+
+trap "test_finish" EXIT
+
+# Turn down the timeout so failures don't take so long.
+echo 1 >/sys/class/firmware/timeout
+# Set the kernel search path.
+echo -n "$FWPATH" >/sys/module/firmware_class/parameters/path
+
+# This is an unlikely real-world firmware content. :)
+echo "ABCD0123" >"$FW"
+
+NAME=$(basename "$FW")
+
+# Request a firmware that doesn't exist, it should fail.
+if echo -n "nope-$NAME" >"$DIR"/trigger_request 2>/dev/null ; then
+	echo "$0: firmware request was not expected to succeed" >&2
+	exit 1
+fi
+if diff -q "$FW" /dev/test_firmware >/dev/null ; then
+	echo "$0: firmware was not expected to match" >&2
+	exit 1
+else
+	echo "$0: timeout works"
+fi
+
+# This should succeed via kernel load or will fail after 1 second after
+# being handed over to the user helper, which won't find the fw either.
+if ! echo -n "$NAME" >"$DIR"/trigger_request ; then
+	echo "$0: could not trigger request" >&2
+	exit 1
+fi
+
+# Verify the contents are what we expect.
+if ! diff -q "$FW" /dev/test_firmware >/dev/null ; then
+	echo "$0: firmware was not loaded" >&2
+	exit 1
+else
+	echo "$0: filesystem loading works"
+fi
+
+# Same again without copying: the file's page cache pages are mapped.
+if ! echo -n "$NAME" >"$DIR"/trigger_request_mapped ; then
+	echo "$0: could not trigger mapped request" >&2
+	exit 1
+fi
+if ! diff -q "$FW" /dev/test_firmware >/dev/null ; then
+	echo "$0: mapped firmware was not loaded" >&2
+	exit 1
+else
+	echo "$0: mapped filesystem loading works"
+fi
+
+# test_firmware holds on to the image, so the file must not be writable.
+ERR=$( (echo "EFGH4567" >>"$FW") 2>&1 ) && {
+	echo "$0: mapped firmware file could be written to" >&2
+	exit 1
+}
+case "$ERR" in
+*"Text file busy"*)
+	;;
+*)
+	echo "$0: unexpected error writing mapped firmware file: $ERR" >&2
+	exit 1
+	;;
+esac
+if ! diff -q "$FW" /dev/test_firmware >/dev/null ; then
+	echo "$0: mapped firmware changed" >&2
+	exit 1
+fi
+
+# A failed request drops the image it held, which allows writes again.
+echo -n "nope-$NAME" >"$DIR"/trigger_request 2>/dev/null || true
+if ! echo "EFGH4567" >>"$FW" ; then
+	echo "$0: firmware file still busy after release" >&2
+	exit 1
+fi
+echo "$0: mapped firmware file is busy until released"
+
+exit 0
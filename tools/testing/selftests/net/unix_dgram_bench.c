@@ -0,0 +1,144 @@
+/*
+ * Many-to-one AF_UNIX datagram throughput.
+ *
+ * Forks a number of writers which connect to one receiver socket and send
+ * small datagrams as fast as they can, the way logging clients talk to a
+ * logging daemon, and reports how many datagrams per second the receiver
+ * got.
+ *
+ * Usage: unix_dgram_bench [-w writers] [-s size] [-t seconds]
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define MAX_WRITERS	1024
+#define MAX_SIZE	4096
+
+static int writers = 64;
+static int size = 128;
+static int seconds = 5;
+
+static void bench_addr(struct sockaddr_un *addr, socklen_t *len)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	/* Abstract name, nothing to clean up afterwards */
+	*len = offsetof(struct sockaddr_un, sun_path) + 1 +
+	       snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1,
+			"unix_dgram_bench.%d", getpid());
+}
+
+static void writer(const struct sockaddr_un *addr, socklen_t len)
+{
+	char buf[MAX_SIZE];
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0 || connect(fd, (const struct sockaddr *)addr, len)) {
+		perror("writer");
+		exit(1);
+	}
+
+	memset(buf, 'x', size);
+	for (;;) {
+		if (send(fd, buf, size, 0) < 0 && errno != EINTR &&
+		    errno != EAGAIN && errno != ENOBUFS) {
+			perror("send");
+			exit(1);
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	static pid_t pids[MAX_WRITERS];
+	struct sockaddr_un addr;
+	struct timeval tv = { .tv_sec = 1 };
+	unsigned long long count = 0;
+	double start, end;
+	char buf[MAX_SIZE];
+	socklen_t len;
+	int fd, opt, i;
+
+	while ((opt = getopt(argc, argv, "w:s:t:")) != -1) {
+		switch (opt) {
+		case 'w':
+			writers = atoi(optarg);
+			break;
+		case 's':
+			size = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-w writers] [-s size] [-t seconds]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (writers < 1 || writers > MAX_WRITERS ||
+	    size < 1 || size > MAX_SIZE || seconds < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	bench_addr(&addr, &len);
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, len) ||
+	    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
+		perror("receiver");
+		return 1;
+	}
+
+	for (i = 0; i < writers; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			writers = i;
+			goto out;
+		}
+		if (!pids[i])
+			writer(&addr, len);
+	}
+
+	start = now();
+	end = start + seconds;
+	while (now() < end) {
+		if (recv(fd, buf, sizeof(buf), 0) >= 0)
+			count++;
+		else if (errno != EINTR && errno != EAGAIN)
+			break;
+	}
+	end = now();
+
+	printf("%d writers, %d byte datagrams: %.0f datagrams/s\n",
+	       writers, size, count / (end - start));
+out:
+	for (i = 0; i < writers; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * AF_UNIX datagram reconnect race.
+ *
+ * A receiver connected to socket A only accepts datagrams from A.  When it
+ * reconnects to B, unix_dgram_connect() purges its receive queue, so once
+ * connect() has returned no datagram from A may be left in it.  Several
+ * writers keep sending from A while the receiver flips between A and B;
+ * B never sends, so anything the receiver finds right after connecting to
+ * B slipped in past the purge.
+ *
+ * Usage: unix_dgram_reconnect [-w writers] [-t seconds]
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define MAX_WRITERS	256
+
+static int writers = 8;
+static int seconds = 5;
+
+static void test_addr(struct sockaddr_un *addr, socklen_t *len, char name)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	/* Abstract name, nothing to clean up afterwards */
+	*len = offsetof(struct sockaddr_un, sun_path) + 1 +
+	       snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1,
+			"unix_dgram_reconnect.%d.%c", getpid(), name);
+}
+
+static int bound_socket(const struct sockaddr_un *addr, socklen_t len)
+{
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (fd < 0 || bind(fd, (const struct sockaddr *)addr, len)) {
+		perror("socket");
+		exit(1);
+	}
+	return fd;
+}
+
+static void writer(int fd)
+{
+	char c = 'a';
+
+	for (;;) {
+		if (send(fd, &c, 1, MSG_DONTWAIT) < 0 && errno != EINTR &&
+		    errno != EAGAIN && errno != EPERM &&
+		    errno != ECONNREFUSED && errno != ECONNRESET) {
+			perror("send");
+			exit(1);
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	static pid_t pids[MAX_WRITERS];
+	struct sockaddr_un addr_r, addr_a, addr_b;
+	socklen_t len_r, len_a, len_b;
+	unsigned long rounds = 0, leaked = 0;
+	int fd_r, fd_a, fd_b, opt, i;
+	double end;
+	char c;
+
+	while ((opt = getopt(argc, argv, "w:t:")) != -1) {
+		switch (opt) {
+		case 'w':
+			writers = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-w writers] [-t seconds]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (writers < 1 || writers > MAX_WRITERS || seconds < 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	test_addr(&addr_r, &len_r, 'r');
+	test_addr(&addr_a, &len_a, 'a');
+	test_addr(&addr_b, &len_b, 'b');
+	fd_r = bound_socket(&addr_r, len_r);
+	fd_a = bound_socket(&addr_a, len_a);
+	fd_b = bound_socket(&addr_b, len_b);
+	if (connect(fd_a, (struct sockaddr *)&addr_r, len_r)) {
+		perror("connect");
+		return 1;
+	}
+
+	for (i = 0; i < writers; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			writers = i;
+			leaked = 1;
+			goto out;
+		}
+		if (!pids[i])
+			writer(fd_a);
+	}
+
+	end = now() + seconds;
+	while (now() < end) {
+		if (connect(fd_r, (struct sockaddr *)&addr_a, len_a) ||
+		    connect(fd_r, (struct sockaddr *)&addr_b, len_b)) {
+			perror("connect");
+			leaked = 1;
+			break;
+		}
+		while (recv(fd_r, &c, 1, MSG_DONTWAIT) == 1)
+			leaked++;
+		rounds++;
+	}
+
+	printf("%lu reconnects, %lu datagrams from the old peer\n",
+	       rounds, leaked);
+out:
+	for (i = 0; i < writers; i++)
+		kill(pids[i], SIGKILL);
+	while (wait(NULL) > 0)
+		;
+	close(fd_b);
+	close(fd_a);
+	close(fd_r);
+
+	printf("unix_dgram_reconnect: %s\n", leaked ? "FAIL" : "PASS");
+	return leaked ? 1 : 0;
+}
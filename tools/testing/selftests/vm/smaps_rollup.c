@@ -0,0 +1,159 @@
+/*
+ * Check /proc/self/smaps_rollup against the sum of /proc/self/smaps.
+ *
+ * Maps a few thousand small anonymous areas, alternating their protection
+ * so that they stay separate vmas, touches them, then checks that every
+ * field of smaps_rollup is the sum of the same field over all smaps
+ * records (Pss and SwapPss may differ by the per-vma rounding to kB), and
+ * reports how long reading each file takes.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define NR_MAPS		4000
+#define NR_READS	20
+
+static const char * const fields[] = {
+	"Rss", "Pss", "Shared_Clean", "Shared_Dirty", "Private_Clean",
+	"Private_Dirty", "Referenced", "Anonymous", "AnonHugePages",
+	"Shared_Hugetlb", "Private_Hugetlb", "Swap", "SwapPss", "Locked",
+};
+
+#define NR_FIELDS	(sizeof(fields) / sizeof(fields[0]))
+
+static char buf[16 << 20];
+
+/* read @path into buf, return the length or -1 */
+static long read_file(const char *path)
+{
+	long len = 0;
+	ssize_t n;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+	while ((n = fread(buf + len, 1, sizeof(buf) - 1 - len, f)) > 0)
+		len += n;
+	fclose(f);
+	buf[len] = 0;
+	return len;
+}
+
+/* add up the fields of every record in buf, count the records */
+static void sum_fields(unsigned long *sum, unsigned long *records)
+{
+	char *line, *save;
+	unsigned long val, start, end;
+	unsigned int i;
+	size_t len;
+
+	memset(sum, 0, NR_FIELDS * sizeof(*sum));
+	*records = 0;
+	for (line = strtok_r(buf, "\n", &save); line;
+	     line = strtok_r(NULL, "\n", &save)) {
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+			(*records)++;
+		for (i = 0; i < NR_FIELDS; i++) {
+			len = strlen(fields[i]);
+			if (!strncmp(line, fields[i], len) && line[len] == ':' &&
+			    sscanf(line + len + 1, "%lu", &val) == 1)
+				sum[i] += val;
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* average time to read @path, in microseconds */
+static double time_read(const char *path, long *len)
+{
+	double start = now();
+	int i;
+
+	for (i = 0; i < NR_READS; i++)
+		*len = read_file(path);
+	return (now() - start) * 1e6 / NR_READS;
+}
+
+int main(void)
+{
+	unsigned long smaps[NR_FIELDS], rollup[NR_FIELDS];
+	unsigned long nr_vmas, nr_records;
+	long page = sysconf(_SC_PAGESIZE);
+	long smaps_len, rollup_len;
+	double t_smaps, t_rollup;
+	unsigned int i;
+	char *p;
+	int ret = 0;
+
+	if (read_file("/proc/self/smaps_rollup") < 0) {
+		printf("smaps_rollup: %s, skipped\n", strerror(errno));
+		return 0;
+	}
+	/*
+	 * Fault in buf and the code used between the two reads now, so that
+	 * they don't change Rss in between.
+	 */
+	sum_fields(rollup, &nr_records);
+	memset(buf, 0, sizeof(buf));
+
+	p = mmap(NULL, 2 * NR_MAPS * page, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	for (i = 0; i < 2 * NR_MAPS; i++) {
+		p[i * page] = 1;
+		if (i & 1)
+			mprotect(p + i * page, page, PROT_READ);
+	}
+
+	/* nothing below may fault in new pages between the two reads */
+	if (read_file("/proc/self/smaps") < 0) {
+		perror("smaps");
+		return 1;
+	}
+	sum_fields(smaps, &nr_vmas);
+	if (read_file("/proc/self/smaps_rollup") < 0) {
+		perror("smaps_rollup");
+		return 1;
+	}
+	sum_fields(rollup, &nr_records);
+
+	if (nr_records != 1) {
+		printf("smaps_rollup: %lu records instead of 1\n", nr_records);
+		ret = 1;
+	}
+	for (i = 0; i < NR_FIELDS; i++) {
+		/* Pss and SwapPss are rounded down per vma in smaps */
+		if (smaps[i] == rollup[i] ||
+		    (strstr(fields[i], "Pss") && smaps[i] <= rollup[i] &&
+		     rollup[i] - smaps[i] <= nr_vmas))
+			continue;
+		printf("%s: smaps %lu kB, smaps_rollup %lu kB\n",
+		       fields[i], smaps[i], rollup[i]);
+		ret = 1;
+	}
+
+	t_smaps = time_read("/proc/self/smaps", &smaps_len);
+	t_rollup = time_read("/proc/self/smaps_rollup", &rollup_len);
+	printf("%lu vmas: smaps %ld bytes in %.0f us, smaps_rollup %ld bytes in %.0f us\n",
+	       nr_vmas, smaps_len, t_smaps, rollup_len, t_rollup);
+
+	printf("smaps_rollup: %s\n", ret ? "FAIL" : "PASS");
+	return ret;
+}
@@ -15,6 +15,7 @@
  *
  * External file lists, symlink, pipe and fifo support by Thayne Harbaugh
  * Hard link support by Luciano Rocha
+ * Segmented archives for parallel decompression
  */
 
 #define xstr(s) #s
@@ -23,6 +24,28 @@
 static unsigned int offset;
 static unsigned int ino = 721;
 static time_t default_mtime;
+static FILE *out;
+
+/*
+ * With -s, the archive is split into segments of about segment_size bytes
+ * at entry boundaries, each a complete cpio archive compressed on its own by
+ * the -c command, so that the kernel can decompress them in parallel.  The
+ * output then starts with an uncompressed archive holding a single file,
+ * SEGMENT_TABLE, with one "<compressed size> <size>" line per segment,
+ * followed by the compressed segments back to back.
+ */
+#define SEGMENT_TABLE	"initramfs.segments"
+#define MAX_SEGMENTS	1024
+
+static unsigned long segment_size;
+static const char *segment_compr;
+
+static struct segment {
+	char path[PATH_MAX];
+	unsigned long size;
+	unsigned long csize;
+} segments[MAX_SEGMENTS];
+static unsigned int nr_segments;
 
 struct file_handler {
 	const char *type;
@@ -33,15 +56,15 @@ static void push_string(const char *name)
 {
 	unsigned int name_len = strlen(name) + 1;
 
-	fputs(name, stdout);
-	putchar(0);
+	fputs(name, out);
+	fputc(0, out);
 	offset += name_len;
 }
 
 static void push_pad (void)
 {
 	while (offset & 3) {
-		putchar(0);
+		fputc(0, out);
 		offset++;
 	}
 }
@@ -51,13 +74,13 @@ static void push_rest(const char *name)
 	unsigned int name_len = strlen(name) + 1;
 	unsigned int tmp_ofs;
 
-	fputs(name, stdout);
-	putchar(0);
+	fputs(name, out);
+	fputc(0, out);
 	offset += name_len;
 
 	tmp_ofs = name_len + 110;
 	while (tmp_ofs & 3) {
-		putchar(0);
+		fputc(0, out);
 		offset++;
 		tmp_ofs++;
 	}
@@ -65,7 +88,7 @@ static void push_rest(const char *name)
 
 static void push_hdr(const char *s)
 {
-	fputs(s, stdout);
+	fputs(s, out);
 	offset += 110;
 }
 
@@ -94,11 +117,137 @@ static void cpio_trailer(void)
 	push_rest(name);
 
 	while (offset % 512) {
-		putchar(0);
+		fputc(0, out);
 		offset++;
 	}
 }
 
+static int segment_begin(void)
+{
+	struct segment *seg = &segments[nr_segments];
+	char cmd[2 * PATH_MAX];
+	int fd;
+
+	if (nr_segments == MAX_SEGMENTS) {
+		fprintf(stderr, "ERROR: more than %d segments\n", MAX_SEGMENTS);
+		return -1;
+	}
+
+	snprintf(seg->path, sizeof(seg->path), "%s/cpioseg.XXXXXX",
+		 getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+	fd = mkstemp(seg->path);
+	if (fd < 0) {
+		fprintf(stderr, "ERROR: unable to create %s: %s\n",
+			seg->path, strerror(errno));
+		return -1;
+	}
+	close(fd);
+
+	snprintf(cmd, sizeof(cmd), "%s > '%s'", segment_compr, seg->path);
+	out = popen(cmd, "w");
+	if (!out) {
+		fprintf(stderr, "ERROR: unable to run '%s': %s\n",
+			cmd, strerror(errno));
+		unlink(seg->path);
+		return -1;
+	}
+	nr_segments++;
+	offset = 0;
+	return 0;
+}
+
+static int segment_end(void)
+{
+	struct segment *seg = &segments[nr_segments - 1];
+	struct stat st;
+
+	cpio_trailer();
+	seg->size = offset;
+	if (pclose(out)) {
+		fprintf(stderr, "ERROR: '%s' failed\n", segment_compr);
+		return -1;
+	}
+	out = NULL;
+	if (stat(seg->path, &st)) {
+		fprintf(stderr, "ERROR: unable to stat %s: %s\n",
+			seg->path, strerror(errno));
+		return -1;
+	}
+	seg->csize = st.st_size;
+	return 0;
+}
+
+/* write the segment table archive and the segments to stdout */
+static int segment_write(void)
+{
+	char s[256], line[64], buf[65536];
+	char *table = NULL;
+	size_t table_len = 0, n;
+	unsigned int i;
+	FILE *f;
+	int rc = 0;
+
+	for (i = 0; i < nr_segments; i++) {
+		n = snprintf(line, sizeof(line), "%lu %lu\n",
+			     segments[i].csize, segments[i].size);
+		table = realloc(table, table_len + n);
+		if (!table) {
+			fprintf(stderr, "out of memory\n");
+			return -1;
+		}
+		memcpy(table + table_len, line, n);
+		table_len += n;
+	}
+
+	out = stdout;
+	offset = 0;
+	sprintf(s,"%s%08X%08X%08lX%08lX%08X%08lX"
+	       "%08lX%08X%08X%08X%08X%08X%08X",
+		"070701",		/* magic */
+		ino++,			/* ino */
+		S_IFREG | 0400,		/* mode */
+		(long) 0,		/* uid */
+		(long) 0,		/* gid */
+		1,			/* nlink */
+		(long) default_mtime,	/* mtime */
+		(unsigned long) table_len, /* filesize */
+		3,			/* major */
+		1,			/* minor */
+		0,			/* rmajor */
+		0,			/* rminor */
+		(unsigned)strlen(SEGMENT_TABLE)+1, /* namesize */
+		0);			/* chksum */
+	push_hdr(s);
+	push_rest(SEGMENT_TABLE);
+	fwrite(table, table_len, 1, out);
+	offset += table_len;
+	push_pad();
+	cpio_trailer();
+	free(table);
+
+	for (i = 0; i < nr_segments; i++) {
+		f = fopen(segments[i].path, "r");
+		if (!f) {
+			fprintf(stderr, "ERROR: unable to open %s: %s\n",
+				segments[i].path, strerror(errno));
+			rc = -1;
+			break;
+		}
+		while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+			fwrite(buf, n, 1, out);
+		fclose(f);
+	}
+	return rc;
+}
+
+static void segment_cleanup(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_segments; i++)
+		unlink(segments[i].path);
+}
+
 static int cpio_mkslink(const char *name, const char *target,
 			 unsigned int mode, uid_t uid, gid_t gid)
 {
@@ -360,7 +509,7 @@ static int cpio_mkfile(const char *name, const char *location,
 		push_pad();
 
 		if (size) {
-			if (fwrite(filebuf, size, 1, stdout) != 1) {
+			if (fwrite(filebuf, size, 1, out) != 1) {
 				fprintf(stderr, "writing filebuf failed\n");
 				goto error;
 			}
@@ -451,7 +600,7 @@ static int cpio_mkfile_line(const char *line)
 static void usage(const char *prog)
 {
 	fprintf(stderr, "Usage:\n"
-		"\t%s [-t <timestamp>] <cpio_list>\n"
+		"\t%s [-t <timestamp>] [-s <size> -c <command>] <cpio_list>\n"
 		"\n"
 		"<cpio_list> is a file containing newline separated entries that\n"
 		"describe the files to be included in the initramfs archive:\n"
@@ -486,7 +635,12 @@ static void usage(const char *prog)
 		"\n"
 		"<timestamp> is time in seconds since Epoch that will be used\n"
 		"as mtime for symlinks, special files and directories. The default\n"
-		"is to use the current time for these entries.\n",
+		"is to use the current time for these entries.\n"
+		"\n"
+		"-s <size> splits the archive into segments of about <size> bytes\n"
+		"(suffixes k and M are accepted), each compressed separately by\n"
+		"<command>, which reads from stdin and writes to stdout, e.g.\n"
+		"\"gzip -n -9\".  The kernel decompresses such segments in parallel.\n",
 		prog);
 }
 
@@ -526,9 +680,10 @@ int main (int argc, char *argv[])
 	int line_nr = 0;
 	const char *filename;
 
+	out = stdout;
 	default_mtime = time(NULL);
 	while (1) {
-		int opt = getopt(argc, argv, "t:h");
+		int opt = getopt(argc, argv, "t:s:c:h");
 		char *invalid;
 
 		if (opt == -1)
@@ -543,6 +698,25 @@ int main (int argc, char *argv[])
 				exit(1);
 			}
 			break;
+		case 's':
+			segment_size = strtoul(optarg, &invalid, 10);
+			if (*invalid == 'k' || *invalid == 'K') {
+				segment_size <<= 10;
+				invalid++;
+			} else if (*invalid == 'M') {
+				segment_size <<= 20;
+				invalid++;
+			}
+			if (!*optarg || *invalid || !segment_size) {
+				fprintf(stderr, "Invalid segment size: %s\n",
+						optarg);
+				usage(argv[0]);
+				exit(1);
+			}
+			break;
+		case 'c':
+			segment_compr = optarg;
+			break;
 		case 'h':
 		case '?':
 			usage(argv[0]);
@@ -550,10 +724,12 @@ int main (int argc, char *argv[])
 		}
 	}
 
-	if (argc - optind != 1) {
+	if (argc - optind != 1 || !segment_size != !segment_compr) {
 		usage(argv[0]);
 		exit(1);
 	}
+	if (segment_size)
+		out = NULL;
 	filename = argv[optind];
 	if (!strcmp(filename, "-"))
 		cpio_list = stdin;
@@ -600,6 +776,11 @@ int main (int argc, char *argv[])
 			ec = -1;
 		}
 
+		if (segment_size && !out && segment_begin()) {
+			ec = -1;
+			break;
+		}
+
 		for (type_idx = 0; file_handler_table[type_idx].type; type_idx++) {
 			int rc;
 			if (! strcmp(line, file_handler_table[type_idx].type)) {
@@ -611,12 +792,26 @@ int main (int argc, char *argv[])
 			}
 		}
 
+		/* hard links are written by one handler, never split */
+		if (segment_size && offset >= segment_size && segment_end()) {
+			ec = -1;
+			break;
+		}
+
 		if (NULL == file_handler_table[type_idx].type) {
 			fprintf(stderr, "unknown file type line %d: '%s'\n",
 				line_nr, line);
 		}
 	}
-	if (ec == 0)
+	if (segment_size) {
+		if (ec == 0 && !out && !nr_segments)
+			ec = segment_begin();
+		if (ec == 0 && out)
+			ec = segment_end();
+		if (ec == 0)
+			ec = segment_write();
+		segment_cleanup();
+	} else if (ec == 0)
 		cpio_trailer();
 
 	exit(ec);